@@ -11,10 +11,11 @@ in rec {
                     xorg.libX11
                     xorg.libXrandr
                     xorg.libXext
+                    xorg.libXi
                     libGL
                     libGLU
                     freeglut
                   ];
-    LD_LIBRARY_PATH="/run/opengl-driver/lib;${xorg.libX11}/lib/;${libGL}/lib/;${libGLU}/lib;${freeglut}/lib;${xorg.libXrandr}/lib;${xorg.libXext}/lib";
+    LD_LIBRARY_PATH="/run/opengl-driver/lib;${xorg.libX11}/lib/;${libGL}/lib/;${libGLU}/lib;${freeglut}/lib;${xorg.libXrandr}/lib;${xorg.libXext}/lib;${xorg.libXi}/lib";
   };
 }
@@ -1,5 +1,5 @@
-## Wayland backend for boomer.
-## This file is compiled when boomer.nim is built with -d:wayland.
+## Wayland backend for boomer, picked by boomer.nim in a Wayland session.
+## The C side lives in libboomer_wayland.so, see wayland_ffi.nim.
 
 import os
 import navigation
@@ -7,12 +7,25 @@ import config
 import wayland_ffi
 import screenshot_wayland
 import image_data
-import opengl
+import image_file
+import pyramid
+import tile_cache
+import gl_library
 import la
+import frame_limiter
+import daemon
+import dynamic_resolution
+import shader_prelude
+import program_cache
+import clock
+import timeline
 import strutils
 import math
 import options
 
+when defined(vulkan):
+  import vulkan_ffi
+
 # Linux input-event-codes.h key constants
 const
   KEY_ESC*   = 1
@@ -23,6 +36,8 @@ const
   KEY_R*     = 19
   KEY_F*     = 33
 
+  LENS_GAP = 24.0   # logical pixels between the lens and what it shows
+
 # --- Shader loading (same as X11 backend) ---
 type Shader = tuple[path, content: string]
 
@@ -38,10 +53,10 @@ const
   vertexShader = readShader "vert.glsl"
   fragmentShader = readShader "frag.glsl"
 
-proc newShader(shader: Shader, kind: GLenum): GLuint =
+proc newShader(shader: Shader, kind: GLenum, api: GLApi): GLuint =
   result = glCreateShader(kind)
-  var shaderArray = allocCStringArray([shader.content])
-  glShaderSource(result, 1, shaderArray, nil)
+  var shaderArray = allocCStringArray([shaderPrelude(api, kind), shader.content])
+  glShaderSource(result, 2, shaderArray, nil)
   glCompileShader(result)
   deallocCStringArray(shaderArray)
 
@@ -55,16 +70,29 @@ proc newShader(shader: Shader, kind: GLenum): GLuint =
     echo infoLog
     echo "------------------------------"
 
-proc newShaderProgram(vertex, fragment: Shader): GLuint =
+proc newShaderProgram(vertex, fragment: Shader, api: GLApi): GLuint =
+  # The cache is keyed by what the driver actually compiles
+  let sources = [shaderPrelude(api, GL_VERTEX_SHADER) & vertex.content,
+                 shaderPrelude(api, GL_FRAGMENT_SHADER) & fragment.content]
+  result = loadProgram(sources)
+  if result != 0:
+    glUseProgram(result)
+    return
+
   result = glCreateProgram()
 
   var
-    vertexShader = newShader(vertex, GL_VERTEX_SHADER)
-    fragmentShader = newShader(fragment, GL_FRAGMENT_SHADER)
+    vertexShader = newShader(vertex, GL_VERTEX_SHADER, api)
+    fragmentShader = newShader(fragment, GL_FRAGMENT_SHADER, api)
 
   glAttachShader(result, vertexShader)
   glAttachShader(result, fragmentShader)
 
+  # GLSL 1.00 has no layout qualifiers, pin the attributes before linking
+  glBindAttribLocation(result, 0, "aPos")
+  glBindAttribLocation(result, 1, "aTexCoord")
+
+  markRetrievable(result)
   glLinkProgram(result)
 
   glDeleteShader(vertexShader)
@@ -76,6 +104,8 @@ proc newShaderProgram(vertex, fragment: Shader): GLuint =
   if not success.bool:
     glGetProgramInfoLog(result, 512, nil, infoLog)
     echo infoLog
+  else:
+    saveProgram(result, sources)
 
   glUseProgram(result)
 
@@ -100,10 +130,324 @@ proc update(flashlight: var Flashlight, dt: float32) =
   else:
     flashlight.shadow = max(flashlight.shadow - 6.0 * dt, 0.0)
 
-proc mainWayland() =
+# --- OpenGL renderer ---
+# Sticks to what desktop GL 3.3, GLES 3 and GLES 2 have in common: RGBA
+# uploads swizzled in the shader, CLAMP_TO_EDGE, 16-bit indices, and a
+# vertex array object only where one exists.
+type GLRenderer = object
+  api: GLApi
+  shader: GLuint
+  vao, vbo, ebo: GLuint
+  texture: GLuint
+  imageSize: tuple[w, h: cint]      # allocated texture storage
+  imageFormat: PixelFormat
+  fbo, fboTexture: GLuint           # offscreen target for dynamic resolution
+  fboSize: tuple[w, h: GLsizei]
+
+proc setupAttributes() =
+  let stride = GLsizei(5 * sizeof(GLfloat))
+
+  glVertexAttribPointer(0, 3, cGL_FLOAT, false, stride, cast[pointer](0))
+  glEnableVertexAttribArray(0)
+
+  glVertexAttribPointer(1, 2, cGL_FLOAT, false, stride, cast[pointer](3 * sizeof(GLfloat)))
+  glEnableVertexAttribArray(1)
+
+proc quadVertices(width, height: cint): array[4, array[5, GLfloat]] =
+  let w = width.float32
+  let h = height.float32
+  [
+    # Position                 Texture coords
+    [GLfloat    w,     0, 0.0, 1.0, 1.0], # Top right
+    [GLfloat    w,     h, 0.0, 1.0, 0.0], # Bottom right
+    [GLfloat    0,     h, 0.0, 0.0, 0.0], # Bottom left
+    [GLfloat    0,     0, 0.0, 0.0, 1.0]  # Top left
+  ]
+
+proc uploadFormat(format: PixelFormat): GLenum =
+  if format == pfRGB: GL_RGB else: GL_RGBA
+
+proc allocateImage(renderer: var GLRenderer, width, height: cint,
+                   pixels: cstring, format = pfBGRA) =
+  # BGRA uploads are an extension on GLES; the shader swizzles instead
+  glBindTexture(GL_TEXTURE_2D, renderer.texture)
+  if format != renderer.imageFormat:
+    # RGB rows (mapped PPM files) get red and blue swapped on the way in,
+    # so frag.glsl finds them where a screenshot has them
+    let (red, blue) = if format == pfRGB: (GL_BLUE, GL_RED)
+                      else: (GL_RED, GL_BLUE)
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, red.GLint)
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, blue.GLint)
+    renderer.imageFormat = format
+  glPixelStorei(GL_UNPACK_ALIGNMENT, if format == pfRGB: 1 else: 4)
+  glTexImage2D(GL_TEXTURE_2D,
+               0,
+               uploadFormat(format).GLint,
+               width,
+               height,
+               0,
+               uploadFormat(format),
+               GL_UNSIGNED_BYTE,
+               pixels)
+  renderer.imageSize = (width, height)
+
+  var vertices = quadVertices(width, height)
+  glBindBuffer(GL_ARRAY_BUFFER, renderer.vbo)
+  glBufferSubData(GL_ARRAY_BUFFER, 0, GLsizeiptr(sizeof(vertices)),
+                  addr vertices)
+
+proc initGLRenderer(api: GLApi): GLRenderer =
+  ## Needs no surface size, so it runs while the compositor is still
+  ## answering. Texture storage comes with `reserveImage` or `setImage`.
+  result.api = api
+  result.shader = newShaderProgram(vertexShader, fragmentShader, api)
+
+  var
+    vertices = quadVertices(0, 0)
+    indices = [GLushort(0), 1, 3,
+                        1,  2, 3]
+
+  # Core profiles refuse to draw without a VAO, GLES 2 has none
+  if api != apiGLES2:
+    glGenVertexArrays(1, addr result.vao)
+    glBindVertexArray(result.vao)
+  glGenBuffers(1, addr result.vbo)
+  glGenBuffers(1, addr result.ebo)
+
+  glBindBuffer(GL_ARRAY_BUFFER, result.vbo)
+  glBufferData(GL_ARRAY_BUFFER, size = GLsizeiptr(sizeof(vertices)),
+               addr vertices, GL_STATIC_DRAW)
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, result.ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, size = GLsizeiptr(sizeof(indices)),
+               addr indices, GL_STATIC_DRAW);
+
+  setupAttributes()
+
+  glGenTextures(1, addr result.texture)
+  glActiveTexture(GL_TEXTURE0)
+  glBindTexture(GL_TEXTURE_2D, result.texture)
+
+  glUniform1i(glGetUniformLocation(result.shader, "tex".cstring), 0)
+
+  # Sampling is NEAREST, so there is no need for mipmaps (which GLES 2
+  # can't build for non-power-of-two textures anyway)
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST)
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST)
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE)
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE)
+
+proc reserveImage(renderer: var GLRenderer, width, height: cint) =
+  ## Allocates storage for a `width` x `height` image ahead of time,
+  ## `setImage` then only fills it
+  renderer.allocateImage(width, height, nil)
+
+proc setImage(renderer: var GLRenderer, screenshot: ImageData) =
+  ## Reuses the texture storage when the size matches, which is every
+  ## capture but the first for a --daemon
+  if screenshot.format != pfBGRA and renderer.api == apiGLES2:
+    # No texture swizzle there to fix the channel order with
+    var bgra = screenshot.converted()
+    renderer.setImage(bgra)
+    bgra.destroy()
+  elif renderer.imageSize == (w: screenshot.width, h: screenshot.height) and
+       renderer.imageFormat == screenshot.format:
+    glBindTexture(GL_TEXTURE_2D, renderer.texture)
+    glPixelStorei(GL_UNPACK_ALIGNMENT, if screenshot.format == pfRGB: 1 else: 4)
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
+                    screenshot.width, screenshot.height,
+                    uploadFormat(screenshot.format), GL_UNSIGNED_BYTE,
+                    screenshot.data)
+  else:
+    renderer.allocateImage(screenshot.width, screenshot.height,
+                           screenshot.data, screenshot.format)
+
+proc destroy(renderer: var GLRenderer) =
+  glDeleteTextures(1, addr renderer.texture)
+  if renderer.fbo != 0:
+    glDeleteFramebuffers(1, addr renderer.fbo)
+    glDeleteTextures(1, addr renderer.fboTexture)
+  if renderer.vao != 0:
+    glDeleteVertexArrays(1, addr renderer.vao)
+  glDeleteBuffers(1, addr renderer.vbo)
+  glDeleteBuffers(1, addr renderer.ebo)
+  glDeleteProgram(renderer.shader)
+
+proc beginDraw(renderer: GLRenderer, imageSize: Vec2f, camera: Camera,
+               windowSize: Vec2f, cursor: Vec2f, flashlight: Flashlight) =
+  let shaderProgram = renderer.shader
+
+  glViewport(0, 0, windowSize.x.GLsizei, windowSize.y.GLsizei)
+  glClearColor(0.1, 0.1, 0.1, 1.0)
+  glClear(GL_COLOR_BUFFER_BIT)
+
+  glUseProgram(shaderProgram)
+
+  glUniform2f(glGetUniformLocation(shaderProgram, "cameraPos".cstring), camera.position[0], camera.position[1])
+  glUniform1f(glGetUniformLocation(shaderProgram, "cameraScale".cstring), camera.scale)
+  glUniform2f(glGetUniformLocation(shaderProgram, "screenshotSize".cstring),
+              imageSize.x,
+              imageSize.y)
+  glUniform2f(glGetUniformLocation(shaderProgram, "windowSize".cstring),
+              windowSize.x,
+              windowSize.y)
+  glUniform2f(glGetUniformLocation(shaderProgram, "cursorPos".cstring),
+              cursor.x,
+              cursor.y)
+  glUniform1f(glGetUniformLocation(shaderProgram, "flShadow".cstring), flashlight.shadow)
+  glUniform1f(glGetUniformLocation(shaderProgram, "flRadius".cstring), flashlight.radius)
+
+  if renderer.vao != 0:
+    glBindVertexArray(renderer.vao)
+  else:
+    glBindBuffer(GL_ARRAY_BUFFER, renderer.vbo)
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer.ebo)
+    setupAttributes()
+
+proc draw(renderer: GLRenderer, screenshot: ImageData, camera: Camera,
+          windowSize: Vec2f, cursor: Vec2f, flashlight: Flashlight) =
+  renderer.beginDraw(vec2(screenshot.width.float32, screenshot.height.float32),
+                     camera, windowSize, cursor, flashlight)
+  glDrawElements(GL_TRIANGLES, count = 6, GL_UNSIGNED_SHORT, indices = nil)
+
+proc drawTiles(renderer: GLRenderer, pyramid: Pyramid, cache: var TileCache,
+               camera: Camera, windowSize: Vec2f, cursor: Vec2f,
+               flashlight: Flashlight) =
+  ## --image with a pyramid. The one-tile top level goes under everything,
+  ## so tiles still waiting for an upload leave no holes, then the level
+  ## closest to the zoom, only where the window shows it.
+  let imageSize = vec2(pyramid.width.float32, pyramid.height.float32)
+  renderer.beginDraw(imageSize, camera, windowSize, cursor, flashlight)
+  glBindBuffer(GL_ARRAY_BUFFER, renderer.vbo)
+  cache.beginFrame()
+
+  let visible = camera.visibleRect(imageSize, windowSize)
+  let target = pyramid.levelFor(camera.scale)
+  var levels = @[pyramid.levels.high]
+  if target != levels[0]:
+    levels.add target
+  for level in levels:
+    let info = pyramid.levels[level]
+    # Image pixels a tile of this level covers
+    let span = float32(TILE_SIZE shl level)
+    let first = (x: max(floor(visible.min.x / span).int, 0),
+                 y: max(floor(visible.min.y / span).int, 0))
+    let last = (x: min(ceil(visible.max.x / span).int, info.tilesX.int),
+                y: min(ceil(visible.max.y / span).int, info.tilesY.int))
+    for ty in first.y ..< last.y:
+      for tx in first.x ..< last.x:
+        let texture = cache.lookup(pyramid, (level, tx, ty))
+        if texture == 0:
+          continue
+        # Edge tiles are only partly image
+        let u = float32(min(info.width.int - tx * TILE_SIZE, TILE_SIZE)) /
+                TILE_SIZE
+        let v = float32(min(info.height.int - ty * TILE_SIZE, TILE_SIZE)) /
+                TILE_SIZE
+        let left = tx.float32 * span
+        let right = min(left + u * span, imageSize.x)
+        # Rows from the top, positions from the bottom like quadVertices
+        let top = imageSize.y - ty.float32 * span
+        let bottom = max(top - v * span, 0'f32)
+        var vertices = [
+          [GLfloat right, bottom, 0.0, u, v],
+          [GLfloat right, top,    0.0, u, 0.0],
+          [GLfloat left,  top,    0.0, 0.0, 0.0],
+          [GLfloat left,  bottom, 0.0, 0.0, v]
+        ]
+        glBindTexture(GL_TEXTURE_2D, texture)
+        glBufferSubData(GL_ARRAY_BUFFER, 0, GLsizeiptr(sizeof(vertices)),
+                        addr vertices)
+        glDrawElements(GL_TRIANGLES, count = 6, GL_UNSIGNED_SHORT,
+                       indices = nil)
+
+proc drawScaled(renderer: var GLRenderer, screenshot: ImageData, camera: Camera,
+                windowSize, renderSize: Vec2f, cursor: Vec2f,
+                flashlight: Flashlight) =
+  ## Draws the view at `renderSize` into the offscreen framebuffer and
+  ## stretches it over the window. Everything measured in window pixels
+  ## shrinks by the same ratio, so the picture is the same, only coarser.
+  if renderSize == windowSize:
+    renderer.draw(screenshot, camera, windowSize, cursor, flashlight)
+    return
+
+  let size = (w: windowSize.x.GLsizei, h: windowSize.y.GLsizei)
+  if renderer.fbo == 0:
+    glGenFramebuffers(1, addr renderer.fbo)
+    glGenTextures(1, addr renderer.fboTexture)
+  glBindFramebuffer(GL_FRAMEBUFFER, renderer.fbo)
+  if renderer.fboSize != size:
+    # Allocated at full size once, smaller frames use its corner
+    glBindTexture(GL_TEXTURE_2D, renderer.fboTexture)
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8.GLint, size.w, size.h, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, nil)
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                           GL_TEXTURE_2D, renderer.fboTexture, 0)
+    glBindTexture(GL_TEXTURE_2D, renderer.texture)
+    renderer.fboSize = size
+
+  let ratio = renderSize.x / windowSize.x
+  var scaled = camera
+  scaled.scale = camera.scale * ratio
+  renderer.draw(screenshot, scaled, renderSize, cursor * ratio, flashlight)
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer.fbo)
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0)
+  glBlitFramebuffer(0, 0, renderSize.x.GLint, renderSize.y.GLint,
+                    0, 0, size.w, size.h, GL_COLOR_BUFFER_BIT, GL_LINEAR.GLenum)
+  glBindFramebuffer(GL_FRAMEBUFFER, 0)
+
+proc drawSelection(windowSize: Vec2f, anchor, corner: Vec2f, dragging: bool) =
+  ## The --region overlay: the desktop dimmed but for the rectangle being
+  ## dragged. Clears alone do it, in premultiplied alpha.
+  glViewport(0, 0, windowSize.x.GLsizei, windowSize.y.GLsizei)
+  glClearColor(0.0, 0.0, 0.0, 0.4)
+  glClear(GL_COLOR_BUFFER_BIT)
+  if dragging:
+    let lo = vec2(min(anchor.x, corner.x), min(anchor.y, corner.y))
+    let hi = vec2(max(anchor.x, corner.x), max(anchor.y, corner.y))
+    glEnable(GL_SCISSOR_TEST)
+    # Scissor rows count from the bottom
+    glScissor(lo.x.GLint, GLint(windowSize.y - hi.y),
+              GLsizei(hi.x - lo.x), GLsizei(hi.y - lo.y))
+    glClearColor(0.0, 0.0, 0.0, 0.0)
+    glClear(GL_COLOR_BUFFER_BIT)
+    glDisable(GL_SCISSOR_TEST)
+
+# --- Compositor-side zoom and software rendering ---
+proc viewOrigin(screenshot: ImageData, camera: Camera, windowSize: Vec2f): Vec2f =
+  ## Same mapping as vert.glsl: the image pixel at the top-left corner
+  ## of the window is cameraPos + screenshotSize/2 - windowSize/(2*scale)
+  let size = vec2(screenshot.width.float32, screenshot.height.float32)
+  camera.position + size * 0.5 - windowSize / (2.0 * camera.scale)
+
+proc presentView(wlState: WaylandState, screenshot: ImageData, camera: Camera,
+                 windowSize: Vec2f) =
+  let origin = viewOrigin(screenshot, camera, windowSize)
+  wl_backend_present_view(wlState, origin.x, origin.y, camera.scale)
+
+type Renderer = enum
+  ## Order must match the WL_RENDERER_* constants in wayland_backend.c
+  rGL = "gl"
+  rViewport = "viewport"
+  rSoftware = "software"
+  rGLES = "gles"
+  rVulkan = "vulkan"
+
+proc mainWayland*() =
   let boomerDir = getConfigDir() / "boomer"
   var configFile = boomerDir / "config"
   var windowed = false
+  var lowLatency = false
+  var dynamicResolution = false
+  var resident = false
+  var region = false
+  var windowMatch = ""
+  var listWindows = false
+  var live = false
+  var lens = false
+  var imagePath = ""
+  var renderer = rGL
   var delaySec = 0.0
 
   block:
@@ -117,7 +461,33 @@ proc mainWayland() =
       --new-config [filepath]   generate a new default config at [filepath]
   -c, --config <filepath>       use config at <filepath>
   -V, --version                 show the current version and exit
-  -w, --windowed                windowed mode instead of fullscreen"""
+  -w, --windowed                windowed mode instead of fullscreen
+      --low-latency             present without vsync, tearing is allowed
+      --daemon                  stay resident with the overlay hidden;
+                                running boomer again or sending SIGUSR1
+                                captures and shows it
+      --region                  drag a rectangle first and capture only
+                                that (gl and gles renderers)
+      --window <match>          capture only the window whose title or app
+                                id contains <match>, even when covered
+      --list-windows            print the app id and title of every window
+                                --window can pick and exit
+      --live                    keep updating the --window capture while
+                                zooming (gl and gles renderers)
+      --image <path>            zoom a PPM, PGM, QOI or PNG file instead of
+                                a capture, - reads it from stdin
+      --build-pyramid <path>    write <path>.pyramid, which --image then
+                                loads tile by tile, and exit
+      --lens                    a small live magnifier that trails the
+                                pointer instead of the fullscreen overlay,
+                                clicks go through it (gl and gles renderers)
+      --dynamic-resolution      render fast pans and zooms at reduced
+                                resolution when frames run over (GL only)
+      --renderer <name>         gl (default), viewport: let the compositor
+                                crop and scale the screenshot, no flashlight,
+                                software: render on the CPU without GL,
+                                gles: like gl but prefer an OpenGL ES context,
+                                or vulkan: needs a build with -d:vulkan"""
     var i = 1
     while i <= paramCount():
       let arg = paramStr(i)
@@ -141,6 +511,43 @@ proc mainWayland() =
       of "-w", "--windowed":
         asFlag():
           windowed = true
+      of "--renderer":
+        asParam(rendererParam):
+          try:
+            renderer = parseEnum[Renderer](rendererParam)
+          except ValueError:
+            echo "Unknown renderer `$#`" % [rendererParam]
+            usageQuit()
+          when not defined(vulkan):
+            if renderer == rVulkan:
+              quit "This boomer was built without Vulkan support (-d:vulkan)"
+      of "--low-latency":
+        asFlag():
+          lowLatency = true
+      of "--dynamic-resolution":
+        asFlag():
+          dynamicResolution = true
+      of "--daemon":
+        asFlag():
+          resident = true
+      of "--region":
+        asFlag():
+          region = true
+      of "--window":
+        asParam(windowParam):
+          windowMatch = windowParam
+      of "--list-windows":
+        asFlag():
+          listWindows = true
+      of "--live":
+        asFlag():
+          live = true
+      of "--lens":
+        asFlag():
+          lens = true
+      of "--image":
+        asParam(imageParam):
+          imagePath = imageParam
       of "-h", "--help":
         asFlag():
           usageQuit()
@@ -181,237 +588,585 @@ proc mainWayland() =
 
   echo "Using config: ", config
 
-  # Take screenshot before creating the window
-  echo "Capturing screenshot via grim..."
-  var screenshot = captureScreen()
+  if resident and renderer == rVulkan:
+    quit "--daemon doesn't support the vulkan renderer yet"
+  if region and renderer notin {rGL, rGLES}:
+    quit "--region needs the gl or gles renderer"
+  if region and windowed:
+    # Pointer positions would be relative to the window, not the output
+    quit "--region can't be combined with --windowed"
+  if windowMatch.len > 0 and (resident or region):
+    quit "--window can't be combined with --daemon or --region yet"
+  if live and windowMatch.len == 0:
+    quit "--live needs --window"
+  if live and renderer notin {rGL, rGLES}:
+    quit "--live needs the gl or gles renderer"
+  if lens and renderer notin {rGL, rGLES}:
+    quit "--lens needs the gl or gles renderer"
+  if lens and (windowed or resident or region or windowMatch.len > 0):
+    quit "--lens can't be combined with --windowed, --daemon, --region or --window"
+  if lens and config.lens_size <= 0:
+    # The backend would build the fullscreen overlay for a size of 0
+    quit "--lens needs a lens_size above 0, not $#" % [$config.lens_size]
+  if imagePath.len > 0 and (resident or region or windowMatch.len > 0 or lens):
+    quit "--image can't be combined with --daemon, --region, --window or --lens"
+  # A daemon captures and shows the overlay much faster than we could, but
+  # only the way it was started. A run with flags of its own is served here.
+  let delegate = not resident and not region and windowMatch.len == 0 and
+                 not listWindows and not lens and imagePath.len == 0 and
+                 not windowed and renderer == rGL and not lowLatency and
+                 not dynamicResolution and configFile == boomerDir / "config"
+  if delegate and activateDaemon():
+    return
+
+  # Activations that arrive while we set up wait in the socket backlog
+  var listener: Daemon
+  if resident:
+    listener = initDaemon()
+  defer:
+    if resident:
+      listener.destroy()
+
+  var timeline = initTimeline("Startup timeline")
+
+  # grim runs on a worker thread while we connect and set up GL. Nothing
+  # is shown before the first present, which waits for the capture, so
+  # the overlay never ends up in the picture. A daemon captures on every
+  # activation instead, and --region only once a rectangle is chosen.
+  # --window needs the connection to name the window, so its copy is
+  # taken after setup.
+  let grim = not resident and not region and windowMatch.len == 0 and
+             not listWindows and not lens and imagePath.len == 0
+  var screenshot: ImageData
   defer: screenshot.destroy()
+  # --image with a pyramid keeps `screenshot` empty, only its size is set
+  var pyramid: Pyramid
+  defer: pyramid.close()
+  var capture: BackgroundCapture
+  if grim:
+    echo "Capturing screenshot via grim..."
+    capture.startCapture()
 
   # Initialize Wayland backend
-  var wlState = wl_backend_init(if windowed: 1.cint else: 0.cint)
+  let initStart = nowSeconds()
+  var wlState = wl_backend_init(if windowed: 1.cint else: 0.cint,
+                                if lowLatency: 1.cint else: 0.cint,
+                                renderer.ord.cint,
+                                if lens: config.lens_size.cint else: 0.cint)
   if cast[pointer](wlState) == nil:
     quit "Failed to initialize Wayland backend"
   defer: wl_backend_destroy(wlState)
-
-  # Load OpenGL extensions (EGL context is already current from init)
-  loadExtensions()
-
-  var shaderProgram = newShaderProgram(vertexShader, fragmentShader)
-
-  let w = screenshot.width.float32
-  let h = screenshot.height.float32
-  var
-    vao, vbo, ebo: GLuint
-    vertices = [
-      # Position                 Texture coords
-      [GLfloat    w,     0, 0.0, 1.0, 1.0], # Top right
-      [GLfloat    w,     h, 0.0, 1.0, 0.0], # Bottom right
-      [GLfloat    0,     h, 0.0, 0.0, 0.0], # Bottom left
-      [GLfloat    0,     0, 0.0, 0.0, 1.0]  # Top left
-    ]
-    indices = [GLuint(0), 1, 3,
-                      1,  2, 3]
-
-  glGenVertexArrays(1, addr vao)
-  glGenBuffers(1, addr vbo)
-  glGenBuffers(1, addr ebo)
+  timeline.add("wayland", initStart, nowSeconds())
+
+  var initFinished = false
+  template finishInit() =
+    # The seat, output and configure events for what init sent
+    if not initFinished:
+      let finishStart = nowSeconds()
+      if wl_backend_finish_init(wlState) != 0:
+        quit "Lost the Wayland connection during setup"
+      timeline.add("wayland wait", finishStart, nowSeconds())
+      initFinished = true
+
+  template awaitScreenshot() =
+    if screenshot.data == nil:
+      if grim:
+        screenshot = capture.finish()
+        timeline.add("capture", capture.startedAt, capture.finishedAt)
+      elif windowMatch.len > 0:
+        # The window list is complete once init has finished
+        finishInit()
+        let captureStart = nowSeconds()
+        screenshot = wlState.captureToplevel(windowMatch)
+        timeline.add("capture", captureStart, nowSeconds())
+      elif imagePath.len > 0 and not pyramid.isOpen:
+        let loadStart = nowSeconds()
+        if renderer in {rGL, rGLES} and pyramid.open(imagePath):
+          # Tiles are read as the camera reaches them, none of it now
+          screenshot = ImageData(width: pyramid.width.cint,
+                                 height: pyramid.height.cint, bpp: 4)
+        else:
+          screenshot = loadImageFile(imagePath)
+          # Only the GL renderers take mapped RGB rows as they are
+          if renderer notin {rGL, rGLES}:
+            screenshot.toBGRA()
+        timeline.add("load", loadStart, nowSeconds())
+
+  if listWindows:
+    finishInit()
+    wlState.listToplevels()
+    return
+
+  # The backend falls back to GL when the compositor lacks what
+  # compositor-side zoom needs
+  renderer = Renderer(wl_state_renderer(wlState))
+
+  when defined(vulkan):
+    var vkRenderer: VulkanRenderer
+    if renderer == rVulkan:
+      # The screenshot is copied into a device-local image right away, so
+      # this one can't overlap with the capture
+      awaitScreenshot()
+      finishInit()
+      vkRenderer = newVulkanRenderer(wl_state_display(wlState),
+                                     wl_state_surface(wlState),
+                                     wl_state_buffer_width(wlState),
+                                     wl_state_buffer_height(wlState),
+                                     screenshot.data,
+                                     screenshot.width, screenshot.height,
+                                     lowLatency)
+      if cast[pointer](vkRenderer) == nil:
+        stderr.writeLine "Failed to start the Vulkan renderer, falling back to OpenGL"
+        if wl_backend_fallback_gl(wlState) != 0:
+          quit "Failed to initialize OpenGL"
+        renderer = rGL
+    defer:
+      if renderer == rVulkan:
+        vulkan_renderer_destroy(vkRenderer)
+
+  var glRenderer: GLRenderer
+  var resolution: DynamicResolution
+  var tiles: TileCache
+  if renderer in {rGL, rGLES}:
+    # The backend picks desktop GL, GLES 3 or GLES 2, whichever it got.
+    # Shaders build while the compositor answers the initial commit.
+    let glStart = nowSeconds()
+    # The context is current since init
+    loadGL(proc (name: cstring): pointer = wl_backend_gl_proc(wlState, name))
+    let api = case wl_state_gl_api(wlState)
+              of 3: apiGLES3
+              of 2: apiGLES2
+              else: apiGL
+    glRenderer = initGLRenderer(api)
+    timeline.add("gl setup", glStart, nowSeconds())
+    finishInit()
+    # The texture is sized for the output, which is what captures will
+    # be, so its storage is ready before the screenshot is. A window has
+    # its own size, and so does what the lens shows or a file.
+    if windowMatch.len == 0 and not lens and imagePath.len == 0:
+      glRenderer.reserveImage(wl_state_buffer_width(wlState),
+                              wl_state_buffer_height(wlState))
+    if dynamicResolution:
+      resolution = initDynamicResolution(api, wl_state_output_rate(wlState))
+  else:
+    finishInit()
   defer:
-    glDeleteVertexArrays(1, addr vao)
-    glDeleteBuffers(1, addr vbo)
-    glDeleteBuffers(1, addr ebo)
-
-  glBindVertexArray(vao)
-
-  glBindBuffer(GL_ARRAY_BUFFER, vbo)
-  glBufferData(GL_ARRAY_BUFFER, size = GLsizeiptr(sizeof(vertices)),
-               addr vertices, GL_STATIC_DRAW)
-
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, size = GLsizeiptr(sizeof(indices)),
-               addr indices, GL_STATIC_DRAW);
-
-  var stride = GLsizei(vertices[0].len * sizeof(GLfloat))
-
-  glVertexAttribPointer(0, 3, cGL_FLOAT, false, stride, cast[pointer](0))
-  glEnableVertexAttribArray(0)
-
-  glVertexAttribPointer(1, 2, cGL_FLOAT, false, stride, cast[pointer](3 * sizeof(GLfloat)))
-  glEnableVertexAttribArray(1)
-
-  var texture = 0.GLuint
-  glGenTextures(1, addr texture)
-  glActiveTexture(GL_TEXTURE0)
-  glBindTexture(GL_TEXTURE_2D, texture)
-
-  glTexImage2D(GL_TEXTURE_2D,
-               0,
-               GL_RGB.GLint,
-               screenshot.width,
-               screenshot.height,
-               0,
-               GL_BGRA,
-               GL_UNSIGNED_BYTE,
-               screenshot.data)
-  glGenerateMipmap(GL_TEXTURE_2D)
-
-  glUniform1i(glGetUniformLocation(shaderProgram, "tex".cstring), 0)
-
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST)
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST)
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER)
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER)
+    if renderer in {rGL, rGLES}:
+      tiles.destroy()
+      resolution.destroy()
+      glRenderer.destroy()
+
+  proc loadScreenshot(image: ImageData) =
+    case renderer
+    of rGL, rGLES:
+      glRenderer.setImage(image)
+    of rViewport, rSoftware:
+      # The software renderer borrows the pixels, `screenshot` outlives it
+      if wl_backend_set_image(wlState, image.data,
+                              image.width, image.height) != 0:
+        quit "Failed to hand the screenshot to the backend"
+    of rVulkan:
+      discard
 
   let rate = wl_state_output_rate(wlState)
   let dt = 1.0 / rate.float
-
-  # Wait until compositor sends fullscreen configure
-  while wl_state_configured(wlState) == 0:
-    discard wl_backend_roundtrip(wlState)
-
-  # Render the first frame immediately so the window appears with
-  # screenshot content (the window becomes visible on first eglSwapBuffers)
-  block:
-    let w = wl_state_width(wlState)
-    let h = wl_state_height(wlState)
-    glViewport(0, 0, w, h)
-    glClearColor(0.1, 0.1, 0.1, 1.0)
-    glClear(GL_COLOR_BUFFER_BIT or GL_DEPTH_BUFFER_BIT)
-    glUseProgram(shaderProgram)
-    glUniform2f(glGetUniformLocation(shaderProgram, "cameraPos".cstring), 0.0, 0.0)
-    glUniform1f(glGetUniformLocation(shaderProgram, "cameraScale".cstring), 1.0)
-    glUniform2f(glGetUniformLocation(shaderProgram, "screenshotSize".cstring),
-                screenshot.width.float32, screenshot.height.float32)
-    glUniform2f(glGetUniformLocation(shaderProgram, "windowSize".cstring), w.float32, h.float32)
-    glUniform2f(glGetUniformLocation(shaderProgram, "cursorPos".cstring), 0.0, 0.0)
-    glUniform1f(glGetUniformLocation(shaderProgram, "flShadow".cstring), 0.0)
-    glUniform1f(glGetUniformLocation(shaderProgram, "flRadius".cstring), 200.0)
-    glBindVertexArray(vao)
-    glDrawElements(GL_TRIANGLES, count = 6, GL_UNSIGNED_INT, indices = nil)
-    wl_backend_swap_buffers(wlState)
+  # With vsync a frame is shown one refresh after it was drawn, with async
+  # presentation it is shown as soon as it is swapped
+  let presentDelay = if lowLatency: 0.0 else: dt
 
   var
     quitting = false
-    camera = Camera(scale: 1.0)
-    mouse: Mouse =
-      block:
-        let pos = vec2(wl_state_pointer_x(wlState).float32,
-                        wl_state_pointer_y(wlState).float32)
-        Mouse(curr: pos, prev: pos)
-    flashlight = Flashlight(
-      isEnabled: false,
-      radius: 200.0)
-
-  proc scrollUp() =
+    camera: Camera
+    mouse: Mouse
+    flashlight: Flashlight
+    lastOrigin: Vec2f
+    lastScale = 0.0'f32
+
+  proc present() =
+    # Physical pixels: the surface may be scaled by the compositor, and
+    # pointer coordinates from the backend are already in this space
+    let windowSize = vec2(wl_state_buffer_width(wlState).float32,
+                          wl_state_buffer_height(wlState).float32)
+    case renderer
+    of rGL, rGLES:
+      if pyramid.isOpen:
+        # Tiles are uploaded as they come into view, not worth scaling
+        glRenderer.drawTiles(pyramid, tiles, camera, windowSize,
+                             mouse.curr, flashlight)
+        wl_backend_swap_buffers(wlState)
+        return
+      let origin = viewOrigin(screenshot, camera, windowSize)
+      resolution.beginFrame(isFastMotion(lastOrigin, origin, lastScale,
+                                         camera.scale, dt))
+      lastOrigin = origin
+      lastScale = camera.scale
+      glRenderer.drawScaled(screenshot, camera, windowSize,
+                            resolution.renderSize(windowSize),
+                            mouse.curr, flashlight)
+      resolution.endFrame()
+      wl_backend_swap_buffers(wlState)
+    of rViewport:
+      wlState.presentView(screenshot, camera, windowSize)
+    of rSoftware:
+      let origin = viewOrigin(screenshot, camera, windowSize)
+      wl_backend_present_software(wlState, origin.x, origin.y, camera.scale,
+                                  mouse.curr.x, mouse.curr.y,
+                                  flashlight.shadow, flashlight.radius)
+    of rVulkan:
+      when defined(vulkan):
+        let origin = viewOrigin(screenshot, camera, windowSize)
+        if vulkan_renderer_draw(vkRenderer, windowSize.x.cint, windowSize.y.cint,
+                                origin.x, origin.y, camera.scale,
+                                mouse.curr.x, mouse.curr.y,
+                                flashlight.shadow, flashlight.radius) != 0:
+          quit "Lost the Vulkan device"
+
+  proc scroll(notches: float) =
+    ## `notches` may be fractional for high-resolution wheels and touchpads
     if wl_state_ctrl_held(wlState) != 0 and flashlight.isEnabled:
-      flashlight.deltaRadius += INITIAL_FL_DELTA_RADIUS
+      flashlight.deltaRadius += float32(INITIAL_FL_DELTA_RADIUS * notches)
     else:
-      camera.deltaScale += config.scrollSpeed
+      camera.deltaScale += config.scrollSpeed * notches
       camera.scalePivot = mouse.curr
 
-  proc scrollDown() =
-    if wl_state_ctrl_held(wlState) != 0 and flashlight.isEnabled:
-      flashlight.deltaRadius -= INITIAL_FL_DELTA_RADIUS
-    else:
-      camera.deltaScale -= config.scrollSpeed
-      camera.scalePivot = mouse.curr
+  proc runSession() =
+    ## Shows the overlay until it is quit or closed
+    # Wait until compositor sends fullscreen configure
+    if wl_backend_wait_configured(wlState) != 0:
+      quit "Lost the Wayland connection"
 
-  while not quitting:
-    # Poll and dispatch Wayland events (non-blocking)
-    discard wl_backend_poll_events(wlState)
-
-    # Check close
-    if wl_state_closed(wlState) != 0:
-      quitting = true
-      break
-
-    let winWidth  = wl_state_width(wlState)
-    let winHeight = wl_state_height(wlState)
-
-    glViewport(0, 0, winWidth, winHeight)
-
-    # Update mouse position
-    mouse.curr = vec2(wl_state_pointer_x(wlState).float32,
-                       wl_state_pointer_y(wlState).float32)
-
-    # Handle mouse button
-    if wl_state_button_just_pressed(wlState) != 0:
-      mouse.prev = mouse.curr
-      mouse.drag = true
-      camera.velocity = vec2(0.0, 0.0)
-
-    if wl_state_button_just_released(wlState) != 0:
-      mouse.drag = false
-
-    # Handle mouse drag
-    if mouse.drag:
-      let delta = world(camera, mouse.prev) - world(camera, mouse.curr)
-      camera.position += delta
-      camera.velocity = delta * rate.float
-
-    mouse.prev = mouse.curr
-
-    # Handle scroll
-    let scrollDelta = wl_state_scroll_delta(wlState)
-    if scrollDelta > 0:
-      for i in 0..<scrollDelta:
-        scrollUp()
-    elif scrollDelta < 0:
-      for i in 0..<(-scrollDelta):
-        scrollDown()
-
-    # Handle keyboard events (iterate the queue)
-    let keyCount = wl_state_key_event_count(wlState)
-    for i in 0.cint..<keyCount:
-      let keyCode = wl_state_key_event_key(wlState, i)
-      let keyState = wl_state_key_event_state(wlState, i)
-      if keyState == 1:  # key press
-        case keyCode
-        of KEY_EQUAL: scrollUp()
-        of KEY_MINUS: scrollDown()
-        of KEY_0:
-          camera.scale = 1.0
-          camera.deltaScale = 0.0
-          camera.position = vec2(0.0'f32, 0.0)
-          camera.velocity = vec2(0.0'f32, 0.0)
-        of KEY_Q, KEY_ESC:
-          quitting = true
-        of KEY_R:
-          if configFile.len > 0 and fileExists(configFile):
-            config = loadConfig(configFile)
-        of KEY_F:
-          flashlight.isEnabled = not flashlight.isEnabled
+    quitting = false
+    camera = Camera(scale: 1.0)
+    let pos = vec2(wl_state_pointer_x(wlState).float32,
+                   wl_state_pointer_y(wlState).float32)
+    mouse = Mouse(curr: pos, prev: pos)
+    flashlight = Flashlight(isEnabled: false, radius: 200.0)
+    lastScale = 0.0
+
+    # Render the first frame immediately so the window appears with
+    # screenshot content (the window becomes visible on the first present)
+    let firstFrame = nowSeconds()
+    present()
+    timeline.add("first frame", firstFrame, nowSeconds())
+    timeline.report()
+
+    var limiter = initFrameLimiter(rate)
+
+    while not quitting:
+      # Poll and dispatch Wayland events (non-blocking)
+      discard wl_backend_poll_events(wlState)
+
+      # Check close
+      if wl_state_closed(wlState) != 0:
+        quitting = true
+        break
+
+      let winWidth  = wl_state_buffer_width(wlState)
+      let winHeight = wl_state_buffer_height(wlState)
+
+      # Feed this frame's pointer motion into the history
+      let now = nowSeconds()
+      let motionCount = wl_state_motion_event_count(wlState)
+      for i in 0.cint..<motionCount:
+        mouse.history.push(wl_state_motion_event_time(wlState, i).float / 1000.0,
+                           vec2(wl_state_motion_event_x(wlState, i).float32,
+                                wl_state_motion_event_y(wlState, i).float32),
+                           now)
+
+      let pointer = vec2(wl_state_pointer_x(wlState).float32,
+                         wl_state_pointer_y(wlState).float32)
+
+      # Handle mouse button
+      if wl_state_button_just_pressed(wlState) != 0:
+        camera.startDrag(mouse, pointer)
+
+      # Handle mouse drag, predicting where the pointer will be when this
+      # frame is presented
+      camera.drag(mouse, pointer, now, now + presentDelay,
+                  released = wl_state_button_just_released(wlState) != 0)
+
+      # Handle scroll
+      let scrollDelta = wl_state_scroll_delta(wlState)
+      if scrollDelta != 0.0:
+        scroll(scrollDelta)
+
+      # Handle keyboard events (iterate the queue)
+      let keyCount = wl_state_key_event_count(wlState)
+      for i in 0.cint..<keyCount:
+        let keyCode = wl_state_key_event_key(wlState, i)
+        let keyState = wl_state_key_event_state(wlState, i)
+        if keyState == 1:  # key press
+          case keyCode
+          of KEY_EQUAL: scroll(1.0)
+          of KEY_MINUS: scroll(-1.0)
+          of KEY_0:
+            camera.scale = 1.0
+            camera.deltaScale = 0.0
+            camera.position = vec2(0.0'f32, 0.0)
+            camera.velocity = vec2(0.0'f32, 0.0)
+          of KEY_Q, KEY_ESC:
+            quitting = true
+          of KEY_R:
+            if configFile.len > 0 and fileExists(configFile):
+              config = loadConfig(configFile)
+          of KEY_F:
+            if renderer != rViewport:
+              flashlight.isEnabled = not flashlight.isEnabled
+          else:
+            discard
+
+      # Reset per-frame input state AFTER processing
+      wl_state_reset_frame(wlState)
+
+      camera.update(config, dt, mouse, windowSize = vec2(winWidth.float32, winHeight.float32))
+      flashlight.update(dt)
+
+      if live:
+        # The buffer is only written between a request and its copy
+        # landing, so it is read before the next one goes out
+        case wl_backend_capture_ready(wlState)
+        of 1:
+          screenshot = wlState.capturedToplevel()
+          glRenderer.setImage(screenshot)
+        of -1:
+          stderr.writeLine "The window is gone, keeping its last frame"
+          live = false
         else:
           discard
-
-    # Reset per-frame input state AFTER processing
-    wl_state_reset_frame(wlState)
-
-    camera.update(config, dt, mouse, windowSize = vec2(winWidth.float32, winHeight.float32))
-    flashlight.update(dt)
-
-    # Draw
-    glClearColor(0.1, 0.1, 0.1, 1.0)
-    glClear(GL_COLOR_BUFFER_BIT or GL_DEPTH_BUFFER_BIT)
-
-    glUseProgram(shaderProgram)
-
-    glUniform2f(glGetUniformLocation(shaderProgram, "cameraPos".cstring), camera.position[0], camera.position[1])
-    glUniform1f(glGetUniformLocation(shaderProgram, "cameraScale".cstring), camera.scale)
-    glUniform2f(glGetUniformLocation(shaderProgram, "screenshotSize".cstring),
-                screenshot.width.float32,
-                screenshot.height.float32)
-    glUniform2f(glGetUniformLocation(shaderProgram, "windowSize".cstring),
-                winWidth.float32,
-                winHeight.float32)
-    glUniform2f(glGetUniformLocation(shaderProgram, "cursorPos".cstring),
-                mouse.curr.x.float32,
-                mouse.curr.y.float32)
-    glUniform1f(glGetUniformLocation(shaderProgram, "flShadow".cstring), flashlight.shadow)
-    glUniform1f(glGetUniformLocation(shaderProgram, "flRadius".cstring), flashlight.radius)
-
-    glBindVertexArray(vao)
-    glDrawElements(GL_TRIANGLES, count = 6, GL_UNSIGNED_INT, indices = nil)
-
-    wl_backend_swap_buffers(wlState)
-
-mainWayland()
-
+        if live and wl_backend_capture_request(wlState) != 0:
+          live = false
+
+      present()
+
+      # Nothing else keeps us at the refresh rate when presentation is async
+      if lowLatency:
+        limiter.wait()
+
+  proc selectRegion(): Option[string] =
+    ## Shows the dimmed overlay to drag a rectangle on and returns it in
+    ## grim's -g form, "" for a click without a drag (the whole screen),
+    ## none when cancelled. The overlay is gone again when this returns,
+    ## so the capture can't see it.
+    if wl_backend_wait_configured(wlState) != 0:
+      quit "Lost the Wayland connection"
+    var
+      anchor, corner: Vec2f
+      dragging = false
+      released = false
+      cancelled = false
+    while not released and not cancelled:
+      discard wl_backend_poll_events(wlState)
+      if wl_state_closed(wlState) != 0:
+        cancelled = true
+
+      let pointer = vec2(wl_state_pointer_x(wlState).float32,
+                         wl_state_pointer_y(wlState).float32)
+      if wl_state_button_just_pressed(wlState) != 0:
+        anchor = pointer
+        dragging = true
+      if dragging:
+        corner = pointer
+        released = wl_state_button_just_released(wlState) != 0
+
+      for i in 0.cint..<wl_state_key_event_count(wlState):
+        if wl_state_key_event_state(wlState, i) == 1 and
+           wl_state_key_event_key(wlState, i) in [KEY_Q.cint, KEY_ESC.cint]:
+          cancelled = true
+      wl_state_reset_frame(wlState)
+
+      let windowSize = vec2(wl_state_buffer_width(wlState).float32,
+                            wl_state_buffer_height(wlState).float32)
+      drawSelection(windowSize, anchor, corner, dragging)
+      wl_backend_swap_buffers(wlState)
+
+    wl_backend_hide(wlState)
+    # Once this returns the compositor has taken the overlay down
+    if wl_backend_roundtrip(wlState) < 0:
+      quit "Lost the Wayland connection"
+    if cancelled:
+      return none(string)
+
+    # Buffer pixels to logical global coordinates, which grim takes
+    let scale = wl_state_scale(wlState)
+    let x0 = round(min(anchor.x, corner.x).float / scale).int
+    let y0 = round(min(anchor.y, corner.y).float / scale).int
+    let x1 = round(max(anchor.x, corner.x).float / scale).int
+    let y1 = round(max(anchor.y, corner.y).float / scale).int
+    if x1 - x0 < 1 or y1 - y0 < 1:
+      return some("")
+    some("$#,$# $#x$#" % [$(wl_state_output_x(wlState) + x0),
+                          $(wl_state_output_y(wlState) + y0),
+                          $(x1 - x0), $(y1 - y0)])
+
+  proc captureRegion(): Option[ImageData] =
+    ## --region: the selection, then a capture of just that. Memory,
+    ## conversion and upload scale with the rectangle, not the desktop.
+    let selectStart = nowSeconds()
+    let selected = selectRegion()
+    timeline.add("select", selectStart, nowSeconds())
+    if selected.isNone:
+      return none(ImageData)
+    let captureStart = nowSeconds()
+    result = some(captureScreen(selected.get))
+    timeline.add("capture", captureStart, nowSeconds())
+    if wl_backend_show(wlState) != 0:
+      quit "Failed to show the overlay"
+
+  proc runLens() =
+    ## --lens: a square trailing the pointer shows the output around it
+    ## magnified, copied anew for every frame. Nothing else is covered, the
+    ## desktop stays live and clicks go through, and a frame costs what
+    ## the lens covers rather than the whole output. The lens sits beside
+    ## what it shows, or it would end up in its own copies.
+    if wl_backend_lens_start(wlState) != 0:
+      quit "The lens needs zwlr_screencopy_manager_v1 and ext-image-copy-capture-v1 cursor sessions"
+    if wl_backend_wait_configured(wlState) != 0:
+      quit "Lost the Wayland connection"
+
+    let size = config.lens_size.float
+    let zoom = max(config.lens_zoom, 1.0)
+    let source = size / zoom
+    camera = Camera(scale: zoom.float32)
+    var image: ImageData
+    var shown = false
+    var shownAt = (x: 0, y: 0)
+    var requestedAt = shownAt   # where the lens goes for the copy in flight
+    var inFlight = false
+
+    proc present() =
+      let windowSize = vec2(wl_state_buffer_width(wlState).float32,
+                            wl_state_buffer_height(wlState).float32)
+      # The flashlight is off, the cursor position doesn't matter
+      glRenderer.draw(image, camera, windowSize, vec2(0.0'f32, 0.0),
+                      Flashlight())
+      wl_backend_swap_buffers(wlState)
+      shown = true
+
+    proc covers(lens: tuple[x, y: int], x, y: float): bool =
+      ## Whether the lens at `lens` overlaps a copy at (x, y)
+      lens.x.float < x + source and x < lens.x.float + size and
+        lens.y.float < y + source and y < lens.y.float + size
+
+    while wl_state_closed(wlState) == 0:
+      if wl_backend_wait_fds(wlState, nil, 0) < 0:
+        quit "Lost the Wayland connection"
+      wl_state_reset_frame(wlState)
+
+      if wl_backend_region_ready(wlState) != 0:
+        inFlight = false
+        image = ImageData(width: wl_backend_region_width(wlState),
+                          height: wl_backend_region_height(wlState),
+                          data: wl_backend_region_pixels(wlState),
+                          bpp: 4)
+        glRenderer.setImage(image)
+        if requestedAt != shownAt:
+          wl_backend_lens_move(wlState, requestedAt.x.cint, requestedAt.y.cint)
+          shownAt = requestedAt
+        present()
+
+      # The lens stays put while a copy is in flight, so that copy can't
+      # catch it
+      if inFlight or wl_state_cursor_inside(wlState) == 0:
+        continue
+      # Output buffer pixels to logical ones, which screencopy regions and
+      # layer-shell margins are in
+      let scale = wl_state_scale(wlState)
+      let outputWidth = wl_state_output_width(wlState).float / scale
+      let outputHeight = wl_state_output_height(wlState).float / scale
+      let cursorX = wl_state_cursor_x(wlState).float / scale
+      let cursorY = wl_state_cursor_y(wlState).float / scale
+      # Shifted rather than cut at the edges, so the copy fills the lens
+      let originX = clamp(cursorX - source / 2, 0.0, outputWidth - source)
+      let originY = clamp(cursorY - source / 2, 0.0, outputHeight - source)
+      # Below and right of the copy, flipped where that runs off
+      var atX = originX + source + LENS_GAP
+      var atY = originY + source + LENS_GAP
+      if atX + size > outputWidth:
+        atX = originX - LENS_GAP - size
+      if atY + size > outputHeight:
+        atY = originY - LENS_GAP - size
+      let lensAt = (x: atX.int, y: atY.int)
+
+      if shown and shownAt.covers(originX, originY):
+        # A pointer faster than the lens ran into it. It moves out of the
+        # way first, showing the last copy, and the next one goes out once
+        # the compositor has drawn it there.
+        if lensAt != shownAt:
+          wl_backend_lens_move(wlState, lensAt.x.cint, lensAt.y.cint)
+          shownAt = lensAt
+          present()
+        continue
+      if wl_backend_region_request(wlState, originX.cint, originY.cint,
+                                   source.cint, source.cint) == 1:
+        inFlight = true
+        requestedAt = lensAt
+
+  proc upload(image: ImageData) =
+    let uploadStart = nowSeconds()
+    loadScreenshot(image)
+    timeline.add("upload", uploadStart, nowSeconds())
+
+  if lens:
+    runLens()
+    return
+
+  if not resident:
+    if region:
+      let captured = captureRegion()
+      if captured.isNone:
+        return
+      screenshot = captured.get
+    else:
+      awaitScreenshot()
+    # A pyramid is uploaded tile by tile while drawing
+    if not pyramid.isOpen:
+      if imagePath.len > 0 and renderer in {rGL, rGLES}:
+        var maxSize: GLint
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, addr maxSize)
+        if max(screenshot.width, screenshot.height) > maxSize:
+          quit ("$# is $#x$#, textures here can't be larger than $#x$#, " &
+                "boomer --build-pyramid $# makes it viewable") %
+               [imagePath, $screenshot.width, $screenshot.height,
+                $maxSize, $maxSize, imagePath]
+      upload(screenshot)
+    runSession()
+    return
+
+  # Everything is set up, drop the surface until someone asks for it
+  wl_backend_hide(wlState)
+  echo "Waiting for activation on ", socketPath(), " or SIGUSR1"
+
+  let fds = listener.fds
+  while wl_state_closed(wlState) == 0:
+    if wl_backend_wait_fds(wlState, unsafeAddr fds[0], fds.len.cint) < 0:
+      quit "Lost the Wayland connection"
+    if not listener.takeActivations():
+      continue
+
+    # Captured while unmapped, so the overlay is not in the picture.
+    # Mapping only happens on the first present, after the upload.
+    timeline = initTimeline("Activation timeline")
+    var next: ImageData
+    if region:
+      if wl_backend_show(wlState) != 0:
+        quit "Failed to show the overlay"
+      let captured = captureRegion()
+      if captured.isNone:
+        continue
+      next = captured.get
+    else:
+      var activation: BackgroundCapture
+      activation.startCapture()
+      let showStart = nowSeconds()
+      if wl_backend_show(wlState) != 0:
+        quit "Failed to show the overlay"
+      timeline.add("show", showStart, nowSeconds())
+      next = activation.finish()
+      timeline.add("capture", activation.startedAt, activation.finishedAt)
+    upload(next)
+    screenshot.destroy()
+    screenshot = next
+    runSession()
+    wl_backend_hide(wlState)
+    # Whatever arrived while we were shown is not a new request
+    discard listener.takeActivations()
@@ -0,0 +1,816 @@
+## X11 backend for boomer, picked by boomer.nim when there is no Wayland
+## session. Xlib comes from x11_library.nim and XCB from xcb_library.nim,
+## both loaded only once this backend is chosen.
+
+import os
+
+import navigation
+import screenshot
+import config
+import smooth_scroll
+import monitors
+import window_pixmap
+import live_capture
+import frame_limiter
+import clock
+import shader_prelude
+import program_cache
+import gl_library
+
+import x11/xlib except XInitThreads, XOpenDisplay, XCloseDisplay, XSetErrorHandler,
+                       XGetErrorText, XDefaultScreen, XSync, XPending,
+                       XNextEvent, XLookupKeysym, XCreateFontCursor,
+                       XFreeCursor, XGrabPointer, XUngrabPointer,
+                       XGrabKeyboard, XUngrabKeyboard, XSetInputFocus,
+                       XCreateColormap, XCreateWindow, XMapWindow,
+                       XStoreName, XSetWMProtocols, XCreateImage
+import x11/xutil except XSetClassHint
+import x11/x,
+       x11/keysym,
+       x11/cursorfont
+import x11_library, xcb_library, glx_library
+import la
+import strutils
+import math
+import options
+
+type Shader = tuple[path, content: string]
+
+proc readShader(file: string): Shader =
+  when nimvm:
+    result.path = file
+    result.content = slurp result.path
+  else:
+    result.path = "src" / file
+    result.content = readFile result.path
+
+when defined(developer):
+  var
+    vertexShader = readShader "vert.glsl"
+    fragmentShader = readShader "frag.glsl"
+
+  proc reloadShader(shader: var Shader) =
+    shader.content = readFile shader.path
+else:
+  const
+    vertexShader = readShader "vert.glsl"
+    fragmentShader = readShader "frag.glsl"
+
+proc newShader(shader: Shader, kind: GLenum): GLuint =
+  result = glCreateShader(kind)
+  var shaderArray = allocCStringArray([shaderPrelude(apiGL, kind), shader.content])
+  glShaderSource(result, 2, shaderArray, nil)
+  glCompileShader(result)
+  deallocCStringArray(shaderArray)
+
+  var success: GLint
+  var infoLog = newString(512).cstring
+  glGetShaderiv(result, GL_COMPILE_STATUS, addr success)
+  if not success.bool:
+    glGetShaderInfoLog(result, 512, nil, infoLog)
+    echo "------------------------------"
+    echo "Error during shader compilation: ", shader.path, ". Log:"
+    echo infoLog
+    echo "------------------------------"
+
+proc newShaderProgram(vertex, fragment: Shader): GLuint =
+  # The cache is keyed by what the driver actually compiles
+  let sources = [shaderPrelude(apiGL, GL_VERTEX_SHADER) & vertex.content,
+                 shaderPrelude(apiGL, GL_FRAGMENT_SHADER) & fragment.content]
+  result = loadProgram(sources)
+  if result != 0:
+    glUseProgram(result)
+    return
+
+  result = glCreateProgram()
+
+  var
+    vertexShader = newShader(vertex, GL_VERTEX_SHADER)
+    fragmentShader = newShader(fragment, GL_FRAGMENT_SHADER)
+
+  glAttachShader(result, vertexShader)
+  glAttachShader(result, fragmentShader)
+
+  markRetrievable(result)
+  glLinkProgram(result)
+
+  glDeleteShader(vertexShader)
+  glDeleteShader(fragmentShader)
+
+  var success: GLint
+  var infoLog = newString(512).cstring
+  glGetProgramiv(result, GL_LINK_STATUS, addr success)
+  if not success.bool:
+    glGetProgramInfoLog(result, 512, nil, infoLog)
+    echo infoLog
+  else:
+    saveProgram(result, sources)
+
+  glUseProgram(result)
+
+type Flashlight = object
+  isEnabled: bool
+  shadow: float32
+  radius: float32
+  deltaRadius: float32
+
+const
+  INITIAL_FL_DELTA_RADIUS = 250.0
+  FL_DELTA_RADIUS_DECELERATION = 10.0
+
+proc update(flashlight: var Flashlight, dt: float32) =
+  if abs(flashlight.deltaRadius) > 1.0:
+    flashlight.radius = max(0.0, flashlight.radius + flashlight.deltaRadius * dt)
+    flashlight.deltaRadius -= flashlight.deltaRadius * FL_DELTA_RADIUS_DECELERATION * dt
+
+  if flashlight.isEnabled:
+    flashlight.shadow = min(flashlight.shadow + 6.0 * dt, 0.8)
+  else:
+    flashlight.shadow = max(flashlight.shadow - 6.0 * dt, 0.0)
+
+proc draw(imageSize: Vec2f, camera: Camera, shader, vao, texture: GLuint,
+          windowSize: Vec2f, mouse: Mouse, flashlight: Flashlight) =
+  glClearColor(0.1, 0.1, 0.1, 1.0)
+  glClear(GL_COLOR_BUFFER_BIT or GL_DEPTH_BUFFER_BIT)
+
+  glUseProgram(shader)
+
+  glUniform2f(glGetUniformLocation(shader, "cameraPos".cstring), camera.position[0], camera.position[1])
+  glUniform1f(glGetUniformLocation(shader, "cameraScale".cstring), camera.scale)
+  glUniform2f(glGetUniformLocation(shader, "screenshotSize".cstring),
+              imageSize.x.float32,
+              imageSize.y.float32)
+  glUniform2f(glGetUniformLocation(shader, "windowSize".cstring),
+              windowSize.x.float32,
+              windowSize.y.float32)
+  glUniform2f(glGetUniformLocation(shader, "cursorPos".cstring),
+              mouse.curr.x.float32,
+              mouse.curr.y.float32)
+  glUniform1f(glGetUniformLocation(shader, "flShadow".cstring), flashlight.shadow)
+  glUniform1f(glGetUniformLocation(shader, "flRadius".cstring), flashlight.radius)
+
+  glBindVertexArray(vao)
+  glDrawElements(GL_TRIANGLES, count = 6, GL_UNSIGNED_INT, indices = nil)
+
+proc selectWindow(display: PDisplay): Window =
+  var cursor = XCreateFontCursor(display, XC_crosshair)
+  defer: discard XFreeCursor(display, cursor)
+
+  var root = DefaultRootWindow(display)
+  discard XGrabPointer(display, root, 0,
+                       ButtonMotionMask or
+                       ButtonPressMask or
+                       ButtonReleaseMask,
+                       GrabModeAsync, GrabModeAsync,
+                       root, cursor,
+                       CurrentTime)
+  defer: discard XUngrabPointer(display, CurrentTime)
+
+  discard XGrabKeyboard(display, root, 0,
+                        GrabModeAsync, GrabModeAsync,
+                        CurrentTime)
+  defer: discard XUngrabKeyboard(display, CurrentTime)
+
+  var event: XEvent
+  while true:
+    discard XNextEvent(display, addr event)
+    case event.theType
+    of ButtonPress:
+      return event.xbutton.subwindow
+    of KeyPress:
+      return root
+    else:
+      discard
+
+  return root
+
+type GLXSwapIntervalEXT = proc (display: PDisplay, drawable: Window,
+                                interval: cint) {.cdecl.}
+
+proc enableLowLatency(display: PDisplay, screen: cint, win: Window): bool =
+  ## Negative intervals from GLX_EXT_swap_control_tear keep vsync but let
+  ## a late frame tear instead of waiting a whole refresh. Without it the
+  ## interval drops to 0 and the caller has to pace frames itself, which
+  ## is what the result tells.
+  let extensions = ($glXQueryExtensionsString(display, screen)).splitWhitespace
+  if "GLX_EXT_swap_control" notin extensions:
+    stderr.writeLine "GLX_EXT_swap_control is not supported, keeping vsync"
+    return false
+  let swapInterval = cast[GLXSwapIntervalEXT](getGLXProcAddress("glXSwapIntervalEXT"))
+  if swapInterval == nil:
+    return false
+  if "GLX_EXT_swap_control_tear" in extensions:
+    swapInterval(display, win, -1)
+    return false
+  swapInterval(display, win, 0)
+  return true
+
+type
+  GLXSwapBuffersMscOML = proc (display: PDisplay, drawable: Window,
+                               targetMsc, divisor, remainder: int64): int64
+                              {.cdecl.}
+  GLXWaitForSbcOML = proc (display: PDisplay, drawable: Window,
+                           targetSbc: int64, ust, msc, sbc: ptr int64): cint
+                          {.cdecl.}
+
+  SwapPacer = object
+    ## GLX_OML_sync_control counts swaps (SBC) and refreshes (MSC) on the
+    ## client side, so waiting on them costs no request to the server
+    swapBuffersMsc: GLXSwapBuffersMscOML
+    waitForSbc: GLXWaitForSbcOML
+    previous: int64     # SBC of the swap before the latest one
+    lastMsc: int64      # MSC at which `previous` was shown
+
+proc initSwapPacer(display: PDisplay, screen: cint): SwapPacer =
+  let extensions = ($glXQueryExtensionsString(display, screen)).splitWhitespace
+  if "GLX_OML_sync_control" notin extensions:
+    stderr.writeLine "GLX_OML_sync_control is not supported, frames are paced by the driver"
+    return
+  result.swapBuffersMsc = cast[GLXSwapBuffersMscOML](getGLXProcAddress("glXSwapBuffersMscOML"))
+  result.waitForSbc = cast[GLXWaitForSbcOML](getGLXProcAddress("glXWaitForSbcOML"))
+
+proc swap(pacer: var SwapPacer, display: PDisplay, win: Window): int =
+  ## Queues the frame for the next refresh, then waits for the previous
+  ## one to reach the screen, so at most one frame is ever queued. Returns
+  ## how many refreshes the previous frame stayed up, 1 when unknown.
+  result = 1
+  if pacer.swapBuffersMsc == nil or pacer.waitForSbc == nil:
+    glXSwapBuffers(display, win)
+    return
+  # A target of 0 means the next refresh the swap interval allows
+  let sbc = pacer.swapBuffersMsc(display, win, 0, 0, 0)
+  if pacer.previous > 0:
+    var ust, msc, completed: int64
+    if pacer.waitForSbc(display, win, pacer.previous,
+                        addr ust, addr msc, addr completed) != 0:
+      if pacer.lastMsc > 0 and msc > pacer.lastMsc:
+        result = int(msc - pacer.lastMsc)
+      pacer.lastMsc = msc
+  pacer.previous = sbc
+
+proc xElevenErrorHandler(display: PDisplay, errorEvent: PXErrorEvent): cint{.cdecl.} =
+  const CAPACITY = 256
+  var errorMessage: array[CAPACITY, char]
+  discard XGetErrorText(display, errorEvent.error_code.cint, cast[cstring](addr errorMessage), CAPACITY)
+  echo "X ELEVEN ERROR: ", $(cast[cstring](addr errorMessage))
+
+proc mainX11*() =
+  let boomerDir = getConfigDir() / "boomer"
+  var configFile = boomerDir / "config"
+  var windowed = false
+  var lowLatency = false
+  var allMonitors = false
+  var delaySec = 0.0
+
+  # TODO(#95): Make boomer optionally wait for some kind of event (for example, key press)
+  block:
+    proc versionQuit() =
+      const hash = gorgeEx("git rev-parse HEAD")
+      quit "boomer-$#" % [if hash.exitCode == 0: hash.output[0 .. 7] else: "unknown"]
+    proc usageQuit() =
+      quit """Usage: boomer [OPTIONS]
+  -d, --delay <seconds: float>  delay execution of the program by provided <seconds>
+  -h, --help                    show this help and exit
+      --new-config [filepath]   generate a new default config at [filepath]
+  -c, --config <filepath>       use config at <filepath>
+  -V, --version                 show the current version and exit
+  -w, --windowed                windowed mode instead of fullscreen
+      --all-monitors            capture and cover every monitor, not only the one under the pointer
+      --low-latency             present without vsync, tearing is allowed
+      --build-pyramid <path>    write <path>.pyramid, which --image on
+                                Wayland loads tile by tile, and exit"""
+    var i = 1
+    while i <= paramCount():
+      let arg = paramStr(i)
+
+      template asParam(paramVar: untyped, body: untyped) =
+        if i + 1 > paramCount():
+          echo "No value is provided for $#" % [arg]
+          usageQuit()
+        let paramVar = paramStr(i + 1)
+        body
+        i += 2
+
+      template asFlag(body: untyped) =
+        body
+        i += 1
+
+      case arg
+      of "-d", "--delay":
+        asParam(delayParam):
+          delaySec = parseFloat(delayParam)
+      of "-w", "--windowed":
+        asFlag():
+          windowed = true
+      of "--low-latency":
+        asFlag():
+          lowLatency = true
+      of "--all-monitors":
+        asFlag():
+          allMonitors = true
+      of "-h", "--help":
+        asFlag():
+          usageQuit()
+      of "-V", "--version":
+        asFlag():
+          versionQuit()
+      of "--new-config":
+        var configName = none(string)
+        if i + 1 <= paramCount():
+          let param = paramStr(i + 1)
+          if len(param) > 0 and param[0] != '-':
+            configName = some(param)
+
+        let newConfigPath = configName.get(configFile)
+
+        createDir(newConfigPath.splitFile.dir)
+        if newConfigPath.fileExists:
+          stdout.write("File ", newConfigPath, " already exists. Replace it? [yn] ")
+          if stdin.readChar != 'y':
+            quit "Disaster prevented"
+
+        generateDefaultConfig(newConfigPath)
+        quit "Generated config at $#" % [newConfigPath]
+      of "-c", "--config":
+        asParam(configParam):
+          configFile = configParam
+      else:
+        echo "Unknown flag `$#`" % [arg]
+        usageQuit()
+  sleep(floor(delaySec * 1000).int)
+
+  var config = defaultConfig
+
+  if fileExists configFile:
+    config = loadConfig(configFile)
+  else:
+    stderr.writeLine configFile & " doesn't exist. Using default values. "
+
+  echo "Using config: ", config
+
+  when defined(live):
+    # Live capture has a connection of its own on another thread
+    discard XInitThreads()
+
+  var display = XOpenDisplay(nil)
+  if display == nil:
+    quit "Failed to open display"
+  defer:
+    discard XCloseDisplay(display)
+
+  discard XSetErrorHandler(xElevenErrorHandler)
+
+  when defined(select):
+    echo "Please select window:"
+    var trackingWindow = selectWindow(display)
+  else:
+    var trackingWindow = DefaultRootWindow(display)
+
+  let screen = XDefaultScreen(display)
+  let root = DefaultRootWindow(display)
+  # Known from the connection setup, no need to ask
+  let rootWidth = ScreenOfDisplay(display, screen).width
+  let rootHeight = ScreenOfDisplay(display, screen).height
+
+  # Everything startup has to ask the server is sent at once and each reply
+  # is collected where it is used, so they share a round trip. Only the
+  # monitor layout takes a second one, and the capture has to wait for it.
+  let xcb = XGetXCBConnection(display)
+  const deleteWindowName = "WM_DELETE_WINDOW"
+  let
+    pointerCookie = xcb_query_pointer(xcb, root.uint32)
+    focusCookie = xcb_get_input_focus(xcb)
+    deleteWindowCookie = xcb_intern_atom(xcb, 0,
+                                         deleteWindowName.len.uint16,
+                                         deleteWindowName)
+    screenInfoCookie = xcb_randr_get_screen_info(xcb, root.uint32)
+    monitorsCookie = requestMonitors(xcb, root.uint32)
+  discard xcb_flush(xcb)
+
+  var pointerPosition = vec2(0.0'f32, 0.0)
+  block:
+    let reply = xcb_query_pointer_reply(xcb, pointerCookie, nil)
+    if reply != nil:
+      pointerPosition = vec2(reply.rootX.float32, reply.rootY.float32)
+      xcbFree(reply)
+
+  # The root window spans every monitor. Capturing and covering just the
+  # one under the pointer moves a fraction of the pixels, and its own mode
+  # gives the rate to pace frames at.
+  var monitor = Monitor(width: rootWidth.int, height: rootHeight.int)
+  block:
+    let screenInfo = xcb_randr_get_screen_info_reply(xcb, screenInfoCookie,
+                                                     nil)
+    if screenInfo != nil:
+      monitor.rate = screenInfo.rate.int
+      xcbFree(screenInfo)
+  let layout = finishMonitors(xcb, monitorsCookie)
+  if not allMonitors:
+    for candidate in layout:
+      if candidate.contains(pointerPosition.x.int, pointerPosition.y.int):
+        monitor = candidate
+        break
+  if monitor.rate <= 0:
+    monitor.rate = 60
+  let rate = monitor.rate
+  echo "Screen rate: ", rate
+
+  # Sent before our window exists, so it can't show up in the capture
+  let captureRequest =
+    if trackingWindow == root:
+      requestScreenshot(display, trackingWindow,
+                        (monitor.x, monitor.y, monitor.width, monitor.height),
+                        wholeWindow = false)
+    else:
+      let size = geometry(display, trackingWindow)
+      requestScreenshot(display, trackingWindow,
+                        (0, 0, size.width, size.height))
+  discard xcb_flush(xcb)
+
+  var glxMajor, glxMinor: cint
+
+  if (glXQueryVersion(display, addr glxMajor, addr glxMinor) == 0 or
+      (glxMajor == 1.cint and glxMinor < 3.cint) or
+      (glxMajor < 1.cint)):
+    quit "Invalid GLX version. Expected >=1.3"
+  echo("GLX version ", glxMajor, ".", glxMinor)
+  echo("GLX extension: ", glXQueryExtensionsString(display, screen))
+
+  var attrs = [
+    GLX_RGBA,
+    GLX_DEPTH_SIZE, 24,
+    GLX_DOUBLEBUFFER,
+    None
+  ]
+
+  var vi = glXChooseVisual(display, 0, addr attrs[0])
+  if vi == nil:
+    quit "No appropriate visual found"
+
+
+  echo "Visual ", vi.visualid, " selected"
+  var swa: XSetWindowAttributes
+  swa.colormap = XCreateColormap(display, DefaultRootWindow(display),
+                                 vi.visual, AllocNone)
+  # StructureNotify brings the size (ConfigureNotify) and MapNotify,
+  # so neither has to be asked for
+  swa.event_mask = ButtonPressMask or ButtonReleaseMask or
+                   KeyPressMask or KeyReleaseMask or
+                   PointerMotionMask or ExposureMask or ClientMessage or
+                   StructureNotifyMask
+  if not windowed:
+    swa.override_redirect = 1
+    swa.save_under = 1
+
+  var win = XCreateWindow(
+    display, DefaultRootWindow(display),
+    monitor.x.cint, monitor.y.cint,
+    monitor.width.cuint, monitor.height.cuint, 0,
+    vi.depth, InputOutput, vi.visual,
+    CWColormap or CWEventMask or CWOverrideRedirect or CWSaveUnder, addr swa)
+
+  discard XMapWindow(display, win)
+
+  var smoothScroll = initSmoothScroll(display, win)
+
+  var wmName = "boomer"
+  var wmClass = "Boomer"
+  var hints = XClassHint(res_name: wmName, res_class: wmClass)
+
+  discard XStoreName(display, win, wmName)
+  discard XSetClassHint(display, win, addr(hints))
+
+  let deleteWindowReply = xcb_intern_atom_reply(xcb, deleteWindowCookie, nil)
+  if deleteWindowReply == nil:
+    quit "Failed to intern " & deleteWindowName
+  var wmDeleteMessage = deleteWindowReply.atom.Atom
+  xcbFree(deleteWindowReply)
+
+  discard XSetWMProtocols(display, win,
+                          addr wmDeleteMessage, 1)
+
+  var glc = glXCreateContext(display, vi, nil, GL_TRUE.cint)
+  discard glXMakeCurrent(display, win, glc)
+
+  let needsLimiter = lowLatency and enableLowLatency(display, screen, win)
+  # Async presentation must not wait for the previous frame either
+  var pacer = if lowLatency: SwapPacer() else: initSwapPacer(display, screen)
+
+  loadGL(proc (name: cstring): pointer = getGLXProcAddress(name))
+
+  var shaderProgram = newShaderProgram(vertexShader, fragmentShader)
+
+  var screenshot = captureRequest.finish(display)
+  defer: screenshot.destroy(display)
+
+  let w = screenshot.image.width.float32
+  let h = screenshot.image.height.float32
+  var
+    vao, vbo, ebo: GLuint
+    vertices = [
+      # Position                 Texture coords
+      [GLfloat    w,     0, 0.0, 1.0, 1.0], # Top right
+      [GLfloat    w,     h, 0.0, 1.0, 0.0], # Bottom right
+      [GLfloat    0,     h, 0.0, 0.0, 0.0], # Bottom left
+      [GLfloat    0,     0, 0.0, 0.0, 1.0]  # Top left
+    ]
+    indices = [GLuint(0), 1, 3,
+                      1,  2, 3]
+
+  glGenVertexArrays(1, addr vao)
+  glGenBuffers(1, addr vbo)
+  glGenBuffers(1, addr ebo)
+  defer:
+    glDeleteVertexArrays(1, addr vao)
+    glDeleteBuffers(1, addr vbo)
+    glDeleteBuffers(1, addr ebo)
+
+  glBindVertexArray(vao)
+
+  glBindBuffer(GL_ARRAY_BUFFER, vbo)
+  glBufferData(GL_ARRAY_BUFFER, size = GLsizeiptr(sizeof(vertices)),
+               addr vertices, GL_STATIC_DRAW)
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, size = GLsizeiptr(sizeof(indices)),
+               addr indices, GL_STATIC_DRAW);
+
+  var stride = GLsizei(vertices[0].len * sizeof(GLfloat))
+
+  glVertexAttribPointer(0, 3, cGL_FLOAT, false, stride, cast[pointer](0))
+  glEnableVertexAttribArray(0)
+
+  glVertexAttribPointer(1, 2, cGL_FLOAT, false, stride, cast[pointer](3 * sizeof(GLfloat)))
+  glEnableVertexAttribArray(1)
+
+  var texture = 0.GLuint
+  glGenTextures(1, addr texture)
+  glActiveTexture(GL_TEXTURE0)
+  glBindTexture(GL_TEXTURE_2D, texture)
+
+  glTexImage2D(GL_TEXTURE_2D,
+               0,
+               GL_RGB.GLint,
+               screenshot.image.width,
+               screenshot.image.height,
+               0,
+               # TODO(#13): the texture format is hardcoded
+               # BGRA bytes, frag.glsl swizzles them back
+               GL_RGBA,
+               GL_UNSIGNED_BYTE,
+               screenshot.image.data)
+  glGenerateMipmap(GL_TEXTURE_2D)
+
+  glUniform1i(glGetUniformLocation(shaderProgram, "tex".cstring), 0)
+
+  glEnable(GL_TEXTURE_2D)
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST)
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST)
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER)
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER)
+
+  var imageSize = vec2(w, h)
+
+  when defined(live):
+    # A tracked window (-d:select) is shown straight from its pixmap when
+    # the server and driver allow it, the root window is always copied
+    var windowPixmap: WindowPixmap
+    let zeroCopy = initWindowPixmap(display, screen, root, trackingWindow,
+                                    windowPixmap)
+    if zeroCopy:
+      windowPixmap.bindTexture()
+    defer: windowPixmap.destroy()
+
+    var liveCapture: LiveCapture
+    if not zeroCopy:
+      liveCapture.start(trackingWindow, screenshot,
+                        if config.capture_rate > 0: config.capture_rate
+                        else: rate)
+    defer: liveCapture.stop()
+
+  var
+    quitting = false
+    camera = Camera(scale: 1.0)
+    mouse: Mouse =
+      block:
+        # Events come relative to our window, which starts at the monitor
+        let pos = pointerPosition - vec2(monitor.x.float32, monitor.y.float32)
+        Mouse(curr: pos, prev: pos)
+    flashlight = Flashlight(
+      isEnabled: false,
+      radius: 200.0)
+
+
+  let dt = 1.0 / rate.float
+  var originWindow: Window = None
+  block:
+    let reply = xcb_get_input_focus_reply(xcb, focusCookie, nil)
+    if reply != nil:
+      originWindow = reply.focus.Window
+      xcbFree(reply)
+  var pointer = mouse.curr
+  var limiter = initFrameLimiter(rate.int)
+  # Updated from ConfigureNotify, the window starts out covering the monitor
+  var windowSize = vec2(monitor.width.float32, monitor.height.float32)
+  var viewportSize = vec2(0.0'f32, 0.0)
+  var keyboardGrabbed = false
+  var refreshes = 1
+  while not quitting:
+    if windowSize != viewportSize:
+      glViewport(0, 0, windowSize.x.GLsizei, windowSize.y.GLsizei)
+      viewportSize = windowSize
+
+    let now = nowSeconds()
+    var released = false
+    var xev: XEvent
+    while XPending(display) > 0:
+      discard XNextEvent(display, addr xev)
+
+      proc scroll(notches: float, ctrl: bool) =
+        if ctrl and flashlight.isEnabled:
+          flashlight.deltaRadius += float32(INITIAL_FL_DELTA_RADIUS * notches)
+        else:
+          camera.deltaScale += config.scrollSpeed * notches
+          camera.scalePivot = pointer
+
+      proc pointerMoved(pos: Vec2f, time: float) =
+        pointer = pos
+        mouse.history.push(time, pos, now)
+
+      template ctrlHeld(): bool =
+        (xev.xkey.state and ControlMask) > 0.uint32
+
+      let xi = smoothScroll.processEvent(display, xev)
+      if xi.moved:
+        pointerMoved(xi.pos, xi.time)
+      if xi.scroll != 0.0:
+        scroll(xi.scroll, xi.ctrl)
+
+      case xev.theType
+      of Expose:
+        discard
+
+      of ConfigureNotify:
+        if xev.xconfigure.window == win:
+          windowSize = vec2(xev.xconfigure.width.float32,
+                            xev.xconfigure.height.float32)
+        when defined(live):
+          if zeroCopy and xev.xconfigure.window == trackingWindow:
+            windowPixmap.resize(xev.xconfigure.width.int,
+                                xev.xconfigure.height.int)
+
+      of MapNotify:
+        # The override-redirect window gets no focus from the window
+        # manager. One grab keeps the keyboard for the whole session;
+        # it can only be taken once the window is viewable.
+        if not windowed and not keyboardGrabbed and xev.xmap.window == win:
+          keyboardGrabbed = XGrabKeyboard(display, win, 1,
+                                          GrabModeAsync, GrabModeAsync,
+                                          CurrentTime) == GrabSuccess
+          if not keyboardGrabbed:
+            discard XSetInputFocus(display, win, RevertToParent, CurrentTime)
+
+      of MotionNotify:
+        pointerMoved(vec2(xev.xmotion.x.float32,
+                          xev.xmotion.y.float32),
+                     xev.xmotion.time.float / 1000.0)
+
+      of ClientMessage:
+        if cast[Atom](xev.xclient.data.l[0]) == wmDeleteMessage:
+          quitting = true
+
+      of KeyPress:
+        var key = XLookupKeysym(cast[PXKeyEvent](xev.addr), 0)
+        case key
+        of XK_EQUAL: scroll(1.0, ctrlHeld())
+        of XK_MINUS: scroll(-1.0, ctrlHeld())
+        of XK_0:
+          camera.scale = 1.0
+          camera.deltaScale = 0.0
+          camera.position = vec2(0.0'f32, 0.0)
+          camera.velocity = vec2(0.0'f32, 0.0)
+        of XK_q, XK_Escape:
+          quitting = true
+        of XK_r:
+          if configFile.len > 0 and fileExists(configFile):
+            config = loadConfig(configFile)
+
+          when defined(developer):
+            if (xev.xkey.state and ControlMask) > 0.uint32:
+              echo "------------------------------"
+              echo "RELOADING SHADERS"
+              try:
+                reloadShader(vertexShader)
+                reloadShader(fragmentShader)
+                let newShaderProgram = newShaderProgram(vertexShader, fragmentShader)
+                glDeleteProgram(shaderProgram)
+                shaderProgram = newShaderProgram
+                echo "Shader program ID: ", shaderProgram
+              except GLerror:
+                echo "Could not reload the shaders"
+              echo "------------------------------"
+
+        of XK_f:
+          flashlight.isEnabled = not flashlight.isEnabled
+        else:
+          discard
+
+      of ButtonPress:
+        case xev.xbutton.button
+        of Button1:
+          pointer = vec2(xev.xbutton.x.float32, xev.xbutton.y.float32)
+          camera.startDrag(mouse, pointer)
+        # With XI2 the same wheel motion also arrives as smooth
+        # scroll valuators, so the emulated clicks are dropped
+        of Button4:
+          if not smoothScroll.enabled: scroll(1.0, ctrlHeld())
+        of Button5:
+          if not smoothScroll.enabled: scroll(-1.0, ctrlHeld())
+        else:
+          discard
+
+      of ButtonRelease:
+        case xev.xbutton.button
+        of Button1:
+          released = true
+        else:
+          discard
+      else:
+        discard
+
+    # Predict where the pointer will be when this frame is presented
+    camera.drag(mouse, pointer, now, now + dt, released)
+
+    # A frame that missed refreshes has to catch up on their motion, up
+    # to a point: a window that was not shown for a while shouldn't jump
+    let frameDt = dt * min(refreshes, 4).float
+    camera.update(config, frameDt, mouse, windowSize)
+    when defined(live):
+      if not zeroCopy:
+        liveCapture.follow(camera.visibleRect(imageSize, windowSize))
+    flashlight.update(frameDt)
+
+    imageSize.draw(camera, shaderProgram, vao, texture,
+                   windowSize, mouse, flashlight)
+
+    refreshes = pacer.swap(display, win)
+
+    if needsLimiter:
+      limiter.wait()
+
+    when defined(live):
+      var size = imageSize
+      if zeroCopy:
+        windowPixmap.update()
+        size = vec2(windowPixmap.width.float32, windowPixmap.height.float32)
+      else:
+        # Whatever the worker finished last, never waiting for the next one
+        let latest = liveCapture.latest()
+        if latest != nil and not latest.wholeWindow:
+          # Only the part around the view, into the full-size texture
+          glTexSubImage2D(GL_TEXTURE_2D,
+                          0,
+                          GLint(latest.area.x - screenshot.area.x),
+                          GLint(latest.area.y - screenshot.area.y),
+                          latest.image.width,
+                          latest.image.height,
+                          GL_RGBA,
+                          GL_UNSIGNED_BYTE,
+                          latest.image.data)
+        elif latest != nil:
+          glTexImage2D(GL_TEXTURE_2D,
+                       0,
+                       GL_RGB.GLint,
+                       latest.image.width,
+                       latest.image.height,
+                       0,
+                       # TODO(#13): the texture format is hardcoded
+                       GL_RGBA,
+                       GL_UNSIGNED_BYTE,
+                       latest.image.data)
+          size = vec2(latest.image.width.float32,
+                      latest.image.height.float32)
+
+      if size != imageSize:
+        imageSize = size
+        # TODO(#90): don't update the vbo on screenshot refresh
+        # I'm pretty sure we can avoid that if we make independent from
+        # the size of the window as it was in the beginning. (I simply did
+        # not expect this use case back then Kappa)
+        var
+          vertices = [
+            # Position                           Texture coords
+            [GLfloat imageSize.x,           0, 0.0, 1.0, 1.0], # Top right
+            [GLfloat imageSize.x, imageSize.y, 0.0, 1.0, 0.0], # Bottom right
+            [GLfloat           0, imageSize.y, 0.0, 0.0, 0.0], # Bottom left
+            [GLfloat           0,           0, 0.0, 0.0, 1.0]  # Top left
+          ]
+        glBindBuffer(GL_ARRAY_BUFFER, vbo)
+        glBufferData(GL_ARRAY_BUFFER, size = GLsizeiptr(sizeof(vertices)),
+                     addr vertices, GL_STATIC_DRAW)
+  if keyboardGrabbed:
+    discard XUngrabKeyboard(display, CurrentTime)
+  if originWindow != None:
+    discard XSetInputFocus(display, originWindow, RevertToParent, CurrentTime)
+  discard XSync(display, 0)
@@ -0,0 +1,7 @@
+## Monotonic wall clock shared by frame pacing, input prediction and the
+## startup timeline.
+
+import monotimes
+
+proc nowSeconds*(): float =
+  getMonoTime().ticks.float / 1e9
@@ -5,12 +5,18 @@ type Config* = object
   scroll_speed*: float
   drag_friction*: float
   scale_friction*: float
+  capture_rate*: int   # live captures per second, 0 for the display rate
+  lens_size*: int      # --lens side, logical pixels
+  lens_zoom*: float
 
 const defaultConfig* = Config(
   min_scale: 0.01,
   scroll_speed: 1.5,
   drag_friction: 6.0,
   scale_friction: 4.0,
+  capture_rate: 0,
+  lens_size: 256,
+  lens_zoom: 3.0,
 )
 
 proc loadConfig*(filePath: string): Config =
@@ -31,6 +37,12 @@ proc loadConfig*(filePath: string): Config =
       result.drag_friction = parseFloat(value)
     of "scale_friction":
       result.scale_friction = parseFloat(value)
+    of "capture_rate":
+      result.capture_rate = parseInt(value)
+    of "lens_size":
+      result.lens_size = parseInt(value)
+    of "lens_zoom":
+      result.lens_zoom = parseFloat(value)
     else:
       quit "Unknown config key `$#`" % [key]
 
@@ -41,3 +53,6 @@ proc generateDefaultConfig*(filePath: string) =
   f.write("scroll_speed = ", defaultConfig.scroll_speed, "\n")
   f.write("drag_friction = ", defaultConfig.drag_friction, "\n")
   f.write("scale_friction = ", defaultConfig.scale_friction, "\n")
+  f.write("capture_rate = ", defaultConfig.capture_rate, "\n")
+  f.write("lens_size = ", defaultConfig.lens_size, "\n")
+  f.write("lens_zoom = ", defaultConfig.lens_zoom, "\n")
@@ -0,0 +1,103 @@
+## Resident mode for the Wayland backend. `boomer --daemon` keeps the
+## connection, the GL context, the shader program and the texture storage
+## alive with the surface unmapped. Running `boomer` again, or sending the
+## daemon SIGUSR1, captures the screen and shows the overlay.
+
+import os
+import posix
+
+type Daemon* = object
+  listener: SocketHandle
+  signalPipe: array[2, cint]
+
+var signalWriteFd: cint = -1
+
+proc onSignal(sig: cint) {.noconv.} =
+  var wake = 's'
+  discard posix.write(signalWriteFd, addr wake, 1)
+
+proc socketPath*(): string =
+  ## Empty when there is no XDG_RUNTIME_DIR to put the socket in
+  let runtimeDir = getEnv("XDG_RUNTIME_DIR")
+  if runtimeDir.len == 0: "" else: runtimeDir / "boomer.sock"
+
+proc unixAddress(path: string, address: var Sockaddr_un): bool =
+  if path.len >= address.sun_path.len:
+    return false
+  address.sun_family = TSa_Family(AF_UNIX)
+  for i, c in path:
+    address.sun_path[i] = c
+  address.sun_path[path.len] = '\0'
+  true
+
+proc setNonBlocking(fd: cint) =
+  discard fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) or O_NONBLOCK)
+  discard fcntl(fd, F_SETFD, FD_CLOEXEC)
+
+proc connectDaemon(path: string): bool =
+  var address: Sockaddr_un
+  if not unixAddress(path, address):
+    return false
+  let fd = socket(AF_UNIX, SOCK_STREAM, 0)
+  if fd.cint < 0:
+    return false
+  # Connecting is the whole request, the daemon doesn't read anything
+  result = connect(fd, cast[ptr SockAddr](addr address),
+                   SockLen(sizeof(address))) == 0
+  discard close(fd.cint)
+
+proc activateDaemon*(): bool =
+  ## Asks a running daemon to show itself. False when there is none,
+  ## including a stale socket left behind by one that crashed.
+  let path = socketPath()
+  path.len > 0 and connectDaemon(path)
+
+proc initDaemon*(): Daemon =
+  let path = socketPath()
+  if path.len == 0:
+    quit "--daemon needs XDG_RUNTIME_DIR for its socket"
+  if connectDaemon(path):
+    quit "A boomer daemon is already listening on " & path
+  discard unlink(path.cstring)
+
+  var address: Sockaddr_un
+  if not unixAddress(path, address):
+    quit "Socket path is too long: " & path
+  result.listener = socket(AF_UNIX, SOCK_STREAM, 0)
+  if result.listener.cint < 0 or
+     bindSocket(result.listener, cast[ptr SockAddr](addr address),
+                SockLen(sizeof(address))) != 0 or
+     listen(result.listener, 8) != 0:
+    quit "Can't listen on " & path & ": " & $strerror(errno)
+  setNonBlocking(result.listener.cint)
+
+  if pipe(result.signalPipe) != 0:
+    quit "Can't create the signal pipe: " & $strerror(errno)
+  setNonBlocking(result.signalPipe[0])
+  setNonBlocking(result.signalPipe[1])
+  signalWriteFd = result.signalPipe[1]
+  signal(SIGUSR1, onSignal)
+
+proc destroy*(daemon: var Daemon) =
+  signal(SIGUSR1, SIG_DFL)
+  signalWriteFd = -1
+  discard close(daemon.listener.cint)
+  discard close(daemon.signalPipe[0])
+  discard close(daemon.signalPipe[1])
+  discard unlink(socketPath().cstring)
+
+proc fds*(daemon: Daemon): array[2, cint] =
+  ## What to poll on next to the Wayland connection
+  [daemon.listener.cint, daemon.signalPipe[0]]
+
+proc takeActivations*(daemon: Daemon): bool =
+  ## Consumes every pending request, true if there was at least one
+  var buffer: array[64, char]
+  while posix.read(daemon.signalPipe[0], addr buffer, buffer.len) > 0:
+    result = true
+  while true:
+    let client = accept(daemon.listener, nil, nil)
+    if client.cint < 0:
+      break
+    discard close(client.cint)
+    result = true
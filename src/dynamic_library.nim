@@ -0,0 +1,100 @@
+## Libraries that are only loaded once the backend that needs them is
+## picked. `dynamicImport` turns a block of importc declarations into a
+## table of function pointers, wrappers with the original signatures that
+## call through it, and a `loader` proc that fills the table with
+## dlopen/dlsym. Nothing is resolved until the loader runs, and calling a
+## wrapper before it is a nil call.
+##
+##   dynamicImport(loadFoo, ["libfoo.so.1", "libfoo.so"]):
+##     proc foo_open*(name: cstring): pointer {.importc, cdecl.}
+
+import dynlib
+import macros
+
+proc symbolName(def: NimNode): string =
+  ## The importc name when one is given, the proc name otherwise
+  result = $def.name.basename
+  for pragma in def.pragma:
+    if pragma.kind in {nnkExprColonExpr, nnkCall} and
+       pragma[0].eqIdent("importc"):
+      result = pragma[1].strVal
+
+type ImportedProc = tuple[fn, fnType: NimNode, symbol: string]
+
+proc addWrappers(decls: NimNode, body: NimNode): seq[ImportedProc] =
+  ## Adds a function pointer and a wrapper calling through it to `decls`
+  ## for every proc in `body`, anything else as it is
+  for def in body:
+    if def.kind != nnkProcDef:
+      decls.add def
+      continue
+
+    let fnType = nnkProcTy.newTree(def.params.copyNimTree,
+                                   nnkPragma.newTree(ident"cdecl",
+                                                     ident"gcsafe"))
+    let fn = genSym(nskVar, def.symbolName)
+    decls.add nnkVarSection.newTree(
+      nnkIdentDefs.newTree(fn, fnType, newEmptyNode()))
+
+    var call = newCall(fn)
+    for i in 1 ..< def.params.len:
+      let identDefs = def.params[i]
+      for j in 0 ..< identDefs.len - 2:
+        call.add identDefs[j]
+    var wrapper = def.copyNimTree
+    wrapper.pragma = nnkPragma.newTree(ident"inline")
+    wrapper.body = newStmtList(call)
+    decls.add wrapper
+    result.add (fn, fnType, def.symbolName)
+
+macro dynamicImport*(loader: untyped, libraries: typed,
+                     body: untyped): untyped =
+  ## `libraries` are tried in order and may be computed at runtime.
+  ## The loader returns false, with the reason on stderr, when none of
+  ## them opens or one of the symbols is missing.
+  result = newStmtList()
+  let handle = genSym(nskVar, "handle")
+  let library = genSym(nskForVar, "library")
+  var resolve = newStmtList()
+
+  for (fn, fnType, symbol) in result.addWrappers(body):
+    resolve.add quote do:
+      `fn` = cast[`fnType`](symAddr(`handle`, `symbol`))
+      if `fn` == nil:
+        stderr.writeLine "Missing symbol ", `symbol`
+        unloadLib(`handle`)
+        return false
+
+  result.add quote do:
+    proc `loader`*(): bool =
+      var `handle`: LibHandle = nil
+      for `library` in `libraries`:
+        `handle` = loadLib(`library`)
+        if `handle` != nil:
+          break
+      if `handle` == nil:
+        stderr.writeLine "Could not load any of ", `libraries`
+        return false
+      `resolve`
+      true
+
+macro contextImport*(loader: untyped, body: untyped): untyped =
+  ## The same for entry points that belong to a context rather than to a
+  ## library, GL's. The loader takes the proc that looks them up and runs
+  ## once the context is current. What the context lacks stays nil, so,
+  ## as with any GL loader, callers check the version before using it.
+  ##
+  ##   contextImport(loadFoo):
+  ##     proc fooDraw*(count: cint) {.importc, cdecl.}
+  ##   loadFoo(proc (name: cstring): pointer = lookup(name))
+  result = newStmtList()
+  let getProc = genSym(nskParam, "getProc")
+  var resolve = newStmtList()
+
+  for (fn, fnType, symbol) in result.addWrappers(body):
+    resolve.add quote do:
+      `fn` = cast[`fnType`](`getProc`(`symbol`))
+
+  result.add quote do:
+    proc `loader`*(`getProc`: proc (name: cstring): pointer) =
+      `resolve`
@@ -0,0 +1,129 @@
+## Adaptive render resolution for the GL renderer. While the view moves
+## fast, frames are drawn into a smaller offscreen framebuffer and
+## stretched onto the surface; the moment it stops, rendering goes back
+## to native resolution.
+
+import gl_library
+import math
+import strutils
+import la
+import clock
+import shader_prelude
+
+const
+  MIN_RENDER_SCALE = 0.5
+  FAST_PAN = 300.0    # window pixels per second
+  FAST_ZOOM = 0.5     # relative scale change per second
+  TIMER_QUERIES = 3   # results are read two frames late, never waited on
+
+type
+  GpuTimer = object
+    queries: array[TIMER_QUERIES, GLuint]
+    pending: array[TIMER_QUERIES, bool]
+    index: int
+    running: bool
+
+  DynamicResolution* = object
+    enabled*: bool
+    scale*: float       # of the window size per axis, 1.0 is native
+    budget: float       # seconds per frame
+    useTimer: bool
+    timer: GpuTimer
+    moving: bool
+    frameTime: float    # latest measurement, 0 while there is none
+    lastFrame: float    # nowSeconds() of the previous frame, CPU fallback
+
+proc hasTimerQuery(api: GLApi): bool =
+  ## GL_TIME_ELAPSED is core since desktop GL 3.3. GLES only has it as
+  ## EXT_disjoint_timer_query, which uses the CPU fallback instead.
+  if api != apiGL:
+    return false
+  let version = ($cast[cstring](glGetString(GL_VERSION))).split({' ', '.'})
+  try:
+    result = version.len >= 2 and
+             (parseInt(version[0]), parseInt(version[1])) >= (3, 3)
+  except ValueError:
+    result = false
+
+proc initDynamicResolution*(api: GLApi, rate: int): DynamicResolution =
+  ## Needs a current context. Blitting the offscreen framebuffer needs
+  ## GL 3.0 or GLES 3, so there is no dynamic resolution on GLES 2.
+  result.enabled = api != apiGLES2
+  result.scale = 1.0
+  result.budget = 1.0 / max(rate, 1).float
+  result.useTimer = hasTimerQuery(api)
+  if result.useTimer:
+    glGenQueries(TIMER_QUERIES, addr result.timer.queries[0])
+
+proc destroy*(dr: var DynamicResolution) =
+  if dr.useTimer:
+    glDeleteQueries(TIMER_QUERIES, addr dr.timer.queries[0])
+
+proc isFastMotion*(prevOrigin, origin: Vec2f, prevScale, scale: float32,
+                   dt: float): bool =
+  ## Pans faster than FAST_PAN window pixels per second, or zooms faster
+  ## than FAST_ZOOM of the current scale per second
+  if prevScale <= 0.0:
+    return false
+  (origin - prevOrigin).length * scale > FAST_PAN * dt or
+    abs(scale / prevScale - 1.0) > FAST_ZOOM * dt
+
+proc beginFrame*(dr: var DynamicResolution, moving: bool) =
+  ## Starts timing the GL work of this frame. A still view is always
+  ## drawn at native resolution. A query slot whose result hasn't arrived
+  ## yet is skipped rather than waited on.
+  if not dr.enabled:
+    return
+  dr.moving = moving
+  if not moving:
+    dr.scale = 1.0
+  if not dr.useTimer:
+    return
+  let i = dr.timer.index
+  let query = dr.timer.queries[i]
+  if dr.timer.pending[i]:
+    var available: GLint
+    glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, addr available)
+    if available == 0:
+      return
+    var elapsed: GLuint64
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, addr elapsed)
+    dr.frameTime = elapsed.float / 1e9
+    dr.timer.pending[i] = false
+  glBeginQuery(GL_TIME_ELAPSED, query)
+  dr.timer.running = true
+
+proc endFrame*(dr: var DynamicResolution) =
+  ## Picks the render scale for the next frame. Shrinks in proportion to
+  ## the overrun (cost goes with the pixel count, so with scale squared)
+  ## and grows back gently while there is headroom.
+  if not dr.enabled:
+    return
+  if dr.useTimer and dr.timer.running:
+    glEndQuery(GL_TIME_ELAPSED)
+    dr.timer.pending[dr.timer.index] = true
+    dr.timer.index = (dr.timer.index + 1) mod TIMER_QUERIES
+    dr.timer.running = false
+  elif not dr.useTimer:
+    # Without timers the interval between frames is the best we have.
+    # With vsync it is about the budget for every frame that made its
+    # refresh, and well past it only for one that missed it.
+    let now = nowSeconds()
+    if dr.lastFrame > 0.0:
+      dr.frameTime = now - dr.lastFrame
+    dr.lastFrame = now
+
+  if not dr.moving:
+    return
+  let (overrun, headroom) = if dr.useTimer: (0.9, 0.6) else: (1.5, 1.1)
+  if dr.frameTime > dr.budget * overrun:
+    dr.scale = max(MIN_RENDER_SCALE,
+                   dr.scale * sqrt(dr.budget * 0.8 / dr.frameTime))
+  elif dr.frameTime > 0.0 and dr.frameTime < dr.budget * headroom:
+    dr.scale = min(1.0, dr.scale * 1.05)
+
+proc renderSize*(dr: DynamicResolution, windowSize: Vec2f): Vec2f =
+  if not dr.enabled or dr.scale >= 1.0:
+    return windowSize
+  vec2(max(1.0, round(windowSize.x * dr.scale)).float32,
+       max(1.0, round(windowSize.y * dr.scale)).float32)
@@ -0,0 +1,330 @@
+/* Generated by wayland-scanner 1.24.0 */
+
+#ifndef EXT_FOREIGN_TOPLEVEL_LIST_V1_CLIENT_PROTOCOL_H
+#define EXT_FOREIGN_TOPLEVEL_LIST_V1_CLIENT_PROTOCOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "wayland-client.h"
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @page page_ext_foreign_toplevel_list_v1 The ext_foreign_toplevel_list_v1 protocol
+ * list toplevels
+ *
+ * @section page_desc_ext_foreign_toplevel_list_v1 Description
+ *
+ * The purpose of this protocol is to provide protocol object handles for
+ * toplevels, possibly originating from another client.
+ *
+ * This protocol is intentionally minimalistic and expects additional
+ * functionality (e.g. creating a screencopy source from a toplevel handle,
+ * getting information about the state of the toplevel) to be implemented
+ * in extension protocols.
+ *
+ * @section page_ifaces_ext_foreign_toplevel_list_v1 Interfaces
+ * - @subpage page_iface_ext_foreign_toplevel_list_v1 - list toplevels
+ * - @subpage page_iface_ext_foreign_toplevel_handle_v1 - a mapped toplevel
+ * @section page_copyright_ext_foreign_toplevel_list_v1 Copyright
+ * <pre>
+ *
+ * Copyright © 2018 Ilia Bozhinov
+ * Copyright © 2020 Isaac Freund
+ * Copyright © 2022 wb9688
+ * Copyright © 2023 i509VCB
+ *
+ * Permission to use, copy, modify, distribute, and sell this
+ * software and its documentation for any purpose is hereby granted
+ * without fee, provided that the above copyright notice appear in
+ * all copies and that both that copyright notice and this permission
+ * notice appear in supporting documentation, and that the name of
+ * the copyright holders not be used in advertising or publicity
+ * pertaining to distribution of the software without specific,
+ * written prior permission.  The copyright holders make no
+ * representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ * AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ * ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+ * THIS SOFTWARE.
+ * </pre>
+ */
+struct ext_foreign_toplevel_handle_v1;
+struct ext_foreign_toplevel_list_v1;
+
+#ifndef EXT_FOREIGN_TOPLEVEL_LIST_V1_INTERFACE
+#define EXT_FOREIGN_TOPLEVEL_LIST_V1_INTERFACE
+/**
+ * @page page_iface_ext_foreign_toplevel_list_v1 ext_foreign_toplevel_list_v1
+ * @section page_iface_ext_foreign_toplevel_list_v1_desc Description
+ *
+ * A toplevel is defined as a surface with a role similar to xdg_toplevel.
+ * The compositor sends a toplevel event for every toplevel once the
+ * global is bound, and then for every new toplevel.
+ * @section page_iface_ext_foreign_toplevel_list_v1_api API
+ * See @ref iface_ext_foreign_toplevel_list_v1.
+ */
+/**
+ * @defgroup iface_ext_foreign_toplevel_list_v1 The ext_foreign_toplevel_list_v1 interface
+ *
+ * A toplevel is defined as a surface with a role similar to xdg_toplevel.
+ * The compositor sends a toplevel event for every toplevel once the
+ * global is bound, and then for every new toplevel.
+ */
+extern const struct wl_interface ext_foreign_toplevel_list_v1_interface;
+#endif
+#ifndef EXT_FOREIGN_TOPLEVEL_HANDLE_V1_INTERFACE
+#define EXT_FOREIGN_TOPLEVEL_HANDLE_V1_INTERFACE
+/**
+ * @page page_iface_ext_foreign_toplevel_handle_v1 ext_foreign_toplevel_handle_v1
+ * @section page_iface_ext_foreign_toplevel_handle_v1_desc Description
+ *
+ * A ext_foreign_toplevel_handle_v1 object represents a mapped toplevel
+ * window.
+ * @section page_iface_ext_foreign_toplevel_handle_v1_api API
+ * See @ref iface_ext_foreign_toplevel_handle_v1.
+ */
+/**
+ * @defgroup iface_ext_foreign_toplevel_handle_v1 The ext_foreign_toplevel_handle_v1 interface
+ *
+ * A ext_foreign_toplevel_handle_v1 object represents a mapped toplevel
+ * window.
+ */
+extern const struct wl_interface ext_foreign_toplevel_handle_v1_interface;
+#endif
+
+/**
+ * @ingroup iface_ext_foreign_toplevel_list_v1
+ * @struct ext_foreign_toplevel_list_v1_listener
+ */
+struct ext_foreign_toplevel_list_v1_listener {
+	/**
+	 * a toplevel has been created
+	 *
+	 * This event is emitted whenever a new toplevel window is created.
+	 */
+	void (*toplevel)(void *data,
+			 struct ext_foreign_toplevel_list_v1 *ext_foreign_toplevel_list_v1,
+			 struct ext_foreign_toplevel_handle_v1 *toplevel);
+	/**
+	 * the compositor has finished with the toplevel manager
+	 *
+	 * This event indicates that the compositor is done sending events
+	 * to this object.
+	 */
+	void (*finished)(void *data,
+			 struct ext_foreign_toplevel_list_v1 *ext_foreign_toplevel_list_v1);
+};
+
+/**
+ * @ingroup iface_ext_foreign_toplevel_list_v1
+ */
+static inline int
+ext_foreign_toplevel_list_v1_add_listener(struct ext_foreign_toplevel_list_v1 *ext_foreign_toplevel_list_v1,
+					  const struct ext_foreign_toplevel_list_v1_listener *listener, void *data)
+{
+	return wl_proxy_add_listener((struct wl_proxy *) ext_foreign_toplevel_list_v1,
+				     (void (**)(void)) listener, data);
+}
+
+#define EXT_FOREIGN_TOPLEVEL_LIST_V1_STOP 0
+#define EXT_FOREIGN_TOPLEVEL_LIST_V1_DESTROY 1
+
+/**
+ * @ingroup iface_ext_foreign_toplevel_list_v1
+ */
+#define EXT_FOREIGN_TOPLEVEL_LIST_V1_TOPLEVEL_SINCE_VERSION 1
+/**
+ * @ingroup iface_ext_foreign_toplevel_list_v1
+ */
+#define EXT_FOREIGN_TOPLEVEL_LIST_V1_FINISHED_SINCE_VERSION 1
+
+/**
+ * @ingroup iface_ext_foreign_toplevel_list_v1
+ */
+#define EXT_FOREIGN_TOPLEVEL_LIST_V1_STOP_SINCE_VERSION 1
+/**
+ * @ingroup iface_ext_foreign_toplevel_list_v1
+ */
+#define EXT_FOREIGN_TOPLEVEL_LIST_V1_DESTROY_SINCE_VERSION 1
+
+/** @ingroup iface_ext_foreign_toplevel_list_v1 */
+static inline void
+ext_foreign_toplevel_list_v1_set_user_data(struct ext_foreign_toplevel_list_v1 *ext_foreign_toplevel_list_v1, void *user_data)
+{
+	wl_proxy_set_user_data((struct wl_proxy *) ext_foreign_toplevel_list_v1, user_data);
+}
+
+/** @ingroup iface_ext_foreign_toplevel_list_v1 */
+static inline void *
+ext_foreign_toplevel_list_v1_get_user_data(struct ext_foreign_toplevel_list_v1 *ext_foreign_toplevel_list_v1)
+{
+	return wl_proxy_get_user_data((struct wl_proxy *) ext_foreign_toplevel_list_v1);
+}
+
+static inline uint32_t
+ext_foreign_toplevel_list_v1_get_version(struct ext_foreign_toplevel_list_v1 *ext_foreign_toplevel_list_v1)
+{
+	return wl_proxy_get_version((struct wl_proxy *) ext_foreign_toplevel_list_v1);
+}
+
+/**
+ * @ingroup iface_ext_foreign_toplevel_list_v1
+ *
+ * This request indicates that the client no longer wishes to receive
+ * events for new toplevels.
+ */
+static inline void
+ext_foreign_toplevel_list_v1_stop(struct ext_foreign_toplevel_list_v1 *ext_foreign_toplevel_list_v1)
+{
+	wl_proxy_marshal_flags((struct wl_proxy *) ext_foreign_toplevel_list_v1,
+			 EXT_FOREIGN_TOPLEVEL_LIST_V1_STOP, NULL, wl_proxy_get_version((struct wl_proxy *) ext_foreign_toplevel_list_v1), 0);
+}
+
+/**
+ * @ingroup iface_ext_foreign_toplevel_list_v1
+ *
+ * This request should be called either when the client will no longer
+ * use the ext_foreign_toplevel_list_v1 or after the finished event
+ * has been received to allow destruction of the object.
+ */
+static inline void
+ext_foreign_toplevel_list_v1_destroy(struct ext_foreign_toplevel_list_v1 *ext_foreign_toplevel_list_v1)
+{
+	wl_proxy_marshal_flags((struct wl_proxy *) ext_foreign_toplevel_list_v1,
+			 EXT_FOREIGN_TOPLEVEL_LIST_V1_DESTROY, NULL, wl_proxy_get_version((struct wl_proxy *) ext_foreign_toplevel_list_v1), WL_MARSHAL_FLAG_DESTROY);
+}
+
+/**
+ * @ingroup iface_ext_foreign_toplevel_handle_v1
+ * @struct ext_foreign_toplevel_handle_v1_listener
+ */
+struct ext_foreign_toplevel_handle_v1_listener {
+	/**
+	 * the toplevel has been closed
+	 *
+	 * The server will emit no further events on the handle.
+	 */
+	void (*closed)(void *data,
+		       struct ext_foreign_toplevel_handle_v1 *ext_foreign_toplevel_handle_v1);
+	/**
+	 * all information about the toplevel has been sent
+	 *
+	 * This event is sent after all changes in the toplevel state have
+	 * been sent.
+	 */
+	void (*done)(void *data,
+		     struct ext_foreign_toplevel_handle_v1 *ext_foreign_toplevel_handle_v1);
+	/**
+	 * title change
+	 *
+	 * The title of the toplevel has changed.
+	 */
+	void (*title)(void *data,
+		      struct ext_foreign_toplevel_handle_v1 *ext_foreign_toplevel_handle_v1,
+		      const char *title);
+	/**
+	 * app_id change
+	 *
+	 * The app id of the toplevel has changed.
+	 */
+	void (*app_id)(void *data,
+		       struct ext_foreign_toplevel_handle_v1 *ext_foreign_toplevel_handle_v1,
+		       const char *app_id);
+	/**
+	 * a stable identifier for a toplevel
+	 *
+	 * This identifier is used to check if two or more toplevel handles
+	 * belong to the same toplevel.
+	 */
+	void (*identifier)(void *data,
+			   struct ext_foreign_toplevel_handle_v1 *ext_foreign_toplevel_handle_v1,
+			   const char *identifier);
+};
+
+/**
+ * @ingroup iface_ext_foreign_toplevel_handle_v1
+ */
+static inline int
+ext_foreign_toplevel_handle_v1_add_listener(struct ext_foreign_toplevel_handle_v1 *ext_foreign_toplevel_handle_v1,
+					    const struct ext_foreign_toplevel_handle_v1_listener *listener, void *data)
+{
+	return wl_proxy_add_listener((struct wl_proxy *) ext_foreign_toplevel_handle_v1,
+				     (void (**)(void)) listener, data);
+}
+
+#define EXT_FOREIGN_TOPLEVEL_HANDLE_V1_DESTROY 0
+
+/**
+ * @ingroup iface_ext_foreign_toplevel_handle_v1
+ */
+#define EXT_FOREIGN_TOPLEVEL_HANDLE_V1_CLOSED_SINCE_VERSION 1
+/**
+ * @ingroup iface_ext_foreign_toplevel_handle_v1
+ */
+#define EXT_FOREIGN_TOPLEVEL_HANDLE_V1_DONE_SINCE_VERSION 1
+/**
+ * @ingroup iface_ext_foreign_toplevel_handle_v1
+ */
+#define EXT_FOREIGN_TOPLEVEL_HANDLE_V1_TITLE_SINCE_VERSION 1
+/**
+ * @ingroup iface_ext_foreign_toplevel_handle_v1
+ */
+#define EXT_FOREIGN_TOPLEVEL_HANDLE_V1_APP_ID_SINCE_VERSION 1
+/**
+ * @ingroup iface_ext_foreign_toplevel_handle_v1
+ */
+#define EXT_FOREIGN_TOPLEVEL_HANDLE_V1_IDENTIFIER_SINCE_VERSION 1
+
+/**
+ * @ingroup iface_ext_foreign_toplevel_handle_v1
+ */
+#define EXT_FOREIGN_TOPLEVEL_HANDLE_V1_DESTROY_SINCE_VERSION 1
+
+/** @ingroup iface_ext_foreign_toplevel_handle_v1 */
+static inline void
+ext_foreign_toplevel_handle_v1_set_user_data(struct ext_foreign_toplevel_handle_v1 *ext_foreign_toplevel_handle_v1, void *user_data)
+{
+	wl_proxy_set_user_data((struct wl_proxy *) ext_foreign_toplevel_handle_v1, user_data);
+}
+
+/** @ingroup iface_ext_foreign_toplevel_handle_v1 */
+static inline void *
+ext_foreign_toplevel_handle_v1_get_user_data(struct ext_foreign_toplevel_handle_v1 *ext_foreign_toplevel_handle_v1)
+{
+	return wl_proxy_get_user_data((struct wl_proxy *) ext_foreign_toplevel_handle_v1);
+}
+
+static inline uint32_t
+ext_foreign_toplevel_handle_v1_get_version(struct ext_foreign_toplevel_handle_v1 *ext_foreign_toplevel_handle_v1)
+{
+	return wl_proxy_get_version((struct wl_proxy *) ext_foreign_toplevel_handle_v1);
+}
+
+/**
+ * @ingroup iface_ext_foreign_toplevel_handle_v1
+ *
+ * This request should be used when the client will no longer use the
+ * handle or after the closed event has been received.
+ */
+static inline void
+ext_foreign_toplevel_handle_v1_destroy(struct ext_foreign_toplevel_handle_v1 *ext_foreign_toplevel_handle_v1)
+{
+	wl_proxy_marshal_flags((struct wl_proxy *) ext_foreign_toplevel_handle_v1,
+			 EXT_FOREIGN_TOPLEVEL_HANDLE_V1_DESTROY, NULL, wl_proxy_get_version((struct wl_proxy *) ext_foreign_toplevel_handle_v1), WL_MARSHAL_FLAG_DESTROY);
+}
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
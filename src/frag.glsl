@@ -1,17 +1,19 @@
-#version 130
-out mediump vec4 color;
 in mediump vec2 texcoord;
 uniform sampler2D tex;
-uniform vec2 cursorPos;
-uniform vec2 windowSize;
+uniform SHARED_PRECISION vec2 cursorPos;
+uniform SHARED_PRECISION vec2 windowSize;
 uniform float flShadow;
 uniform float flRadius;
-uniform float cameraScale;
+uniform SHARED_PRECISION float cameraScale;
 
 void main()
 {
     vec4 cursor = vec4(cursorPos.x, windowSize.y - cursorPos.y, 0.0, 1.0);
+    // Opaque whatever the texture holds: XRGB copies leave the fourth
+    // byte undefined, and the surface keeps an alpha channel for the
+    // dimming --region draws
+    vec4 pixel = vec4(texture(tex, texcoord).bgr, 1.0);
     color = mix(
-        texture(tex, texcoord), vec4(0.0, 0.0, 0.0, 1.0),
+        pixel, vec4(0.0, 0.0, 0.0, 1.0),
         length(cursor - gl_FragCoord) < (flRadius * cameraScale) ? 0.0 : flShadow);
 }
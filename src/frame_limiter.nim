@@ -0,0 +1,30 @@
+## Frame pacing for when the swap interval is 0 and the display server
+## no longer throttles us. Keeps the loop at the output refresh rate
+## without waiting for vblank.
+
+import posix
+import clock
+
+type
+  FrameLimiter* = object
+    interval: float   # seconds per frame
+    deadline: float   # nowSeconds() at which the next frame may start
+
+proc initFrameLimiter*(rate: int): FrameLimiter =
+  result.interval = 1.0 / max(rate, 1).float
+  result.deadline = nowSeconds() + result.interval
+
+proc wait*(limiter: var FrameLimiter) =
+  ## Sleeps until the next frame is due. A frame that overran its slot
+  ## restarts the schedule instead of rushing to catch up.
+  let now = nowSeconds()
+  let remaining = limiter.deadline - now
+  if remaining > 0.0:
+    var req, rem: Timespec
+    req.tv_sec = posix.Time(int(remaining))
+    req.tv_nsec = int((remaining - int(remaining).float) * 1e9)
+    while nanosleep(req, rem) != 0 and errno == EINTR:
+      req = rem
+    limiter.deadline += limiter.interval
+  else:
+    limiter.deadline = now + limiter.interval
@@ -0,0 +1,150 @@
+## The GL entry points the renderers of both backends call, looked up in
+## the current context by `loadGL` (see `contextImport` in
+## dynamic_library.nim). The opengl package resolves its own from libGL,
+## at startup and whichever backend runs, and GLES-only drivers don't ship
+## libGL. Its types and constants are re-exported, so this replaces
+## `import opengl`.
+
+import opengl except glActiveTexture, glAttachShader, glBeginQuery,
+  glBindAttribLocation, glBindBuffer, glBindFramebuffer, glBindTexture,
+  glBindVertexArray, glBlitFramebuffer, glBufferData, glBufferSubData,
+  glClear, glClearColor, glCompileShader, glCreateProgram, glCreateShader,
+  glDeleteBuffers, glDeleteFramebuffers, glDeleteProgram, glDeleteQueries,
+  glDeleteShader, glDeleteTextures, glDeleteVertexArrays, glDisable,
+  glDrawElements, glEnable, glEnableVertexAttribArray, glEndQuery,
+  glFramebufferTexture2D, glGenBuffers, glGenFramebuffers, glGenQueries,
+  glGenTextures, glGenVertexArrays, glGenerateMipmap, glGetError,
+  glGetIntegerv, glGetProgramBinary, glGetProgramInfoLog, glGetProgramiv,
+  glGetQueryObjectiv, glGetQueryObjectui64v, glGetShaderInfoLog,
+  glGetShaderiv, glGetString, glGetUniformLocation, glLinkProgram,
+  glPixelStorei, glProgramBinary, glProgramParameteri, glScissor,
+  glShaderSource, glTexImage2D, glTexParameteri, glTexSubImage2D,
+  glUniform1f, glUniform1i, glUniform2f, glUseProgram,
+  glVertexAttribPointer, glViewport
+export opengl except glActiveTexture, glAttachShader, glBeginQuery,
+  glBindAttribLocation, glBindBuffer, glBindFramebuffer, glBindTexture,
+  glBindVertexArray, glBlitFramebuffer, glBufferData, glBufferSubData,
+  glClear, glClearColor, glCompileShader, glCreateProgram, glCreateShader,
+  glDeleteBuffers, glDeleteFramebuffers, glDeleteProgram, glDeleteQueries,
+  glDeleteShader, glDeleteTextures, glDeleteVertexArrays, glDisable,
+  glDrawElements, glEnable, glEnableVertexAttribArray, glEndQuery,
+  glFramebufferTexture2D, glGenBuffers, glGenFramebuffers, glGenQueries,
+  glGenTextures, glGenVertexArrays, glGenerateMipmap, glGetError,
+  glGetIntegerv, glGetProgramBinary, glGetProgramInfoLog, glGetProgramiv,
+  glGetQueryObjectiv, glGetQueryObjectui64v, glGetShaderInfoLog,
+  glGetShaderiv, glGetString, glGetUniformLocation, glLinkProgram,
+  glPixelStorei, glProgramBinary, glProgramParameteri, glScissor,
+  glShaderSource, glTexImage2D, glTexParameteri, glTexSubImage2D,
+  glUniform1f, glUniform1i, glUniform2f, glUseProgram,
+  glVertexAttribPointer, glViewport
+import dynamic_library
+
+contextImport(loadGL):
+  # State and drawing
+  proc glEnable*(cap: GLenum) {.importc, cdecl.}
+  proc glDisable*(cap: GLenum) {.importc, cdecl.}
+  proc glGetError*(): GLenum {.importc, cdecl.}
+  proc glGetIntegerv*(pname: GLenum, data: ptr GLint) {.importc, cdecl.}
+  proc glGetString*(name: GLenum): ptr GLubyte {.importc, cdecl.}
+  proc glViewport*(x, y: GLint, width, height: GLsizei) {.importc, cdecl.}
+  proc glScissor*(x, y: GLint, width, height: GLsizei) {.importc, cdecl.}
+  proc glClearColor*(red, green, blue, alpha: GLfloat) {.importc, cdecl.}
+  proc glClear*(mask: GLbitfield) {.importc, cdecl.}
+  proc glDrawElements*(mode: GLenum, count: GLsizei, kind: GLenum,
+                       indices: pointer) {.importc, cdecl.}
+
+  # Shaders and programs
+  proc glCreateShader*(kind: GLenum): GLuint {.importc, cdecl.}
+  proc glShaderSource*(shader: GLuint, count: GLsizei, strings: cstringArray,
+                       lengths: ptr GLint) {.importc, cdecl.}
+  proc glCompileShader*(shader: GLuint) {.importc, cdecl.}
+  proc glGetShaderiv*(shader: GLuint, pname: GLenum,
+                      params: ptr GLint) {.importc, cdecl.}
+  proc glGetShaderInfoLog*(shader: GLuint, bufSize: GLsizei,
+                           length: ptr GLsizei,
+                           infoLog: cstring) {.importc, cdecl.}
+  proc glDeleteShader*(shader: GLuint) {.importc, cdecl.}
+  proc glCreateProgram*(): GLuint {.importc, cdecl.}
+  proc glAttachShader*(program, shader: GLuint) {.importc, cdecl.}
+  proc glBindAttribLocation*(program, index: GLuint,
+                             name: cstring) {.importc, cdecl.}
+  proc glLinkProgram*(program: GLuint) {.importc, cdecl.}
+  proc glGetProgramiv*(program: GLuint, pname: GLenum,
+                       params: ptr GLint) {.importc, cdecl.}
+  proc glGetProgramInfoLog*(program: GLuint, bufSize: GLsizei,
+                            length: ptr GLsizei,
+                            infoLog: cstring) {.importc, cdecl.}
+  proc glUseProgram*(program: GLuint) {.importc, cdecl.}
+  proc glDeleteProgram*(program: GLuint) {.importc, cdecl.}
+  proc glGetUniformLocation*(program: GLuint,
+                             name: cstring): GLint {.importc, cdecl.}
+  proc glUniform1i*(location: GLint, v0: GLint) {.importc, cdecl.}
+  proc glUniform1f*(location: GLint, v0: GLfloat) {.importc, cdecl.}
+  proc glUniform2f*(location: GLint, v0, v1: GLfloat) {.importc, cdecl.}
+  # Desktop GL 4.1 and GLES 3, see program_cache.nim
+  proc glProgramParameteri*(program: GLuint, pname: GLenum,
+                            value: GLint) {.importc, cdecl.}
+  proc glProgramBinary*(program: GLuint, binaryFormat: GLenum,
+                        binary: pointer, length: GLsizei) {.importc, cdecl.}
+  proc glGetProgramBinary*(program: GLuint, bufSize: GLsizei,
+                           length: ptr GLsizei, binaryFormat: ptr GLenum,
+                           binary: pointer) {.importc, cdecl.}
+
+  # Vertex data, vertex arrays are not in GLES 2
+  proc glGenBuffers*(n: GLsizei, buffers: ptr GLuint) {.importc, cdecl.}
+  proc glDeleteBuffers*(n: GLsizei, buffers: ptr GLuint) {.importc, cdecl.}
+  proc glBindBuffer*(target: GLenum, buffer: GLuint) {.importc, cdecl.}
+  proc glBufferData*(target: GLenum, size: GLsizeiptr, data: pointer,
+                     usage: GLenum) {.importc, cdecl.}
+  proc glBufferSubData*(target: GLenum, offset: GLintptr, size: GLsizeiptr,
+                        data: pointer) {.importc, cdecl.}
+  proc glVertexAttribPointer*(index: GLuint, size: GLint, kind: GLenum,
+                              normalized: GLboolean, stride: GLsizei,
+                              offset: pointer) {.importc, cdecl.}
+  proc glEnableVertexAttribArray*(index: GLuint) {.importc, cdecl.}
+  proc glGenVertexArrays*(n: GLsizei, arrays: ptr GLuint) {.importc, cdecl.}
+  proc glDeleteVertexArrays*(n: GLsizei,
+                             arrays: ptr GLuint) {.importc, cdecl.}
+  proc glBindVertexArray*(vertexArray: GLuint) {.importc, cdecl.}
+
+  # Textures
+  proc glGenTextures*(n: GLsizei, textures: ptr GLuint) {.importc, cdecl.}
+  proc glDeleteTextures*(n: GLsizei, textures: ptr GLuint) {.importc, cdecl.}
+  proc glBindTexture*(target: GLenum, texture: GLuint) {.importc, cdecl.}
+  proc glActiveTexture*(texture: GLenum) {.importc, cdecl.}
+  proc glTexParameteri*(target, pname: GLenum,
+                        param: GLint) {.importc, cdecl.}
+  proc glPixelStorei*(pname: GLenum, param: GLint) {.importc, cdecl.}
+  proc glTexImage2D*(target: GLenum, level, internalFormat: GLint,
+                     width, height: GLsizei, border: GLint,
+                     format, kind: GLenum, pixels: pointer) {.importc, cdecl.}
+  proc glTexSubImage2D*(target: GLenum, level, xoffset, yoffset: GLint,
+                        width, height: GLsizei, format, kind: GLenum,
+                        pixels: pointer) {.importc, cdecl.}
+  # GL 3.0 and GLES 2, the X11 renderer mipmaps the screenshot
+  proc glGenerateMipmap*(target: GLenum) {.importc, cdecl.}
+
+  # Framebuffers, for dynamic resolution (GL 3.0 and GLES 3)
+  proc glGenFramebuffers*(n: GLsizei,
+                          framebuffers: ptr GLuint) {.importc, cdecl.}
+  proc glDeleteFramebuffers*(n: GLsizei,
+                             framebuffers: ptr GLuint) {.importc, cdecl.}
+  proc glBindFramebuffer*(target: GLenum,
+                          framebuffer: GLuint) {.importc, cdecl.}
+  proc glFramebufferTexture2D*(target, attachment, textarget: GLenum,
+                               texture: GLuint,
+                               level: GLint) {.importc, cdecl.}
+  proc glBlitFramebuffer*(srcX0, srcY0, srcX1, srcY1: GLint,
+                          dstX0, dstY0, dstX1, dstY1: GLint,
+                          mask: GLbitfield,
+                          filter: GLenum) {.importc, cdecl.}
+
+  # Timer queries, desktop GL 3.3 only
+  proc glGenQueries*(n: GLsizei, ids: ptr GLuint) {.importc, cdecl.}
+  proc glDeleteQueries*(n: GLsizei, ids: ptr GLuint) {.importc, cdecl.}
+  proc glBeginQuery*(target: GLenum, id: GLuint) {.importc, cdecl.}
+  proc glEndQuery*(target: GLenum) {.importc, cdecl.}
+  proc glGetQueryObjectiv*(id: GLuint, pname: GLenum,
+                           params: ptr GLint) {.importc, cdecl.}
+  proc glGetQueryObjectui64v*(id: GLuint, pname: GLenum,
+                              params: ptr GLuint64) {.importc, cdecl.}
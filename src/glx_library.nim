@@ -0,0 +1,33 @@
+## The part of GLX the X11 backend calls, loaded at runtime by `loadGLX`
+## (see dynamic_library.nim). The opengl package binds GLX and GL through
+## the dynlib pragma, which would open libGL at startup in Wayland sessions
+## too, and abort it where there is no libGL. GLX extensions and GL itself
+## are looked up with `getGLXProcAddress`, see gl_library.nim.
+
+import x11/xlib, x11/x, x11/xutil
+import dynamic_library
+
+type GLXContext* = pointer
+
+const
+  GLX_RGBA* = 4.cint
+  GLX_DOUBLEBUFFER* = 5.cint
+  GLX_DEPTH_SIZE* = 12.cint
+
+dynamicImport(loadGLX, ["libGL.so.1", "libGL.so"]):
+  proc glXQueryVersion*(display: PDisplay, major, minor: ptr cint): cint
+    {.importc, cdecl.}
+  proc glXQueryExtensionsString*(display: PDisplay, screen: cint): cstring
+    {.importc, cdecl.}
+  proc glXChooseVisual*(display: PDisplay, screen: cint,
+                        attributes: ptr cint): PXVisualInfo
+    {.importc, cdecl.}
+  proc glXCreateContext*(display: PDisplay, visual: PXVisualInfo,
+                         shareList: GLXContext, direct: cint): GLXContext
+    {.importc, cdecl.}
+  proc glXMakeCurrent*(display: PDisplay, drawable: Window,
+                       context: GLXContext): cint {.importc, cdecl.}
+  proc glXSwapBuffers*(display: PDisplay, drawable: Window) {.importc, cdecl.}
+  # GLX 1.4 returns core GL entry points too, not only extensions
+  proc getGLXProcAddress*(name: cstring): pointer
+    {.importc: "glXGetProcAddressARB", cdecl.}
@@ -1,14 +1,28 @@
 ## Backend-agnostic image data type.
 ## Replaces PXImage for use in both X11 and Wayland backends.
 
-type ImageData* = object
-  width*: cint
-  height*: cint
-  data*: cstring     ## BGRA pixel data (4 bytes per pixel)
-  bpp*: cint         ## bytes per pixel (always 4)
-  ownsData*: bool    ## if true, data was allocated by us and must be freed
+import posix
+
+type
+  PixelFormat* = enum
+    pfBGRA    ## 4 bytes per pixel, what captures produce
+    pfRGB     ## 3 bytes per pixel, rows unpadded (mapped PPM files)
+
+  ImageData* = object
+    width*: cint
+    height*: cint
+    data*: cstring     ## pixel data, BGRA unless `format` says otherwise
+    bpp*: cint         ## bytes per pixel
+    ownsData*: bool    ## if true, data is on the shared heap and must be freed
+    format*: PixelFormat
+    mapping*: pointer  ## a file mapping `data` points into, unmapped by destroy
+    mappingSize*: int
 
 proc destroy*(img: var ImageData) =
   if img.ownsData and img.data != nil:
-    dealloc(img.data)
+    deallocShared(img.data)
+    img.data = nil
+  if img.mapping != nil:
+    discard munmap(img.mapping, img.mappingSize)
+    img.mapping = nil
     img.data = nil
@@ -0,0 +1,430 @@
+## Images from files for --image, so boomer can zoom renders and CI
+## screenshots as well as fresh captures. Binary PPM is mapped and handed
+## to the renderer as it is on disk; QOI and PNG are decoded into BGRA.
+## Work done pixel by pixel is split into row stripes, one per core.
+## Decoding itself can't be: every QOI pixel and every PNG row depends on
+## the one before it. Transparency is flattened onto the overlay's
+## background as pixels are converted: the overlay is one opaque surface,
+## and what shows through it is the desktop, not the image's backdrop.
+
+import posix
+import cpuinfo
+import strutils
+import image_data
+import dynamic_library
+
+type Bytes = ptr UncheckedArray[uint8]
+
+# Only PNG needs it
+dynamicImport(loadZlib, ["libz.so.1", "libz.so"]):
+  proc zUncompress(dest: pointer, destLen: ptr culong, source: pointer,
+                   sourceLen: culong): cint {.cdecl, importc: "uncompress".}
+
+# --- Input ---
+
+type Input = object
+  mapping: pointer   # regular files, stdin included
+  size: int
+  buffer: string     # pipes, read whole
+
+proc bytes(input: Input): Bytes =
+  if input.mapping != nil: cast[Bytes](input.mapping)
+  else: cast[Bytes](input.buffer.cstring)
+
+proc readInput(path: string): Input =
+  ## `path` "-" is stdin
+  let fd = if path == "-": 0.cint else: posix.open(path.cstring, O_RDONLY)
+  if fd < 0:
+    quit "Failed to open " & path & ": " & $strerror(errno)
+  defer:
+    if fd != 0: discard posix.close(fd)
+
+  var st: Stat
+  if fstat(fd, st) == 0 and S_ISREG(st.st_mode) and st.st_size > 0:
+    result.size = st.st_size.int
+    result.mapping = mmap(nil, result.size, PROT_READ, MAP_PRIVATE, fd, 0)
+    if result.mapping == MAP_FAILED:
+      quit "Failed to map " & path & ": " & $strerror(errno)
+    discard posix_madvise(result.mapping, result.size, POSIX_MADV_SEQUENTIAL)
+  else:
+    result.buffer = if path == "-": stdin.readAll() else: readFile(path)
+    result.size = result.buffer.len
+
+proc close(input: var Input) =
+  if input.mapping != nil:
+    discard munmap(input.mapping, input.size)
+    input.mapping = nil
+  input.buffer = ""
+
+proc hasMagic(input: Input, magic: string): bool =
+  if input.size < magic.len:
+    return false
+  for i, c in magic:
+    if input.bytes[i] != c.uint8:
+      return false
+  true
+
+proc be32(bytes: Bytes, pos: int): int =
+  (bytes[pos].int shl 24) or (bytes[pos + 1].int shl 16) or
+    (bytes[pos + 2].int shl 8) or bytes[pos + 3].int
+
+const BACKDROP = 26   # the renderers' clear color, 0.1 gray
+
+proc over(c, alpha: uint8): uint8 {.inline.} =
+  ## `c` at `alpha` over BACKDROP
+  uint8((c.int * alpha.int + BACKDROP * (255 - alpha.int) + 127) div 255)
+
+proc newBGRA(width, height: int): ImageData =
+  ImageData(width: width.cint, height: height.cint, bpp: 4, ownsData: true,
+            data: cast[cstring](allocShared(width * height * 4)))
+
+# --- Conversion to BGRA in row stripes ---
+
+type
+  Layout = enum
+    lGray, lGrayAlpha, lRGB, lRGBA, lPalette
+
+  Palette = array[256, array[4, uint8]]   # BGRA
+
+  Stripe = object
+    src: Bytes
+    srcStride: int     # bytes per source row
+    srcOffset: int     # bytes before its first pixel (the PNG filter byte)
+    depth: int         # bytes per sample, 1 or 2 (big endian, MSB used)
+    layout: Layout
+    palette: ptr Palette
+    dst: Bytes
+    width: int
+    first, last: int   # rows
+
+proc convertStripe(s: Stripe) {.thread.} =
+  let channels = case s.layout
+                 of lGray, lPalette: 1
+                 of lGrayAlpha: 2
+                 of lRGB: 3
+                 of lRGBA: 4
+  let step = channels * s.depth
+  for y in s.first ..< s.last:
+    let row = cast[Bytes](addr s.src[y * s.srcStride + s.srcOffset])
+    let dst = cast[Bytes](addr s.dst[y * s.width * 4])
+    template eachPixel(body: untyped) =
+      for x in 0 ..< s.width:
+        let p {.inject.} = x * step
+        let o {.inject.} = x * 4
+        body
+    case s.layout
+    of lGray:
+      eachPixel:
+        dst[o] = row[p]; dst[o + 1] = row[p]; dst[o + 2] = row[p]
+        dst[o + 3] = 255
+    of lGrayAlpha:
+      eachPixel:
+        let gray = over(row[p], row[p + s.depth])
+        dst[o] = gray; dst[o + 1] = gray; dst[o + 2] = gray
+        dst[o + 3] = 255
+    of lRGB:
+      eachPixel:
+        dst[o] = row[p + 2 * s.depth]
+        dst[o + 1] = row[p + s.depth]
+        dst[o + 2] = row[p]
+        dst[o + 3] = 255
+    of lRGBA:
+      eachPixel:
+        let alpha = row[p + 3 * s.depth]
+        dst[o] = over(row[p + 2 * s.depth], alpha)
+        dst[o + 1] = over(row[p + s.depth], alpha)
+        dst[o + 2] = over(row[p], alpha)
+        dst[o + 3] = 255
+    of lPalette:
+      eachPixel:
+        copyMem(addr dst[o], addr s.palette[row[p]], 4)
+
+proc convertRows(job: Stripe, height: int) =
+  ## Runs `job` over rows 0 ..< `height`, in as many stripes as there are
+  ## cores, but none thinner than 64 rows
+  let count = clamp(height div 64, 1, max(countProcessors(), 1))
+  if count == 1:
+    var stripe = job
+    stripe.first = 0
+    stripe.last = height
+    convertStripe(stripe)
+    return
+  var threads = newSeq[Thread[Stripe]](count)
+  for i in 0 ..< count:
+    var stripe = job
+    stripe.first = height * i div count
+    stripe.last = height * (i + 1) div count
+    createThread(threads[i], convertStripe, stripe)
+  joinThreads(threads)
+
+proc converted*(image: ImageData): ImageData =
+  ## A BGRA copy of an image in another format, for the renderers that
+  ## take nothing else
+  result = newBGRA(image.width, image.height)
+  convertRows(Stripe(src: cast[Bytes](image.data),
+                     srcStride: image.width.int * image.bpp.int,
+                     depth: 1, layout: lRGB,
+                     dst: cast[Bytes](result.data), width: image.width.int),
+              image.height.int)
+
+proc toBGRA*(image: var ImageData) =
+  if image.format != pfBGRA:
+    let bgra = image.converted()
+    image.destroy()
+    image = bgra
+
+# --- PPM and PGM ---
+
+proc pnmNumber(bytes: Bytes, size: int, pos: var int): int =
+  while pos < size:
+    if bytes[pos].char == '#':
+      while pos < size and bytes[pos].char != '\n': inc pos
+    elif bytes[pos].char in Whitespace:
+      inc pos
+    else:
+      break
+  if pos >= size or bytes[pos].char notin Digits:
+    quit "Malformed PNM header"
+  while pos < size and bytes[pos].char in Digits:
+    result = result * 10 + bytes[pos].int - '0'.int
+    inc pos
+
+proc loadPnm(input: var Input): ImageData =
+  ## 8-bit binary PPM is used in place: the mapping goes to the ImageData,
+  ## and rows go to the GPU straight from the page cache
+  let bytes = input.bytes
+  let gray = bytes[1].char == '5'
+  var pos = 2
+  let width = pnmNumber(bytes, input.size, pos)
+  let height = pnmNumber(bytes, input.size, pos)
+  let maxval = pnmNumber(bytes, input.size, pos)
+  inc pos   # the single whitespace before the pixels
+  if maxval notin [255, 65535]:
+    quit "Only PNM files with a maxval of 255 or 65535 are supported"
+  let depth = if maxval == 255: 1 else: 2
+  let channels = if gray: 1 else: 3
+  if width <= 0 or height <= 0 or
+     pos + width * height * channels * depth > input.size:
+    quit "Truncated PNM file"
+
+  if not gray and depth == 1:
+    if input.mapping != nil:
+      result = ImageData(width: width.cint, height: height.cint, bpp: 3,
+                         format: pfRGB,
+                         data: cast[cstring](addr bytes[pos]),
+                         mapping: input.mapping, mappingSize: input.size)
+      input.mapping = nil   # owned by the image now
+    else:
+      let size = width * height * 3
+      result = ImageData(width: width.cint, height: height.cint, bpp: 3,
+                         format: pfRGB, ownsData: true,
+                         data: cast[cstring](allocShared(size)))
+      copyMem(cast[pointer](result.data), addr bytes[pos], size)
+    return
+
+  result = newBGRA(width, height)
+  convertRows(Stripe(src: bytes, srcStride: width * channels * depth,
+                     srcOffset: pos, depth: depth,
+                     layout: if gray: lGray else: lRGB,
+                     dst: cast[Bytes](result.data), width: width),
+              height)
+
+# --- QOI ---
+
+proc decodeQoi(bytes: Bytes, size: int): ImageData =
+  ## One pass straight into BGRA, see https://qoiformat.org/qoi-specification.pdf
+  if size < 14 + 8:
+    quit "Truncated QOI file"
+  let width = be32(bytes, 4)
+  let height = be32(bytes, 8)
+  if width <= 0 or height <= 0:
+    quit "Malformed QOI header"
+  result = newBGRA(width, height)
+  let dst = cast[Bytes](result.data)
+
+  var
+    index: array[64, array[4, uint8]]   # RGBA
+    px = [0'u8, 0, 0, 255]
+    pos = 14
+    run = 0
+  let last = size - 8   # the end marker
+  for i in 0 ..< width * height:
+    if run > 0:
+      dec run
+    elif pos < last:
+      let op = bytes[pos]
+      inc pos
+      if op == 0xFE:
+        px[0] = bytes[pos]; px[1] = bytes[pos + 1]; px[2] = bytes[pos + 2]
+        pos += 3
+      elif op == 0xFF:
+        px[0] = bytes[pos]; px[1] = bytes[pos + 1]; px[2] = bytes[pos + 2]
+        px[3] = bytes[pos + 3]
+        pos += 4
+      else:
+        case op shr 6
+        of 0:
+          px = index[op and 63]
+        of 1:
+          px[0] = px[0] + ((op shr 4) and 3) - 2
+          px[1] = px[1] + ((op shr 2) and 3) - 2
+          px[2] = px[2] + (op and 3) - 2
+        of 2:
+          let dg = (op and 63) - 32
+          let next = bytes[pos]
+          inc pos
+          px[0] = px[0] + dg - 8 + ((next shr 4) and 15)
+          px[1] = px[1] + dg
+          px[2] = px[2] + dg - 8 + (next and 15)
+        else:
+          run = int(op and 63)   # this pixel and `run` more
+      index[(px[0].int * 3 + px[1].int * 5 + px[2].int * 7 +
+             px[3].int * 11) mod 64] = px
+    dst[i * 4] = over(px[2], px[3])
+    dst[i * 4 + 1] = over(px[1], px[3])
+    dst[i * 4 + 2] = over(px[0], px[3])
+    dst[i * 4 + 3] = 255
+
+# --- PNG ---
+
+proc paeth(a, b, c: uint8): uint8 =
+  let p = a.int + b.int - c.int
+  let pa = abs(p - a.int)
+  let pb = abs(p - b.int)
+  let pc = abs(p - c.int)
+  if pa <= pb and pa <= pc: a
+  elif pb <= pc: b
+  else: c
+
+proc unfilter(raw: Bytes, height, stride, pixelBytes: int) =
+  ## In place, leaving each row's filter byte. Sequential, every row is
+  ## predicted from the one above.
+  let rowBytes = stride - 1
+  for y in 0 ..< height:
+    let cur = cast[Bytes](addr raw[y * stride + 1])
+    let up = if y > 0: cast[Bytes](addr raw[(y - 1) * stride + 1]) else: nil
+    case raw[y * stride]
+    of 0:
+      discard
+    of 1:
+      for i in pixelBytes ..< rowBytes:
+        cur[i] = cur[i] + cur[i - pixelBytes]
+    of 2:
+      if up != nil:
+        for i in 0 ..< rowBytes:
+          cur[i] = cur[i] + up[i]
+    of 3:
+      for i in 0 ..< rowBytes:
+        let a = if i >= pixelBytes: cur[i - pixelBytes].int else: 0
+        let b = if up != nil: up[i].int else: 0
+        cur[i] = cur[i] + uint8((a + b) shr 1)
+    of 4:
+      for i in 0 ..< rowBytes:
+        let a = if i >= pixelBytes: cur[i - pixelBytes] else: 0
+        let b = if up != nil: up[i] else: 0
+        let c = if up != nil and i >= pixelBytes: up[i - pixelBytes] else: 0
+        cur[i] = cur[i] + paeth(a, b, c)
+    else:
+      quit "Malformed PNG row filter"
+
+proc decodePng(bytes: Bytes, size: int): ImageData =
+  ## Non-interlaced 8-bit PNGs of every color type, and 16-bit ones but
+  ## for palettes
+  if not loadZlib():
+    quit "PNG images need zlib (libz.so.1)"
+  var
+    width, height, depth, colorType, interlace = 0
+    palette: Palette
+    compressed: string
+    pos = 8
+  for entry in palette.mitems:
+    entry[3] = 255
+  while pos + 8 <= size:
+    let length = be32(bytes, pos)
+    let body = pos + 8
+    if length < 0 or body + length > size:
+      quit "Truncated PNG file"
+    var kind = newString(4)
+    copyMem(addr kind[0], addr bytes[pos + 4], 4)
+    case kind
+    of "IHDR":
+      width = be32(bytes, body)
+      height = be32(bytes, body + 4)
+      depth = bytes[body + 8].int
+      colorType = bytes[body + 9].int
+      interlace = bytes[body + 12].int
+    of "PLTE":
+      for i in 0 ..< min(length div 3, 256):
+        palette[i][0] = bytes[body + i * 3 + 2]
+        palette[i][1] = bytes[body + i * 3 + 1]
+        palette[i][2] = bytes[body + i * 3]
+    of "tRNS":
+      if colorType == 3:
+        for i in 0 ..< min(length, 256):
+          palette[i][3] = bytes[body + i]
+    of "IDAT":
+      let start = compressed.len
+      compressed.setLen(start + length)
+      if length > 0:
+        copyMem(addr compressed[start], addr bytes[body], length)
+    of "IEND":
+      break
+    else:
+      discard
+    pos = body + length + 4   # and the CRC
+
+  for entry in palette.mitems:
+    for c in 0 .. 2:
+      entry[c] = over(entry[c], entry[3])
+    entry[3] = 255
+
+  let layout = case colorType
+               of 0: lGray
+               of 2: lRGB
+               of 3: lPalette
+               of 4: lGrayAlpha
+               of 6: lRGBA
+               else: quit "Malformed PNG color type"
+  if width <= 0 or height <= 0 or compressed.len == 0:
+    quit "Malformed PNG file"
+  if interlace != 0 or depth notin [8, 16] or (layout == lPalette and depth != 8):
+    quit "Only non-interlaced PNGs with 8 bit samples (or 16 without a palette) are supported"
+
+  let channels = case layout
+                 of lGray, lPalette: 1
+                 of lGrayAlpha: 2
+                 of lRGB: 3
+                 of lRGBA: 4
+  let pixelBytes = channels * depth div 8
+  let stride = 1 + width * pixelBytes
+  var rawSize = culong(height * stride)
+  let raw = cast[Bytes](allocShared(rawSize.int))
+  defer: deallocShared(raw)
+  if zUncompress(raw, addr rawSize, addr compressed[0],
+                 compressed.len.culong) != 0 or
+     rawSize.int != height * stride:
+    quit "Malformed PNG image data"
+  compressed = ""
+
+  unfilter(raw, height, stride, pixelBytes)
+  result = newBGRA(width, height)
+  convertRows(Stripe(src: raw, srcStride: stride, srcOffset: 1,
+                     depth: depth div 8, layout: layout,
+                     palette: addr palette,
+                     dst: cast[Bytes](result.data), width: width),
+              height)
+
+proc loadImageFile*(path: string): ImageData =
+  ## PPM, PGM, QOI or PNG, told apart by their contents; `path` "-" reads
+  ## stdin. 8-bit PPM comes back in pfRGB, mapped when it is a file,
+  ## everything else in BGRA.
+  var input = readInput(path)
+  defer: input.close()
+  if input.hasMagic("\x89PNG\r\n\x1a\n"):
+    decodePng(input.bytes, input.size)
+  elif input.hasMagic("qoif"):
+    decodeQoi(input.bytes, input.size)
+  elif input.hasMagic("P6") or input.hasMagic("P5"):
+    loadPnm(input)
+  else:
+    quit path & " is not a PPM, PGM, QOI or PNG image"
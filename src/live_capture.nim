@@ -0,0 +1,124 @@
+## Live capture for the X11 backend (-d:live) on a worker thread with its
+## own X connection, so waiting for the server never holds up a frame and
+## the capture rate is independent of the display rate.
+##
+## The worker and the render loop share three screenshots. The worker
+## fills the back one and swaps it with the middle one; the render loop
+## swaps the middle one for its front one when it holds something newer.
+## Neither ever waits for the other.
+##
+## When it covers a monitor rather than a whole window, the capture can be
+## limited to what the camera shows (`follow`), so zooming in makes it
+## cheaper.
+
+import x11/xlib except XOpenDisplay, XCloseDisplay, XSync, XCreateImage
+import x11/x
+import locks
+import math
+import x11_library
+import screenshot
+import frame_limiter
+import la
+
+const
+  FRESH = 4       # set on `middle` when the worker published a capture
+  SNAP = 64       # followed areas are aligned to it, so they rarely resize
+
+type LiveCapture* = object
+  ## Must stay where it is between `start` and `stop`, the worker holds a
+  ## pointer to it
+  thread: Thread[ptr LiveCapture]
+  display: PDisplay     # the worker's own connection
+  window: Window
+  area: Area            # the whole image, in window coordinates
+  wholeWindow: bool
+  lock: Lock
+  requested: Area       # part of `area` to capture, guarded by `lock`
+  rate: int
+  slots: array[3, Screenshot]
+  back: int             # worker only
+  middle: int           # swapped atomically, with FRESH
+  front: int            # render loop only
+  quitting: bool
+
+proc captureWorker(capture: ptr LiveCapture) {.thread.} =
+  var limiter = initFrameLimiter(capture.rate)
+  while not atomicLoadN(addr capture.quitting, ATOMIC_ACQUIRE):
+    # Slots start out empty and are filled the first time they come back
+    template slot: untyped = capture.slots[capture.back]
+    var area = capture.area
+    if not capture.wholeWindow:
+      withLock capture.lock:
+        area = capture.requested
+    if slot.image == nil:
+      slot = newScreenshot(capture.display, capture.window, area,
+                           capture.wholeWindow)
+    elif capture.wholeWindow:
+      slot.refresh(capture.display, capture.window)
+    else:
+      slot.refresh(capture.display, capture.window, area)
+    capture.back = atomicExchangeN(addr capture.middle,
+                                   capture.back or FRESH,
+                                   ATOMIC_ACQ_REL) and not FRESH
+    limiter.wait()
+
+proc start*(capture: var LiveCapture, window: Window, first: Screenshot,
+            rate: int) =
+  ## Captures `window` `rate` times a second, the same area as `first`
+  capture.display = XOpenDisplay(nil)
+  if capture.display == nil:
+    quit "Failed to open a display for live capture"
+  capture.window = window
+  capture.area = first.area
+  capture.wholeWindow = first.wholeWindow
+  capture.requested = first.area
+  initLock(capture.lock)
+  capture.rate = rate
+  capture.back = 0
+  capture.middle = 1
+  capture.front = 2
+  capture.quitting = false
+  createThread(capture.thread, captureWorker, addr capture)
+
+proc follow*(capture: var LiveCapture, visible: tuple[min, max: Vec2f]) =
+  ## Limits the next captures to `visible`, in pixels of the first
+  ## screenshot, with half its size again on every side for the camera to
+  ## move into before a newer capture arrives. Tracked windows are always
+  ## captured whole, their size can change under us.
+  if capture.wholeWindow:
+    return
+  let margin = (visible.max - visible.min) * 0.5
+  let
+    x0 = max(floor((visible.min.x - margin.x) / SNAP.float32).int * SNAP, 0)
+    y0 = max(floor((visible.min.y - margin.y) / SNAP.float32).int * SNAP, 0)
+    x1 = min(ceil((visible.max.x + margin.x) / SNAP.float32).int * SNAP,
+             capture.area.width)
+    y1 = min(ceil((visible.max.y + margin.y) / SNAP.float32).int * SNAP,
+             capture.area.height)
+  if x1 <= x0 or y1 <= y0:
+    return   # looking past the image, the last capture will do
+  let area: Area = (capture.area.x + x0, capture.area.y + y0,
+                    x1 - x0, y1 - y0)
+  withLock capture.lock:
+    capture.requested = area
+
+proc latest*(capture: var LiveCapture): ptr Screenshot =
+  ## The newest capture, or nil when there was none since the last call.
+  ## It stays untouched by the worker until the next call.
+  if (atomicLoadN(addr capture.middle, ATOMIC_ACQUIRE) and FRESH) == 0:
+    return nil
+  capture.front = atomicExchangeN(addr capture.middle, capture.front,
+                                  ATOMIC_ACQ_REL) and not FRESH
+  addr capture.slots[capture.front]
+
+proc stop*(capture: var LiveCapture) =
+  if capture.display == nil:
+    return
+  atomicStoreN(addr capture.quitting, true, ATOMIC_RELEASE)
+  joinThread(capture.thread)
+  for slot in capture.slots:
+    if slot.image != nil:
+      slot.destroy(capture.display)
+  discard XCloseDisplay(capture.display)
+  deinitLock(capture.lock)
+  capture.display = nil
@@ -0,0 +1,61 @@
+## The monitors XRandR drives, so the X11 backend can capture and cover
+## the one under the pointer instead of the root window, which spans all
+## of them.
+
+import xcb_library
+
+type Monitor* = object
+  x*, y*, width*, height*: int
+  rate*: int    # Hz, 0 when the mode doesn't tell
+
+proc rate(mode: XcbRandrModeInfo): int =
+  var lines = mode.vtotal.float
+  if (mode.modeFlags and XCB_RANDR_MODE_FLAG_DOUBLE_SCAN) != 0:
+    lines *= 2
+  if (mode.modeFlags and XCB_RANDR_MODE_FLAG_INTERLACE) != 0:
+    lines /= 2
+  if mode.htotal == 0 or lines == 0:
+    return 0
+  int(mode.dotClock.float / (mode.htotal.float * lines) + 0.5)
+
+proc requestMonitors*(xcb: XcbConnection, root: uint32): XcbCookie =
+  ## The first of the two round trips `finishMonitors` needs, so it can go
+  ## out with other startup requests
+  xcb_randr_get_screen_resources_current(xcb, root)
+
+proc finishMonitors*(xcb: XcbConnection, cookie: XcbCookie): seq[Monitor] =
+  ## Every CRTC that shows something, each with the rate of its own mode.
+  ## The CRTC requests are all sent before the first reply is awaited.
+  let resources = xcb_randr_get_screen_resources_current_reply(xcb, cookie,
+                                                               nil)
+  if resources == nil:
+    return
+  defer: xcbFree(resources)
+
+  let crtcs = cast[ptr UncheckedArray[uint32]](
+    xcb_randr_get_screen_resources_current_crtcs(resources))
+  let modes = cast[ptr UncheckedArray[XcbRandrModeInfo]](
+    xcb_randr_get_screen_resources_current_modes(resources))
+
+  var cookies = newSeq[XcbCookie](resources.nCrtcs.int)
+  for i in 0 ..< cookies.len:
+    cookies[i] = xcb_randr_get_crtc_info(xcb, crtcs[i],
+                                         resources.configTimestamp)
+
+  for cookie in cookies:
+    let crtc = xcb_randr_get_crtc_info_reply(xcb, cookie, nil)
+    if crtc == nil:
+      continue
+    if crtc.mode != 0 and crtc.width > 0'u16 and crtc.height > 0'u16:
+      var monitor = Monitor(x: crtc.x.int, y: crtc.y.int,
+                            width: crtc.width.int, height: crtc.height.int)
+      for i in 0 ..< resources.nModes.int:
+        if modes[i].id == crtc.mode:
+          monitor.rate = modes[i].rate
+          break
+      result.add monitor
+    xcbFree(crtc)
+
+proc contains*(monitor: Monitor, x, y: int): bool =
+  x >= monitor.x and x < monitor.x + monitor.width and
+    y >= monitor.y and y < monitor.y + monitor.height
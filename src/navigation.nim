@@ -1,8 +1,7 @@
-when not defined(wayland):
-  import x11/xlib
-
 import config
 import la
+import pointer_history
+export pointer_history
 
 const VELOCITY_THRESHOLD = 15.0
 
@@ -10,6 +9,7 @@ type Mouse* = object
   curr*: Vec2f
   prev*: Vec2f
   drag*: bool
+  history*: PointerHistory
 
 type Camera* = object
   position*: Vec2f
@@ -21,30 +21,48 @@ type Camera* = object
 proc world*(camera: Camera, v: Vec2f): Vec2f =
   v / camera.scale
 
-when defined(wayland):
-  proc update*(camera: var Camera, config: Config, dt: float, mouse: Mouse, windowSize: Vec2f) =
-    if abs(camera.deltaScale) > 0.5:
-      let p0 = (camera.scalePivot - (windowSize * 0.5)) / camera.scale
-      camera.scale = max(camera.scale + camera.delta_scale * dt, config.min_scale)
-      let p1 = (camera.scalePivot - (windowSize * 0.5)) / camera.scale
-      camera.position += p0 - p1
-
-      camera.delta_scale -= camera.delta_scale * dt * config.scale_friction
-
-    if not mouse.drag and (camera.velocity.length > VELOCITY_THRESHOLD):
-      camera.position += camera.velocity * dt
-      camera.velocity -= camera.velocity * dt * config.dragFriction
-else:
-  proc update*(camera: var Camera, config: Config, dt: float, mouse: Mouse, image: PXImage, windowSize: Vec2f) =
-    if abs(camera.deltaScale) > 0.5:
-      let p0 = (camera.scalePivot - (windowSize * 0.5)) / camera.scale
-      camera.scale = max(camera.scale + camera.delta_scale * dt, config.min_scale)
-      let p1 = (camera.scalePivot - (windowSize * 0.5)) / camera.scale
-      camera.position += p0 - p1
-
-      camera.delta_scale -= camera.delta_scale * dt * config.scale_friction
-
-    if not mouse.drag and (camera.velocity.length > VELOCITY_THRESHOLD):
-      camera.position += camera.velocity * dt
-      camera.velocity -= camera.velocity * dt * config.dragFriction
+proc startDrag*(camera: var Camera, mouse: var Mouse, pointer: Vec2f) =
+  mouse.prev = pointer
+  mouse.drag = true
+  mouse.history.clear()
+  camera.velocity = vec2(0.0, 0.0)
+
+proc drag*(camera: var Camera, mouse: var Mouse, pointer: Vec2f,
+           now, presentAt: float, released: bool) =
+  ## Called once per frame. While dragging, the pointer is extrapolated
+  ## to `presentAt` so the image stays under the cursor when the frame
+  ## hits the screen. On release the camera lands on the real pointer
+  ## position and inherits the fitted pointer velocity.
+  mouse.curr = pointer
+  if mouse.drag:
+    if released:
+      mouse.drag = false
+    else:
+      mouse.curr = mouse.history.predict(presentAt, pointer)
+
+    camera.position += world(camera, mouse.prev) - world(camera, mouse.curr)
+
+    if released:
+      camera.velocity = world(camera, mouse.history.velocity(now)) * -1.0
+
+  mouse.prev = mouse.curr
+
+proc update*(camera: var Camera, config: Config, dt: float, mouse: Mouse, windowSize: Vec2f) =
+  if abs(camera.deltaScale) > 0.5:
+    let p0 = (camera.scalePivot - (windowSize * 0.5)) / camera.scale
+    camera.scale = max(camera.scale + camera.delta_scale * dt, config.min_scale)
+    let p1 = (camera.scalePivot - (windowSize * 0.5)) / camera.scale
+    camera.position += p0 - p1
+
+    camera.delta_scale -= camera.delta_scale * dt * config.scale_friction
+
+  if not mouse.drag and (camera.velocity.length > VELOCITY_THRESHOLD):
+    camera.position += camera.velocity * dt
+    camera.velocity -= camera.velocity * dt * config.dragFriction
 
+proc visibleRect*(camera: Camera, imageSize, windowSize: Vec2f): tuple[min, max: Vec2f] =
+  ## The part of the image the window shows, in image pixels with rows
+  ## counted from the top like the screenshot's. Not clamped to the image.
+  let center = imageSize * 0.5 + camera.position
+  let halfExtent = windowSize / (2.0 * camera.scale)
+  (center - halfExtent, center + halfExtent)
@@ -0,0 +1,96 @@
+## Short ring of timestamped pointer samples.
+## Used to estimate the release velocity of a drag with a least-squares
+## fit and to extrapolate the pointer to the time a frame is presented.
+
+import la
+
+const
+  POINTER_HISTORY_SIZE = 32
+  VELOCITY_WINDOW = 0.1   # seconds of samples that go into the fit
+  MAX_PREDICTION = 0.05   # never extrapolate further than this, seconds
+
+type
+  PointerSample = object
+    time: float    # event clock, seconds
+    pos: Vec2f
+
+  PointerHistory* = object
+    samples: array[POINTER_HISTORY_SIZE, PointerSample]
+    head: int
+    count: int
+    clockOffset: float   # local clock minus event clock
+    hasOffset: bool
+
+proc clear*(history: var PointerHistory) =
+  history.head = 0
+  history.count = 0
+
+proc push*(history: var PointerHistory, time: float, pos: Vec2f, receivedAt: float) =
+  ## `time` is the event timestamp as reported by the display server,
+  ## `receivedAt` the local `nowSeconds()` when it was read. The smallest
+  ## difference seen so far maps the server clock onto ours.
+  let offset = receivedAt - time
+  if not history.hasOffset or offset < history.clockOffset:
+    history.clockOffset = offset
+    history.hasOffset = true
+
+  history.samples[history.head] = PointerSample(time: time, pos: pos)
+  history.head = (history.head + 1) mod POINTER_HISTORY_SIZE
+  history.count = min(history.count + 1, POINTER_HISTORY_SIZE)
+
+proc sample(history: PointerHistory, age: int): PointerSample =
+  ## age 0 is the newest sample
+  history.samples[(history.head - 1 - age + POINTER_HISTORY_SIZE) mod POINTER_HISTORY_SIZE]
+
+proc fitVelocity(history: PointerHistory, until: float): Vec2f =
+  ## Slope of the least-squares line through the samples of the last
+  ## VELOCITY_WINDOW seconds before `until` (event clock).
+  var
+    n = 0
+    sumT, sumX, sumY = 0.0
+  for age in 0..<history.count:
+    let s = history.sample(age)
+    if until - s.time > VELOCITY_WINDOW:
+      break
+    n += 1
+    sumT += s.time
+    sumX += s.pos.x.float
+    sumY += s.pos.y.float
+
+  if n < 2:
+    return vec2(0.0, 0.0)
+
+  let
+    meanT = sumT / n.float
+    meanX = sumX / n.float
+    meanY = sumY / n.float
+  var covX, covY, varT = 0.0
+  for age in 0..<n:
+    let s = history.sample(age)
+    let dt = s.time - meanT
+    covX += dt * (s.pos.x.float - meanX)
+    covY += dt * (s.pos.y.float - meanY)
+    varT += dt * dt
+
+  if varT < 1e-9:
+    return vec2(0.0, 0.0)
+  vec2(float32(covX / varT), float32(covY / varT))
+
+proc velocity*(history: PointerHistory, at: float): Vec2f =
+  ## Pointer velocity in pixels per second at local time `at`. Samples
+  ## older than VELOCITY_WINDOW do not count, so a pointer that stopped
+  ## before the button was released has no velocity.
+  if history.count == 0:
+    return vec2(0.0, 0.0)
+  history.fitVelocity(at - history.clockOffset)
+
+proc predict*(history: PointerHistory, at: float, fallback: Vec2f): Vec2f =
+  ## Extrapolates the newest sample to local time `at`. The velocity is
+  ## fitted at `at` too, so a pointer that stopped sending samples is
+  ## predicted to stay where it stopped.
+  if history.count == 0:
+    return fallback
+  let newest = history.sample(0)
+  let until = at - history.clockOffset
+  let horizon = clamp(until - newest.time, 0.0, MAX_PREDICTION)
+  newest.pos + history.fitVelocity(until) * horizon.float32
@@ -0,0 +1,101 @@
+## On-disk cache of linked shader programs. The first launch saves what
+## glGetProgramBinary returns under $XDG_CACHE_HOME/boomer; later ones load
+## it with glProgramBinary instead of compiling and linking. Entries are
+## keyed by driver vendor, renderer, version and the exact shader sources,
+## so an updated driver or an edited shader simply misses.
+
+import os
+import strutils
+import gl_library
+
+proc fnv1a(hash: var uint64, data: string) =
+  for c in data:
+    hash = (hash xor uint64(ord(c))) * 0x100000001b3'u64
+  # Terminator, so ("ab", "c") and ("a", "bc") hash differently
+  hash = (hash xor 0xff'u64) * 0x100000001b3'u64
+
+proc glString(name: GLenum): string =
+  let s = cast[cstring](glGetString(name))
+  if s == nil: "" else: $s
+
+proc cacheDir(): string =
+  let xdg = getEnv("XDG_CACHE_HOME")
+  (if xdg.len > 0: xdg else: getHomeDir() / ".cache") / "boomer"
+
+proc cachePath(sources: openArray[string]): string =
+  var hash = 0xcbf29ce484222325'u64
+  for name in [GL_VENDOR, GL_RENDERER, GL_VERSION]:
+    hash.fnv1a(glString(name))
+  for source in sources:
+    hash.fnv1a(source)
+  cacheDir() / (toHex(hash).toLowerAscii & ".bin")
+
+proc binariesSupported(): bool =
+  ## Core in desktop GL 4.1 and GLES 3. Older contexts reject the query
+  ## and leave the count at 0.
+  var formats: GLint = 0
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, addr formats)
+  discard glGetError()
+  formats > 0
+
+proc markRetrievable*(program: GLuint) =
+  ## Call before linking, some drivers only keep a binary when asked to
+  if binariesSupported():
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, 1)
+
+proc loadProgram*(sources: openArray[string]): GLuint =
+  ## Returns a linked program, or 0 when there is no usable cache entry.
+  ## `sources` must be exactly what the program is compiled from.
+  if not binariesSupported():
+    return 0
+  var data: string
+  try:
+    data = readFile(cachePath(sources))
+  except IOError:
+    return 0
+
+  # The file is the binary format followed by the binary
+  var format: GLenum
+  if data.len <= sizeof(format):
+    return 0
+  copyMem(addr format, addr data[0], sizeof(format))
+
+  result = glCreateProgram()
+  glProgramBinary(result, format, addr data[sizeof(format)],
+                  GLsizei(data.len - sizeof(format)))
+  var success: GLint
+  glGetProgramiv(result, GL_LINK_STATUS, addr success)
+  if not success.bool:
+    # The driver may reject binaries of another build with the same
+    # version string; the entry is overwritten once we have linked
+    glDeleteProgram(result)
+    result = 0
+
+proc saveProgram*(program: GLuint, sources: openArray[string]) =
+  ## Best effort, a cache that can't be written is not an error
+  if not binariesSupported():
+    return
+  var length: GLint
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, addr length)
+  if length <= 0:
+    return
+
+  var format: GLenum
+  var written: GLsizei
+  var data = newString(sizeof(format) + length)
+  glGetProgramBinary(program, length, addr written, addr format,
+                     addr data[sizeof(format)])
+  if written <= 0:
+    return
+  copyMem(addr data[0], addr format, sizeof(format))
+  data.setLen(sizeof(format) + written)
+
+  # Renamed into place so a concurrent launch never reads half a file
+  let path = cachePath(sources)
+  let temporary = path & "." & $getCurrentProcessId() & ".tmp"
+  try:
+    createDir(path.parentDir)
+    writeFile(temporary, data)
+    moveFile(temporary, path)
+  except OSError, IOError:
+    discard tryRemoveFile(temporary)
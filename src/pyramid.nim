@@ -0,0 +1,277 @@
+## Mip pyramids for --image, so a huge image opens as fast as a small one.
+## `boomer --build-pyramid <image>` writes `<image>.pyramid` next to it:
+## the image halved level by level until it fits one tile, every level cut
+## into TILE_SIZE square BGRA tiles stored whole, at offsets an index at
+## the start of the file gives. The viewer maps the file and uploads only
+## the tiles the camera shows, see tile_cache.nim.
+##
+## Layout, native endian, tiles padded with zeros past the image edge:
+##   PyramidHeader
+##   PyramidLevel * levelCount
+##   level 0 tiles, row by row, aligned to ALIGNMENT
+##   level 1 tiles, ...
+
+import posix
+import cpuinfo
+import math
+import image_data
+import image_file
+
+{.compile: "pyramid_downsample.c".}
+proc pyramid_downsample(src: ptr uint32, srcWidth, srcHeight: cint,
+                        dst: ptr uint32, dstWidth: cint,
+                        y0, y1: cint) {.importc, cdecl.}
+
+const
+  TILE_SIZE* = 256
+  TILE_BYTES = TILE_SIZE * TILE_SIZE * 4
+  MAGIC = "BOOMPYR1"
+  ALIGNMENT = 4096
+
+type
+  Pixels = ptr UncheckedArray[uint32]
+
+  PyramidHeader = object
+    magic: array[8, char]
+    tileSize, levelCount: uint32
+    sourceSize: int64     # of the image it was built from, to notice
+    sourceMtime: int64    # when that changed
+    width, height: uint32
+
+  PyramidLevel* = object
+    width*, height*: uint32
+    tilesX*, tilesY*: uint32
+    offset: uint64
+
+  Pyramid* = object
+    mapping: pointer
+    size: int
+    width*, height*: int
+    levels*: seq[PyramidLevel]
+
+proc pyramidPath*(imagePath: string): string =
+  imagePath & ".pyramid"
+
+proc sourceStat(imagePath: string): tuple[size, mtime: int64] =
+  var st: Stat
+  if stat(imagePath.cstring, st) != 0:
+    return (-1'i64, -1'i64)
+  (st.st_size.int64, st.st_mtim.tv_sec.int64)
+
+# --- Building ---
+
+type
+  JobKind = enum
+    jDownsample   # halve `src` into `dst`
+    jTile         # cut `src` into the tiles at `dst`
+
+  Job = object
+    kind: JobKind
+    src: Pixels
+    srcWidth, srcHeight: int
+    dst: Pixels
+    dstWidth: int      # jDownsample
+    tilesX: int        # jTile
+    first, last: int   # destination rows, or rows of tiles
+
+proc runJob(job: Job) {.thread.} =
+  case job.kind
+  of jDownsample:
+    pyramid_downsample(addr job.src[0], job.srcWidth.cint,
+                       job.srcHeight.cint, addr job.dst[0],
+                       job.dstWidth.cint, job.first.cint, job.last.cint)
+  of jTile:
+    for ty in job.first ..< job.last:
+      let rows = min(TILE_SIZE, job.srcHeight - ty * TILE_SIZE)
+      for tx in 0 ..< job.tilesX:
+        let tile = (ty * job.tilesX + tx) * TILE_SIZE * TILE_SIZE
+        let x0 = tx * TILE_SIZE
+        let columns = min(TILE_SIZE, job.srcWidth - x0)
+        for row in 0 ..< rows:
+          copyMem(addr job.dst[tile + row * TILE_SIZE],
+                  addr job.src[(ty * TILE_SIZE + row) * job.srcWidth + x0],
+                  columns * 4)
+
+proc runStripes(job: Job, rows, minRows: int) =
+  ## Runs `job` over `rows` in as many stripes as there are cores, none
+  ## thinner than `minRows`
+  let count = clamp(rows div minRows, 1, max(countProcessors(), 1))
+  if count == 1:
+    var stripe = job
+    stripe.first = 0
+    stripe.last = rows
+    runJob(stripe)
+    return
+  var threads = newSeq[Thread[Job]](count)
+  for i in 0 ..< count:
+    var stripe = job
+    stripe.first = rows * i div count
+    stripe.last = rows * (i + 1) div count
+    createThread(threads[i], runJob, stripe)
+  joinThreads(threads)
+
+proc planLevels(width, height: int): seq[PyramidLevel] =
+  var w = width
+  var h = height
+  var offset = sizeof(PyramidHeader)
+  while true:
+    let tilesX = (w + TILE_SIZE - 1) div TILE_SIZE
+    let tilesY = (h + TILE_SIZE - 1) div TILE_SIZE
+    result.add PyramidLevel(width: w.uint32, height: h.uint32,
+                            tilesX: tilesX.uint32, tilesY: tilesY.uint32)
+    offset += sizeof(PyramidLevel)
+    if tilesX == 1 and tilesY == 1:
+      break
+    w = (w + 1) div 2
+    h = (h + 1) div 2
+  offset = (offset + ALIGNMENT - 1) div ALIGNMENT * ALIGNMENT
+  for level in result.mitems:
+    level.offset = offset.uint64
+    offset += level.tilesX.int * level.tilesY.int * TILE_BYTES
+
+proc buildPyramid*(imagePath: string) =
+  ## Writes the pyramid of an image file next to it, replacing a stale one
+  if imagePath == "-":
+    quit "--build-pyramid needs a file, it can't be cached for stdin"
+  let source = sourceStat(imagePath)
+  var image = loadImageFile(imagePath)
+  defer: image.destroy()
+  image.toBGRA()
+
+  var levels = planLevels(image.width.int, image.height.int)
+  let last = levels[^1]
+  let size = last.offset.int + last.tilesX.int * last.tilesY.int * TILE_BYTES
+
+  # Written beside the old one and renamed over it, so a viewer never maps
+  # half a pyramid
+  let path = pyramidPath(imagePath)
+  let temporary = path & ".tmp"
+  let fd = posix.open(temporary.cstring, O_RDWR or O_CREAT or O_TRUNC, 0o644)
+  if fd < 0:
+    quit "Failed to create " & temporary & ": " & $strerror(errno)
+  defer: discard posix.close(fd)
+  if ftruncate(fd, size.Off) != 0:
+    quit "Failed to size " & temporary & ": " & $strerror(errno)
+  # Fresh pages of a truncated file read as zeros, which is the padding
+  let mapping = mmap(nil, size, PROT_READ or PROT_WRITE, MAP_SHARED, fd, 0)
+  if mapping == MAP_FAILED:
+    quit "Failed to map " & temporary & ": " & $strerror(errno)
+  let bytes = cast[ptr UncheckedArray[uint8]](mapping)
+
+  var header = PyramidHeader(tileSize: TILE_SIZE.uint32,
+                             levelCount: levels.len.uint32,
+                             sourceSize: source.size,
+                             sourceMtime: source.mtime,
+                             width: image.width.uint32,
+                             height: image.height.uint32)
+  copyMem(addr header.magic, MAGIC.cstring, MAGIC.len)
+  copyMem(mapping, addr header, sizeof(header))
+  copyMem(addr bytes[sizeof(header)], addr levels[0],
+          levels.len * sizeof(PyramidLevel))
+
+  var current = cast[Pixels](image.data)
+  var scratch: pointer = nil   # levels past 0, each freed once halved
+  for i, level in levels:
+    let width = level.width.int
+    let height = level.height.int
+    if i > 0:
+      let next = allocShared(width * height * 4)
+      runStripes(Job(kind: jDownsample, src: current,
+                     srcWidth: levels[i - 1].width.int,
+                     srcHeight: levels[i - 1].height.int,
+                     dst: cast[Pixels](next), dstWidth: width),
+                 height, 32)
+      if scratch != nil:
+        deallocShared(scratch)
+      scratch = next
+      current = cast[Pixels](next)
+    runStripes(Job(kind: jTile, src: current, srcWidth: width,
+                   srcHeight: height,
+                   dst: cast[Pixels](addr bytes[level.offset.int]),
+                   tilesX: level.tilesX.int),
+               level.tilesY.int, 1)
+  if scratch != nil:
+    deallocShared(scratch)
+
+  discard munmap(mapping, size)
+  if rename(temporary.cstring, path.cstring) != 0:
+    quit "Failed to replace " & path & ": " & $strerror(errno)
+  echo "Wrote ", path, ": ", levels.len, " levels of ", TILE_SIZE,
+       " pixel tiles"
+
+# --- Viewing ---
+
+proc isOpen*(pyramid: Pyramid): bool =
+  pyramid.mapping != nil
+
+proc close*(pyramid: var Pyramid) =
+  if pyramid.mapping != nil:
+    discard munmap(pyramid.mapping, pyramid.size)
+    pyramid.mapping = nil
+  pyramid.levels = @[]
+
+proc open*(pyramid: var Pyramid, imagePath: string): bool =
+  ## Maps the pyramid of an image file. False when it has none, or one
+  ## built from an older version of it.
+  let path = pyramidPath(imagePath)
+  if imagePath == "-" or access(path.cstring, R_OK) != 0:
+    return false
+  let fd = posix.open(path.cstring, O_RDONLY)
+  if fd < 0:
+    return false
+  defer: discard posix.close(fd)
+  var st: Stat
+  if fstat(fd, st) != 0 or st.st_size.int < sizeof(PyramidHeader):
+    return false
+  let size = st.st_size.int
+  let mapping = mmap(nil, size, PROT_READ, MAP_SHARED, fd, 0)
+  if mapping == MAP_FAILED:
+    return false
+
+  var header: PyramidHeader
+  copyMem(addr header, mapping, sizeof(header))
+  let bytes = cast[ptr UncheckedArray[uint8]](mapping)
+  let tableEnd = sizeof(header) + header.levelCount.int * sizeof(PyramidLevel)
+  let source = sourceStat(imagePath)
+  var problem = ""
+  if not equalMem(addr header.magic, MAGIC.cstring, MAGIC.len) or
+     header.tileSize != TILE_SIZE.uint32 or header.levelCount == 0 or
+     tableEnd > size:
+    problem = "isn't a pyramid boomer can read"
+  elif header.sourceSize != source.size or header.sourceMtime != source.mtime:
+    problem = "was built from an older " & imagePath
+  else:
+    var levels = newSeq[PyramidLevel](header.levelCount)
+    copyMem(addr levels[0], addr bytes[sizeof(header)],
+            levels.len * sizeof(PyramidLevel))
+    for level in levels:
+      let tiles = level.tilesX.int * level.tilesY.int
+      if level.offset.int + tiles * TILE_BYTES > size:
+        problem = "is truncated"
+    if problem.len == 0:
+      pyramid.mapping = mapping
+      pyramid.size = size
+      pyramid.width = header.width.int
+      pyramid.height = header.height.int
+      pyramid.levels = levels
+      return true
+
+  stderr.writeLine path, " ", problem,
+                   ", rebuild it with boomer --build-pyramid"
+  discard munmap(mapping, size)
+  false
+
+proc tile*(pyramid: Pyramid, level, x, y: int): pointer =
+  ## The TILE_SIZE * TILE_SIZE BGRA pixels of a tile, read from disk as
+  ## they are touched
+  let info = pyramid.levels[level]
+  let index = y * info.tilesX.int + x
+  cast[pointer](cast[uint](pyramid.mapping) + info.offset +
+                uint(index * TILE_BYTES))
+
+proc levelFor*(pyramid: Pyramid, scale: float32): int =
+  ## The level whose pixels come closest to one per screen pixel when the
+  ## camera shows the image at `scale`
+  if scale >= 1.0:
+    return 0
+  clamp(round(log2(1.0 / scale)).int, 0, pyramid.levels.high)
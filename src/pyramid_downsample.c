@@ -0,0 +1,65 @@
+/* 2x2 box filter that builds each level of a pyramid (pyramid.nim) from
+ * the one below it. Both levels are tightly packed 32-bit pixels; every
+ * channel is averaged with rounding. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* Computes destination rows y0..y1-1 from source rows 2*y0..2*y1-1. An
+ * odd last column or row of the source is paired with itself. */
+void pyramid_downsample(const uint32_t *src, int src_width, int src_height,
+                        uint32_t *dst, int dst_width, int y0, int y1) {
+  for (int y = y0; y < y1; y++) {
+    const uint32_t *r0 = src + (size_t)(2 * y) * src_width;
+    const uint32_t *r1 = 2 * y + 1 < src_height ? r0 + src_width : r0;
+    uint32_t *out = dst + (size_t)y * dst_width;
+    int x = 0;
+#ifdef __SSE2__
+    /* Four output pixels from eight of each row, summed as 16-bit lanes,
+     * which 4 * 255 + 2 fits in */
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+    for (; x + 4 <= dst_width && 2 * x + 8 <= src_width; x += 4) {
+      __m128i a0 = _mm_loadu_si128((const __m128i *)(r0 + 2 * x));
+      __m128i a1 = _mm_loadu_si128((const __m128i *)(r0 + 2 * x + 4));
+      __m128i b0 = _mm_loadu_si128((const __m128i *)(r1 + 2 * x));
+      __m128i b1 = _mm_loadu_si128((const __m128i *)(r1 + 2 * x + 4));
+      /* Column sums, two source pixels per register */
+      __m128i s01 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero),
+                                  _mm_unpacklo_epi8(b0, zero));
+      __m128i s23 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero),
+                                  _mm_unpackhi_epi8(b0, zero));
+      __m128i s45 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero),
+                                  _mm_unpacklo_epi8(b1, zero));
+      __m128i s67 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero),
+                                  _mm_unpackhi_epi8(b1, zero));
+      /* Each pair added into its low half */
+      s01 = _mm_add_epi16(s01, _mm_srli_si128(s01, 8));
+      s23 = _mm_add_epi16(s23, _mm_srli_si128(s23, 8));
+      s45 = _mm_add_epi16(s45, _mm_srli_si128(s45, 8));
+      s67 = _mm_add_epi16(s67, _mm_srli_si128(s67, 8));
+      __m128i lo =
+          _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s01, s23), two), 2);
+      __m128i hi =
+          _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s45, s67), two), 2);
+      _mm_storeu_si128((__m128i *)(out + x), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; x < dst_width; x++) {
+      int x0 = 2 * x;
+      int x1 = x0 + 1 < src_width ? x0 + 1 : x0;
+      uint32_t a = r0[x0], b = r0[x1], c = r1[x0], d = r1[x1];
+      uint32_t pixel = 0;
+      for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t sum = ((a >> shift) & 0xff) + ((b >> shift) & 0xff) +
+                       ((c >> shift) & 0xff) + ((d >> shift) & 0xff) + 2;
+        pixel |= (sum >> 2) << shift;
+      }
+      out[x] = pixel;
+    }
+  }
+}
@@ -1,7 +1,12 @@
-import x11/xlib, x11/x, x11/xutil
+## Captures go through XCB (xcb_library.nim), so the request can be sent
+## along with others and the reply collected when the pixels are needed.
+
+import x11/xlib except XSync, XCreateImage
+import x11/x, x11/xutil
+import x11_library, xcb_library
 
 when defined(mitshm):
-  import x11/xshm
+  import x11/xshm except XShmCreateImage, XShmAttach, XShmDetach
 
   # Stolen from https://github.com/def-/nim-syscall
   when defined(amd64):
@@ -31,53 +36,120 @@ when defined(mitshm):
     IPC_CREAT = 512
     IPC_RMID = 0
 
-type Screenshot* = object
-  image*: PXImage
-  when defined(mitshm):
-    shminfo*: PXShmSegmentInfo
+type
+  Area* = tuple[x, y, width, height: int]
+
+  Screenshot* = object
+    image*: PXImage
+    area*: Area         # what part of the window the image holds
+    wholeWindow*: bool  # follow the window's size on refresh
+    when defined(mitshm):
+      shminfo*: PXShmSegmentInfo
+    else:
+      reply: ptr XcbGetImageReply   # image.data points into it
+
+  ScreenshotRequest* = object
+    ## A capture that was sent but whose reply is not collected yet
+    cookie: XcbCookie
+    screenshot: Screenshot
 
-proc newScreenshot*(display: PDisplay, window: Window): Screenshot =
-  var attributes: XWindowAttributes
-  discard XGetWindowAttributes(display, window, addr attributes)
+proc sendCapture(display: PDisplay, window: Window,
+                 screenshot: Screenshot): XcbCookie =
+  let xcb = XGetXCBConnection(display)
+  let area = screenshot.area
+  when defined(mitshm):
+    xcb_shm_get_image(xcb, window.uint32, area.x.int16, area.y.int16,
+                      area.width.uint16, area.height.uint16,
+                      not 0'u32, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                      screenshot.shminfo.shmseg.uint32, 0)
+  else:
+    xcb_get_image(xcb, XCB_IMAGE_FORMAT_Z_PIXMAP, window.uint32,
+                  area.x.int16, area.y.int16,
+                  area.width.uint16, area.height.uint16, not 0'u32)
+
+proc geometry*(display: PDisplay,
+               window: Window): tuple[width, height: int] =
+  ## Costs a round trip. The root window's size is in the Screen struct
+  ## and doesn't need one.
+  let xcb = XGetXCBConnection(display)
+  let reply = xcb_get_geometry_reply(
+    xcb, xcb_get_geometry(xcb, window.uint32), nil)
+  if reply == nil:
+    quit "Failed to get the geometry of the window"
+  result = (reply.width.int, reply.height.int)
+  xcbFree(reply)
+
+proc requestScreenshot*(display: PDisplay, window: Window, area: Area,
+                        wholeWindow = true): ScreenshotRequest =
+  ## Sends the capture of `area` without waiting for it. It is only
+  ## flushed with the next request that waits, or an explicit xcb_flush.
+  ## Unless it covers the `wholeWindow`, refreshes keep capturing the same
+  ## area whatever the window's size.
+  var screenshot = Screenshot(area: area, wholeWindow: wholeWindow)
 
   when defined(mitshm):
-    result.shminfo = cast[PXShmSegmentInfo](
+    screenshot.shminfo = cast[PXShmSegmentInfo](
       allocShared(sizeof(TXShmSegmentInfo)))
     let screen = DefaultScreen(display)
-    result.image = XShmCreateImage(
+    screenshot.image = XShmCreateImage(
       display,
       DefaultVisual(display, screen),
       DefaultDepthOfScreen(ScreenOfDisplay(display, screen)).cuint,
       ZPixmap,
       nil,
-      result.shminfo,
-      attributes.width.cuint,
-      attributes.height.cuint)
+      screenshot.shminfo,
+      area.width.cuint,
+      area.height.cuint)
 
-    result.shminfo.shmid = syscall(
+    screenshot.shminfo.shmid = syscall(
       SHMGET,
       IPC_PRIVATE,
-      result.image.bytes_per_line * result.image.height,
+      screenshot.image.bytes_per_line * screenshot.image.height,
       IPC_CREAT or 0o777).cint
 
-    result.shminfo.shmaddr = cast[cstring](syscall(
+    screenshot.shminfo.shmaddr = cast[cstring](syscall(
       SHMAT,
-      result.shminfo.shmid,
+      screenshot.shminfo.shmid,
       0, 0))
-    result.image.data = result.shminfo.shmaddr
-    result.shminfo.readOnly = 0
+    screenshot.image.data = screenshot.shminfo.shmaddr
+    screenshot.shminfo.readOnly = 0
+
+    # Xlib hands its pending requests to XCB before XCB sends its own, so
+    # the segment is attached by the time the server sees the capture
+    discard XShmAttach(display, screenshot.shminfo)
 
-    discard XShmAttach(display, result.shminfo)
-    discard XShmGetImage(
-      display, window, result.image, 0.cint, 0.cint, AllPlanes)
+  result.screenshot = screenshot
+  result.cookie = sendCapture(display, window, screenshot)
+
+proc finish*(request: ScreenshotRequest, display: PDisplay): Screenshot =
+  ## Waits for the capture's reply
+  let xcb = XGetXCBConnection(display)
+  result = request.screenshot
+  when defined(mitshm):
+    let reply = xcb_shm_get_image_reply(xcb, request.cookie, nil)
+    if reply == nil:
+      quit "Failed to capture the window"
+    xcbFree(reply)
   else:
-    result.image = XGetImage(
-      display, window,
-      0, 0,
-      attributes.width.cuint,
-      attributes.height.cuint,
-      AllPlanes,
-      ZPixmap)
+    let reply = xcb_get_image_reply(xcb, request.cookie, nil)
+    if reply == nil:
+      quit "Failed to capture the window"
+    let screen = DefaultScreen(display)
+    result.reply = reply
+    result.image = XCreateImage(
+      display,
+      DefaultVisual(display, screen),
+      reply.depth.cuint,
+      ZPixmap,
+      0,
+      xcb_get_image_data(reply),
+      result.area.width.cuint,
+      result.area.height.cuint,
+      32, 0)
+
+proc newScreenshot*(display: PDisplay, window: Window, area: Area,
+                    wholeWindow = true): Screenshot =
+  requestScreenshot(display, window, area, wholeWindow).finish(display)
 
 proc destroy*(screenshot: Screenshot, display: PDisplay) =
   when defined(mitshm):
@@ -88,48 +160,57 @@ proc destroy*(screenshot: Screenshot, display: PDisplay) =
     discard syscall(SHMCTL, screenshot.shminfo.shmid, IPC_RMID, 0)
     deallocShared(screenshot.shminfo)
   else:
+    # The pixels belong to the reply, not to Xlib
+    screenshot.image.data = nil
     discard XDestroyImage(screenshot.image)
+    xcbFree(screenshot.reply)
 
 # TODO(#92): there is too much X11 error logging when the tracked live update window is resized
 proc refresh*(screenshot: var Screenshot, display: PDisplay, window: Window) =
-  var attributes: XWindowAttributes
-  discard XGetWindowAttributes(display, window, addr attributes)
+  ## The geometry and a capture at the current size share a round trip.
+  ## Only a resized window needs a second one.
+  let xcb = XGetXCBConnection(display)
+  let captureCookie = sendCapture(display, window, screenshot)
+
+  if screenshot.wholeWindow:
+    let geometry = xcb_get_geometry_reply(
+      xcb, xcb_get_geometry(xcb, window.uint32), nil)
+    if geometry == nil:
+      # The window is gone, keep showing its last frame
+      xcb_discard_reply(xcb, captureCookie.sequence)
+      return
+    let area: Area = (0, 0, geometry.width.int, geometry.height.int)
+    xcbFree(geometry)
+
+    if area != screenshot.area:
+      xcb_discard_reply(xcb, captureCookie.sequence)
+      screenshot.destroy(display)
+      screenshot = newScreenshot(display, window, area)
+      return
 
   when defined(mitshm):
-    if XShmGetImage(display,
-                    window, screenshot.image,
-                    0.cint, 0.cint,
-                    AllPlanes) == 0 or
-       attributes.width != screenshot.image.width or
-       attributes.height != screenshot.image.height:
-      screenshot.destroy(display)
-      screenshot = newScreenshot(display, window)
+    let reply = xcb_shm_get_image_reply(xcb, captureCookie, nil)
+    if reply != nil:
+      xcbFree(reply)
   else:
-    let refreshedImage = XGetSubImage(
-      display, window,
-      0, 0,
-      screenshot.image.width.cuint,
-      screenshot.image.height.cuint,
-      AllPlanes,
-      ZPixmap,
-      screenshot.image,
-      0, 0)
-    if refreshedImage == nil or
-       refreshedImage.width != attributes.width or
-       refreshedImage.height != attributes.height:
-      let newImage = XGetImage(
-        display, window,
-        0, 0,
-        attributes.width.cuint,
-        attributes.height.cuint,
-        AllPlanes,
-        ZPixmap)
-
-      if newImage != nil:
-        discard XDestroyImage(screenshot.image)
-        screenshot.image = newImage
-    else:
-      screenshot.image = refreshedImage
+    let reply = xcb_get_image_reply(xcb, captureCookie, nil)
+    if reply != nil:
+      xcbFree(screenshot.reply)
+      screenshot.reply = reply
+      screenshot.image.data = xcb_get_image_data(reply)
+
+proc refresh*(screenshot: var Screenshot, display: PDisplay, window: Window,
+              area: Area) =
+  ## Captures `area` of the window from now on. The image keeps its
+  ## buffers as long as the size stays the same.
+  if area.width != screenshot.area.width or
+     area.height != screenshot.area.height:
+    screenshot.destroy(display)
+    screenshot = newScreenshot(display, window, area, wholeWindow = false)
+  else:
+    screenshot.area = area
+    screenshot.wholeWindow = false
+    screenshot.refresh(display, window)
 
 proc saveToPPM*(image: PXImage, filePath: string) =
   var f = open(filePath, fmWrite)
@@ -1,15 +1,26 @@
 ## Wayland screenshot capture using grim.
 ## Captures screen to PPM format via stdout, parses into ImageData.
+## `startCapture` runs the same on a worker thread so startup can set up
+## the window and GL while grim works. Single windows are copied by the
+## compositor itself instead, through the backend (`captureToplevel`).
 
 import osproc
 import streams
 import strutils
 import image_data
+import clock
+import wayland_ffi
 
-proc captureScreen*(): ImageData =
+proc captureScreen*(region = ""): ImageData =
   ## Runs `grim -t ppm -` to capture the entire screen as PPM to stdout,
-  ## then parses the PPM P6 data into an ImageData (BGRA format).
-  let process = startProcess("grim", args = @["-t", "ppm", "-"],
+  ## then parses the PPM P6 data into an ImageData (BGRA format). A
+  ## `region` in grim's "x,y wxh" form, in logical global coordinates,
+  ## captures only that rectangle.
+  var args = @["-t", "ppm"]
+  if region.len > 0:
+    args.add ["-g", region]
+  args.add "-"
+  let process = startProcess("grim", args = args,
                               options = {poUsePath, poStdErrToStdOut})
   let output = process.outputStream.readAll()
   let exitCode = process.waitForExit()
@@ -69,7 +80,9 @@ proc captureScreen*(): ImageData =
   result.height = height
   result.bpp = 4
   result.ownsData = true
-  result.data = cast[cstring](alloc(dataSize))
+  # Shared heap: the capture may run on another thread than the one
+  # that frees it
+  result.data = cast[cstring](allocShared(dataSize))
 
   # Convert RGB (PPM) to BGRA
   for i in 0..<pixelCount:
@@ -80,3 +93,63 @@ proc captureScreen*(): ImageData =
       result.data[dstIdx + 1] = output[srcIdx + 1]  # G
       result.data[dstIdx + 2] = output[srcIdx + 0]  # R
       result.data[dstIdx + 3] = chr(255)             # A
+
+proc findToplevel*(wlState: WaylandState, match: string): int =
+  ## The first window whose title or app id contains `match`, ignoring
+  ## case, or -1
+  let needle = match.toLowerAscii
+  for i in 0.cint ..< wl_backend_toplevel_count(wlState):
+    if needle in toLowerAscii($wl_backend_toplevel_title(wlState, i)) or
+       needle in toLowerAscii($wl_backend_toplevel_app_id(wlState, i)):
+      return i.int
+  -1
+
+proc listToplevels*(wlState: WaylandState) =
+  for i in 0.cint ..< wl_backend_toplevel_count(wlState):
+    echo wl_backend_toplevel_app_id(wlState, i), "\t",
+         wl_backend_toplevel_title(wlState, i)
+
+proc capturedToplevel*(wlState: WaylandState): ImageData =
+  ## The last copy of the window. The pixels are borrowed from the backend
+  ## and stay put until a copy is requested at another size.
+  ImageData(width: wl_backend_capture_width(wlState),
+            height: wl_backend_capture_height(wlState),
+            data: wl_backend_capture_pixels(wlState),
+            bpp: 4,
+            ownsData: false)
+
+proc captureToplevel*(wlState: WaylandState, match: string): ImageData =
+  ## Copies the window `match` picks (see `findToplevel`) at its own size,
+  ## whether or not it is covered. The session stays open, so more copies
+  ## can be requested with wl_backend_capture_request.
+  let index = wlState.findToplevel(match)
+  if index < 0:
+    quit "No window matches `" & match & "`, see --list-windows"
+  if wl_backend_capture_start(wlState, index.cint) != 0:
+    quit "The compositor can't capture single windows (needs " &
+         "ext-foreign-toplevel-list-v1 and ext-image-copy-capture-v1)"
+  if wl_backend_capture_wait(wlState) != 0:
+    quit "Failed to capture the window"
+  wlState.capturedToplevel()
+
+type BackgroundCapture* = object
+  ## Must stay where it is between `startCapture` and `finish`, the worker
+  ## writes into it
+  thread: Thread[ptr BackgroundCapture]
+  image: ImageData
+  startedAt*, finishedAt*: float   # nowSeconds() on the worker
+
+proc captureWorker(capture: ptr BackgroundCapture) {.thread.} =
+  capture.startedAt = nowSeconds()
+  capture.image = captureScreen()
+  capture.finishedAt = nowSeconds()
+
+proc startCapture*(capture: var BackgroundCapture) =
+  createThread(capture.thread, captureWorker, addr capture)
+
+proc finish*(capture: var BackgroundCapture): ImageData =
+  ## Waits for the worker. A failed capture quits the process from the
+  ## worker, like captureScreen does.
+  joinThread(capture.thread)
+  result = capture.image
+  capture.image = ImageData()
@@ -0,0 +1,41 @@
+## Headers prepended to the shaders in src/*.glsl when they are compiled.
+## The sources carry no #version line, so one copy serves desktop GL,
+## GLES 3 and GLES 2. Fragment shaders write to `color`. Uniforms both
+## stages declare are `SHARED_PRECISION`: GLSL ES 1.00 refuses to link a
+## program whose stages declare one at different precisions.
+
+import gl_library
+
+type GLApi* = enum
+  apiGL       ## desktop GL, GLSL 1.30
+  apiGLES3    ## GLSL ES 3.00
+  apiGLES2    ## GLSL ES 1.00
+
+proc shaderPrelude*(api: GLApi, kind: GLenum): string =
+  let fragment = kind == GL_FRAGMENT_SHADER
+  case api
+  of apiGL:
+    result = "#version 130\n#define SHARED_PRECISION highp\n"
+    if fragment:
+      result.add "out vec4 color;\n"
+  of apiGLES3:
+    result = "#version 300 es\n#define SHARED_PRECISION highp\n"
+    if fragment:
+      result.add "precision highp float;\nout vec4 color;\n"
+  of apiGLES2:
+    # Cursor distances are in window pixels, too coarse for mediump at
+    # 4K. The macro is defined in both stages, so they agree.
+    result = "#version 100\n" &
+             "#ifdef GL_FRAGMENT_PRECISION_HIGH\n" &
+             "#define SHARED_PRECISION highp\n" &
+             "#else\n" &
+             "#define SHARED_PRECISION mediump\n" &
+             "#endif\n"
+    if fragment:
+      result.add "precision SHARED_PRECISION float;\n" &
+                 "#define in varying\n" &
+                 "#define texture texture2D\n" &
+                 "#define color gl_FragColor\n"
+    else:
+      result.add "#define in attribute\n" &
+                 "#define out varying\n"
@@ -0,0 +1,241 @@
+## XInput2 smooth scrolling for the X11 backend.
+## Core Button4/Button5 events only report whole wheel clicks. XInput 2.1
+## exposes scrolling as valuators on the master pointer, which gives
+## fractional deltas for high-resolution wheels and touchpads.
+
+import x11/xlib, x11/x
+import la
+import dynamic_library
+
+const
+  XIAllMasterDevices = 1.cint
+  XI_DeviceChanged = 1.cint
+  XI_Motion = 6.cint
+  XI_Enter = 7.cint
+  XIValuatorClass = 2.cint
+  XIScrollClass = 3.cint
+  XIScrollTypeVertical = 1.cint
+  XGenericEvent = 35.cint
+  ControlBit = 4.cint
+
+type
+  XIAnyClassInfo = object
+    classType: cint
+    sourceid: cint
+
+  XIValuatorClassInfo = object
+    classType: cint
+    sourceid: cint
+    number: cint
+    label: Atom
+    min: cdouble
+    max: cdouble
+    value: cdouble
+    resolution: cint
+    mode: cint
+
+  XIScrollClassInfo = object
+    classType: cint
+    sourceid: cint
+    number: cint
+    scrollType: cint
+    increment: cdouble
+    flags: cint
+
+  XIDeviceInfo = object
+    deviceid: cint
+    name: cstring
+    use: cint
+    attachment: cint
+    enabled: cint
+    numClasses: cint
+    classes: ptr UncheckedArray[ptr XIAnyClassInfo]
+
+  XIEventMask = object
+    deviceid: cint
+    maskLen: cint
+    mask: ptr uint8
+
+  XIButtonState = object
+    maskLen: cint
+    mask: ptr uint8
+
+  XIValuatorState = object
+    maskLen: cint
+    mask: ptr UncheckedArray[uint8]
+    values: ptr UncheckedArray[cdouble]
+
+  XIModifierState = object
+    base: cint
+    latched: cint
+    locked: cint
+    effective: cint
+
+  XIDeviceEvent = object
+    theType: cint
+    serial: culong
+    sendEvent: cint
+    display: PDisplay
+    extension: cint
+    evtype: cint
+    time: culong
+    deviceid: cint
+    sourceid: cint
+    detail: cint
+    root: Window
+    event: Window
+    child: Window
+    rootX: cdouble
+    rootY: cdouble
+    eventX: cdouble
+    eventY: cdouble
+    flags: cint
+    buttons: XIButtonState
+    valuators: XIValuatorState
+    mods: XIModifierState
+    group: XIModifierState
+
+  XGenericEventCookie = object
+    theType: cint
+    serial: culong
+    sendEvent: cint
+    display: PDisplay
+    extension: cint
+    evtype: cint
+    cookie: cuint
+    data: pointer
+
+# Loaded on first use, a missing libXi only costs smooth scrolling
+dynamicImport(loadXlibCookies, ["libX11.so.6", "libX11.so"]):
+  proc xQueryExtension(display: PDisplay, name: cstring,
+                       majorOpcode, firstEvent, firstError: ptr cint): cint
+    {.cdecl, importc: "XQueryExtension".}
+  proc xGetEventData(display: PDisplay, cookie: ptr XGenericEventCookie): cint
+    {.cdecl, importc: "XGetEventData".}
+  proc xFreeEventData(display: PDisplay, cookie: ptr XGenericEventCookie)
+    {.cdecl, importc: "XFreeEventData".}
+
+dynamicImport(loadXi, ["libXi.so.6", "libXi.so"]):
+  proc xiQueryVersion(display: PDisplay, major, minor: ptr cint): cint
+    {.cdecl, importc: "XIQueryVersion".}
+  proc xiQueryDevice(display: PDisplay, deviceid: cint, ndevices: ptr cint): ptr UncheckedArray[XIDeviceInfo]
+    {.cdecl, importc: "XIQueryDevice".}
+  proc xiFreeDeviceInfo(info: ptr UncheckedArray[XIDeviceInfo])
+    {.cdecl, importc: "XIFreeDeviceInfo".}
+  proc xiSelectEvents(display: PDisplay, win: Window, masks: ptr XIEventMask, numMasks: cint): cint
+    {.cdecl, importc: "XISelectEvents".}
+
+type
+  ScrollValuator = object
+    deviceid: cint
+    number: cint
+    increment: float
+    last: float
+
+  SmoothScroll* = object
+    enabled*: bool
+    opcode: cint
+    valuators: seq[ScrollValuator]
+
+  XI2Input* = object
+    moved*: bool
+    pos*: Vec2f
+    time*: float     ## seconds, server clock
+    scroll*: float   ## in wheel notches, positive means up
+    ctrl*: bool
+
+proc isSet(mask: ptr UncheckedArray[uint8], maskLen: cint, bit: cint): bool =
+  (bit shr 3) < maskLen and (mask[bit shr 3] and (1'u8 shl (bit and 7))) != 0
+
+proc queryValuators(ss: var SmoothScroll, display: PDisplay) =
+  ## The master pointer mirrors the classes of whichever slave device
+  ## was used last, so this has to be redone on XI_DeviceChanged.
+  ss.valuators.setLen(0)
+  var count: cint
+  let devices = xiQueryDevice(display, XIAllMasterDevices, addr count)
+  if devices == nil:
+    return
+  defer: xiFreeDeviceInfo(devices)
+
+  for i in 0..<count:
+    let device = devices[i]
+    for j in 0..<device.numClasses:
+      let class = device.classes[j]
+      if class.classType != XIScrollClass:
+        continue
+      let scroll = cast[ptr XIScrollClassInfo](class)
+      if scroll.scrollType != XIScrollTypeVertical or scroll.increment == 0.0:
+        continue
+      var valuator = ScrollValuator(deviceid: device.deviceid,
+                                    number: scroll.number,
+                                    increment: scroll.increment)
+      for k in 0..<device.numClasses:
+        let other = device.classes[k]
+        if other.classType == XIValuatorClass and
+           cast[ptr XIValuatorClassInfo](other).number == scroll.number:
+          valuator.last = cast[ptr XIValuatorClassInfo](other).value
+      ss.valuators.add(valuator)
+
+proc initSmoothScroll*(display: PDisplay, win: Window): SmoothScroll =
+  ## Selects XI2 motion events on `win`. Once this succeeds the server
+  ## stops delivering core MotionNotify to us, so pointer motion has to
+  ## be taken from `processEvent` as well.
+  if not (loadXlibCookies() and loadXi()):
+    return
+
+  var event, error: cint
+  if xQueryExtension(display, "XInputExtension", addr result.opcode,
+                     addr event, addr error) == 0:
+    return
+
+  var major = 2.cint
+  var minor = 1.cint
+  if xiQueryVersion(display, addr major, addr minor) != 0 or
+     (major == 2 and minor < 1):
+    return
+
+  result.queryValuators(display)
+  if result.valuators.len == 0:
+    return
+
+  var maskBits = 0'u8
+  maskBits = maskBits or (1'u8 shl XI_Motion)
+  maskBits = maskBits or (1'u8 shl XI_Enter)
+  maskBits = maskBits or (1'u8 shl XI_DeviceChanged)
+  var mask = XIEventMask(deviceid: XIAllMasterDevices, maskLen: 1, mask: addr maskBits)
+  discard xiSelectEvents(display, win, addr mask, 1)
+  result.enabled = true
+
+proc processEvent*(ss: var SmoothScroll, display: PDisplay, xev: var XEvent): XI2Input =
+  if not ss.enabled or xev.theType != XGenericEvent:
+    return
+
+  let cookie = cast[ptr XGenericEventCookie](addr xev)
+  if cookie.extension != ss.opcode or xGetEventData(display, cookie) == 0:
+    return
+  defer: xFreeEventData(display, cookie)
+
+  case cookie.evtype
+  of XI_DeviceChanged, XI_Enter:
+    # Valuators may have jumped while the pointer was elsewhere
+    ss.queryValuators(display)
+  of XI_Motion:
+    let ev = cast[ptr XIDeviceEvent](cookie.data)
+    result.moved = true
+    result.pos = vec2(ev.eventX.float32, ev.eventY.float32)
+    result.time = ev.time.float / 1000.0
+    result.ctrl = (ev.mods.effective and ControlBit) != 0
+
+    var index = 0
+    for bit in 0.cint..<(ev.valuators.maskLen * 8):
+      if not isSet(ev.valuators.mask, ev.valuators.maskLen, bit):
+        continue
+      let value = ev.valuators.values[index]
+      inc index
+      for valuator in ss.valuators.mitems:
+        if valuator.deviceid == ev.deviceid and valuator.number == bit:
+          # Positive valuator movement scrolls down
+          result.scroll -= (value - valuator.last) / valuator.increment
+          valuator.last = value
+  else:
+    discard
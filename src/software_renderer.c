@@ -0,0 +1,413 @@
+#include "software_renderer.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define MAX_WORKERS 15
+/* Below this many rows waking the pool costs more than it saves */
+#define MIN_ROWS_PER_BAND 32
+#define BACKGROUND 0xff1a1a1a /* glClearColor(0.1, 0.1, 0.1) */
+
+/* Sampling of one target column, shared by every row of a frame */
+typedef struct {
+  int index;  /* image column, -1 outside the image */
+  int next;   /* right neighbour for bilinear, clamped to the edge */
+  int weight; /* weight of `next`, 0..128 */
+} Column;
+
+typedef struct {
+  const SwImage *image;
+  const SwView *view;
+  uint32_t *dst;
+  int dst_stride;
+  SwRect rect;
+  int bilinear;
+  int image_x0; /* rect-relative columns that fall on the image */
+  int image_x1;
+  int bands;
+} Job;
+
+typedef struct {
+  SwRenderer *renderer;
+  int band;
+} Worker;
+
+struct SwRenderer {
+  pthread_t threads[MAX_WORKERS];
+  Worker workers[MAX_WORKERS];
+  int worker_count; /* the caller renders a band as well */
+
+  pthread_mutex_t lock;
+  pthread_cond_t start;
+  pthread_cond_t done;
+  unsigned generation;
+  int pending;
+  int quit;
+  Job job;
+
+  Column *columns;
+  int column_capacity;
+};
+
+/* ── Kernels ── */
+
+static void fill(uint32_t *out, int n, uint32_t color) {
+  for (int i = 0; i < n; i++)
+    out[i] = color;
+}
+
+static void nearest_span(uint32_t *out, const uint32_t *row,
+                         const Column *columns, int n) {
+  /* SSE2 has no gather, the column table keeps this a plain copy */
+  for (int i = 0; i < n; i++)
+    out[i] = row[columns[i].index];
+}
+
+#ifndef __SSE2__
+static inline uint32_t lerp_pixel(uint32_t a, uint32_t b, int w) {
+  uint32_t rb =
+      (((a & 0x00ff00ff) * (128 - w) + (b & 0x00ff00ff) * w) >> 7) &
+      0x00ff00ff;
+  uint32_t ag = ((((a >> 8) & 0x00ff00ff) * (128 - w) +
+                  ((b >> 8) & 0x00ff00ff) * w) >>
+                 7) &
+                0x00ff00ff;
+  return rb | (ag << 8);
+}
+#endif
+
+static void bilinear_span(uint32_t *out, const uint32_t *row0,
+                          const uint32_t *row1, int wy,
+                          const Column *columns, int n) {
+#ifdef __SSE2__
+  /* Both neighbours of a row share one register as 8 x 16-bit lanes.
+   * Weights are 7-bit so (b - a) * w stays inside int16. */
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i vy = _mm_set1_epi16((short)wy);
+  for (int i = 0; i < n; i++) {
+    const Column *c = &columns[i];
+    __m128i top = _mm_unpacklo_epi8(
+        _mm_unpacklo_epi32(_mm_cvtsi32_si128((int)row0[c->index]),
+                           _mm_cvtsi32_si128((int)row0[c->next])),
+        zero);
+    __m128i bottom = _mm_unpacklo_epi8(
+        _mm_unpacklo_epi32(_mm_cvtsi32_si128((int)row1[c->index]),
+                           _mm_cvtsi32_si128((int)row1[c->next])),
+        zero);
+    __m128i v = _mm_add_epi16(
+        top, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(bottom, top), vy),
+                            7));
+    __m128i right = _mm_srli_si128(v, 8);
+    __m128i h = _mm_add_epi16(
+        v, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(right, v),
+                                          _mm_set1_epi16((short)c->weight)),
+                          7));
+    out[i] = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(h, zero));
+  }
+#else
+  for (int i = 0; i < n; i++) {
+    const Column *c = &columns[i];
+    uint32_t top = lerp_pixel(row0[c->index], row0[c->next], c->weight);
+    uint32_t bottom = lerp_pixel(row1[c->index], row1[c->next], c->weight);
+    out[i] = lerp_pixel(top, bottom, wy);
+  }
+#endif
+}
+
+/* Multiplies every channel by shade/256 */
+static void darken(uint32_t *p, int n, int shade) {
+  int i = 0;
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i s = _mm_set1_epi16((short)shade);
+  const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+  for (; i + 4 <= n; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+    __m128i lo =
+        _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), s), 8);
+    __m128i hi =
+        _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), s), 8);
+    _mm_storeu_si128((__m128i *)(p + i),
+                     _mm_or_si128(_mm_packus_epi16(lo, hi), alpha));
+  }
+#endif
+  for (; i < n; i++) {
+    uint32_t c = p[i];
+    uint32_t rb = (((c & 0x00ff00ff) * shade) >> 8) & 0x00ff00ff;
+    uint32_t g = (((c & 0x0000ff00) * shade) >> 8) & 0x0000ff00;
+    p[i] = 0xff000000 | rb | g;
+  }
+}
+
+/* ── Frame ── */
+
+static void render_rows(SwRenderer *renderer, int y0, int y1) {
+  const Job *job = &renderer->job;
+  const SwImage *image = job->image;
+  const SwView *view = job->view;
+  const Column *columns = renderer->columns;
+  int w = job->rect.width;
+  int ix0 = job->image_x0;
+  int ix1 = job->image_x1;
+
+  /* frag.glsl mixes everything outside the flashlight towards black */
+  int shade = (int)lround((1.0 - view->fl_shadow) * 256.0);
+  double radius = view->fl_radius * view->scale;
+
+  for (int y = y0; y < y1; y++) {
+    uint32_t *out = job->dst + (size_t)y * job->dst_stride + job->rect.x;
+    double v = view->origin_y + (y + 0.5) / view->scale;
+    if (v < 0.0 || v >= image->height || ix1 <= ix0) {
+      fill(out, w, BACKGROUND);
+      continue;
+    }
+    fill(out, ix0, BACKGROUND);
+    fill(out + ix1, w - ix1, BACKGROUND);
+
+    if (job->bilinear) {
+      double s = v - 0.5;
+      int r0 = (int)floor(s);
+      int wy = (int)lround((s - r0) * 128.0);
+      int r1 = r0 + 1;
+      if (r0 < 0)
+        r0 = 0;
+      if (r1 > image->height - 1)
+        r1 = image->height - 1;
+      bilinear_span(out + ix0, image->pixels + (size_t)r0 * image->width,
+                    image->pixels + (size_t)r1 * image->width, wy,
+                    columns + ix0, ix1 - ix0);
+    } else {
+      nearest_span(out + ix0, image->pixels + (size_t)(int)v * image->width,
+                   columns + ix0, ix1 - ix0);
+    }
+
+    if (shade < 256) {
+      /* Columns whose pixel centre lies inside the circle stay lit */
+      int lit0 = ix1, lit1 = ix1;
+      double dy = y + 0.5 - view->cursor_y;
+      if (dy * dy < radius * radius) {
+        double half = sqrt(radius * radius - dy * dy);
+        lit0 = (int)ceil(view->cursor_x - half - 0.5) - job->rect.x;
+        lit1 = (int)floor(view->cursor_x + half - 0.5) + 1 - job->rect.x;
+        lit0 = lit0 < ix0 ? ix0 : lit0 > ix1 ? ix1 : lit0;
+        lit1 = lit1 < lit0 ? lit0 : lit1 > ix1 ? ix1 : lit1;
+      }
+      darken(out + ix0, lit0 - ix0, shade);
+      darken(out + lit1, ix1 - lit1, shade);
+    }
+  }
+}
+
+static void render_band(SwRenderer *renderer, int band) {
+  const Job *job = &renderer->job;
+  int h = job->rect.height;
+  if (band >= job->bands)
+    return;
+  render_rows(renderer, job->rect.y + h * band / job->bands,
+              job->rect.y + h * (band + 1) / job->bands);
+}
+
+static void *worker_main(void *arg) {
+  Worker *worker = arg;
+  SwRenderer *renderer = worker->renderer;
+  unsigned seen = 0;
+
+  pthread_mutex_lock(&renderer->lock);
+  for (;;) {
+    while (renderer->generation == seen && !renderer->quit)
+      pthread_cond_wait(&renderer->start, &renderer->lock);
+    if (renderer->quit)
+      break;
+    seen = renderer->generation;
+    pthread_mutex_unlock(&renderer->lock);
+
+    render_band(renderer, worker->band);
+
+    pthread_mutex_lock(&renderer->lock);
+    if (--renderer->pending == 0)
+      pthread_cond_signal(&renderer->done);
+  }
+  pthread_mutex_unlock(&renderer->lock);
+  return NULL;
+}
+
+static int prepare_columns(SwRenderer *renderer, const SwImage *image,
+                           const SwView *view, SwRect rect, int bilinear) {
+  if (rect.width > renderer->column_capacity) {
+    Column *columns = realloc(renderer->columns, sizeof(Column) * rect.width);
+    if (!columns)
+      return -1;
+    renderer->columns = columns;
+    renderer->column_capacity = rect.width;
+  }
+
+  Job *job = &renderer->job;
+  job->image_x0 = rect.width;
+  job->image_x1 = 0;
+  for (int i = 0; i < rect.width; i++) {
+    Column *c = &renderer->columns[i];
+    double u = view->origin_x + (rect.x + i + 0.5) / view->scale;
+    if (u < 0.0 || u >= image->width) {
+      c->index = -1;
+      continue;
+    }
+    if (i < job->image_x0)
+      job->image_x0 = i;
+    job->image_x1 = i + 1;
+
+    if (bilinear) {
+      double s = u - 0.5;
+      int c0 = (int)floor(s);
+      c->weight = (int)lround((s - c0) * 128.0);
+      c->index = c0 < 0 ? 0 : c0;
+      c->next = c0 + 1 > image->width - 1 ? image->width - 1 : c0 + 1;
+    } else {
+      c->index = (int)u;
+      c->next = c->index;
+      c->weight = 0;
+    }
+  }
+  if (job->image_x1 <= job->image_x0)
+    job->image_x0 = job->image_x1 = 0;
+  return 0;
+}
+
+/* ── Public API ── */
+
+SwRenderer *sw_renderer_create(int threads) {
+  SwRenderer *renderer = calloc(1, sizeof(SwRenderer));
+  if (!renderer)
+    return NULL;
+
+  if (threads <= 0)
+    threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (threads < 1)
+    threads = 1;
+  if (threads > MAX_WORKERS + 1)
+    threads = MAX_WORKERS + 1;
+
+  pthread_mutex_init(&renderer->lock, NULL);
+  pthread_cond_init(&renderer->start, NULL);
+  pthread_cond_init(&renderer->done, NULL);
+
+  for (int i = 0; i < threads - 1; i++) {
+    Worker *worker = &renderer->workers[renderer->worker_count];
+    worker->renderer = renderer;
+    worker->band = renderer->worker_count + 1;
+    if (pthread_create(&renderer->threads[renderer->worker_count], NULL,
+                       worker_main, worker) != 0)
+      break;
+    renderer->worker_count++;
+  }
+  return renderer;
+}
+
+void sw_renderer_destroy(SwRenderer *renderer) {
+  if (!renderer)
+    return;
+
+  pthread_mutex_lock(&renderer->lock);
+  renderer->quit = 1;
+  pthread_cond_broadcast(&renderer->start);
+  pthread_mutex_unlock(&renderer->lock);
+  for (int i = 0; i < renderer->worker_count; i++)
+    pthread_join(renderer->threads[i], NULL);
+
+  pthread_cond_destroy(&renderer->done);
+  pthread_cond_destroy(&renderer->start);
+  pthread_mutex_destroy(&renderer->lock);
+  free(renderer->columns);
+  free(renderer);
+}
+
+void sw_render(SwRenderer *renderer, const SwImage *image, const SwView *view,
+               uint32_t *dst, int dst_stride, int dst_width, int dst_height,
+               SwRect rect) {
+  /* Clip to the target */
+  if (rect.x < 0) {
+    rect.width += rect.x;
+    rect.x = 0;
+  }
+  if (rect.y < 0) {
+    rect.height += rect.y;
+    rect.y = 0;
+  }
+  if (rect.x + rect.width > dst_width)
+    rect.width = dst_width - rect.x;
+  if (rect.y + rect.height > dst_height)
+    rect.height = dst_height - rect.y;
+  if (rect.width <= 0 || rect.height <= 0 || view->scale <= 0.0)
+    return;
+
+  /* Magnified pixels stay crisp like GL_NEAREST; scaled down the image
+   * would alias badly without filtering */
+  int bilinear = view->scale < 1.0;
+  if (prepare_columns(renderer, image, view, rect, bilinear) < 0)
+    return;
+
+  Job *job = &renderer->job;
+  job->image = image;
+  job->view = view;
+  job->dst = dst;
+  job->dst_stride = dst_stride;
+  job->rect = rect;
+  job->bilinear = bilinear;
+
+  int bands = rect.height / MIN_ROWS_PER_BAND;
+  if (bands > renderer->worker_count + 1)
+    bands = renderer->worker_count + 1;
+  if (bands <= 1) {
+    job->bands = 1;
+    render_band(renderer, 0);
+    return;
+  }
+
+  /* Workers past `bands` have no band and return at once */
+  job->bands = bands;
+  pthread_mutex_lock(&renderer->lock);
+  renderer->pending = renderer->worker_count;
+  renderer->generation++;
+  pthread_cond_broadcast(&renderer->start);
+  pthread_mutex_unlock(&renderer->lock);
+
+  render_band(renderer, 0);
+
+  pthread_mutex_lock(&renderer->lock);
+  while (renderer->pending > 0)
+    pthread_cond_wait(&renderer->done, &renderer->lock);
+  pthread_mutex_unlock(&renderer->lock);
+}
+
+int sw_view_damage(const SwView *a, const SwView *b, int width, int height,
+                   SwRect *out) {
+  if (a->origin_x != b->origin_x || a->origin_y != b->origin_y ||
+      a->scale != b->scale || a->fl_shadow != b->fl_shadow ||
+      a->fl_radius != b->fl_radius) {
+    *out = (SwRect){0, 0, width, height};
+    return 1;
+  }
+  if ((a->cursor_x == b->cursor_x && a->cursor_y == b->cursor_y) ||
+      a->fl_shadow == 0.0)
+    return 0;
+
+  /* Only the flashlight moved: the circle it left and the one it entered */
+  double radius = a->fl_radius * a->scale + 1.0;
+  double x0 = fmin(a->cursor_x, b->cursor_x) - radius;
+  double y0 = fmin(a->cursor_y, b->cursor_y) - radius;
+  double x1 = fmax(a->cursor_x, b->cursor_x) + radius;
+  double y1 = fmax(a->cursor_y, b->cursor_y) + radius;
+  int ix0 = x0 < 0.0 ? 0 : (int)floor(x0);
+  int iy0 = y0 < 0.0 ? 0 : (int)floor(y0);
+  int ix1 = x1 > width ? width : (int)ceil(x1);
+  int iy1 = y1 > height ? height : (int)ceil(y1);
+  if (ix1 <= ix0 || iy1 <= iy0)
+    return 0;
+  *out = (SwRect){ix0, iy0, ix1 - ix0, iy1 - iy0};
+  return 1;
+}
@@ -0,0 +1,47 @@
+#ifndef SOFTWARE_RENDERER_H
+#define SOFTWARE_RENDERER_H
+
+#include <stdint.h>
+
+/* CPU implementation of vert.glsl/frag.glsl for machines without usable
+ * GL. Renders into XRGB8888 memory, split into row bands over a pool of
+ * worker threads. */
+
+typedef struct {
+  const uint32_t *pixels; /* BGRA, tightly packed */
+  int width;
+  int height;
+} SwImage;
+
+typedef struct {
+  double origin_x; /* image pixel at the window's top-left corner */
+  double origin_y;
+  double scale; /* window pixels per image pixel */
+  double cursor_x;
+  double cursor_y;
+  double fl_shadow;
+  double fl_radius; /* in image pixels, like the flRadius uniform */
+} SwView;
+
+typedef struct {
+  int x, y, width, height;
+} SwRect;
+
+typedef struct SwRenderer SwRenderer;
+
+/* threads <= 0 picks one per online CPU */
+SwRenderer *sw_renderer_create(int threads);
+void sw_renderer_destroy(SwRenderer *renderer);
+
+/* Redraws `rect` of a dst_width x dst_height target. Nearest sampling
+ * while magnifying, bilinear when the image is scaled down. */
+void sw_render(SwRenderer *renderer, const SwImage *image, const SwView *view,
+               uint32_t *dst, int dst_stride, int dst_width, int dst_height,
+               SwRect rect);
+
+/* Area that differs between two views of a width x height target.
+ * Returns 0 when nothing changed. */
+int sw_view_damage(const SwView *a, const SwView *b, int width, int height,
+                   SwRect *out);
+
+#endif
@@ -0,0 +1,78 @@
+## The GPU side of pyramid.nim: a fixed set of tile textures, refilled
+## least recently used first straight from the mapped pyramid file, so only
+## tiles the camera has shown are ever read from disk.
+
+import tables
+import gl_library
+import pyramid
+
+const
+  CACHE_TILES = 512         # 128 MiB of textures
+  UPLOADS_PER_FRAME = 32    # 8 MiB, the rest come on later frames
+
+type
+  TileKey* = tuple[level, x, y: int]
+
+  TileCache* = object
+    textures: seq[GLuint]
+    keys: seq[TileKey]
+    lastUsed: seq[int]      # frame
+    slots: Table[TileKey, int]
+    frame: int
+    uploads: int
+
+proc beginFrame*(cache: var TileCache) =
+  inc cache.frame
+  cache.uploads = 0
+
+proc newTileTexture(): GLuint =
+  glGenTextures(1, addr result)
+  glBindTexture(GL_TEXTURE_2D, result)
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST)
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST)
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE)
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE)
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA.GLint, TILE_SIZE, TILE_SIZE, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, nil)
+
+proc lookup*(cache: var TileCache, pyramid: Pyramid, key: TileKey): GLuint =
+  ## The texture holding a tile, uploaded first if it has to be. 0 when
+  ## this frame is out of uploads, or every texture holds a tile it shows.
+  let cached = cache.slots.getOrDefault(key, -1)
+  if cached >= 0:
+    cache.lastUsed[cached] = cache.frame
+    return cache.textures[cached]
+  if cache.uploads >= UPLOADS_PER_FRAME:
+    return 0
+
+  var slot = 0
+  if cache.textures.len < CACHE_TILES:
+    cache.textures.add newTileTexture()
+    cache.keys.add key
+    cache.lastUsed.add 0
+    slot = cache.textures.high
+  else:
+    for i in 1 .. cache.lastUsed.high:
+      if cache.lastUsed[i] < cache.lastUsed[slot]:
+        slot = i
+    if cache.lastUsed[slot] == cache.frame:
+      return 0
+    cache.slots.del(cache.keys[slot])
+
+  glBindTexture(GL_TEXTURE_2D, cache.textures[slot])
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4)
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, TILE_SIZE, TILE_SIZE, GL_RGBA,
+                  GL_UNSIGNED_BYTE, pyramid.tile(key.level, key.x, key.y))
+  cache.keys[slot] = key
+  cache.lastUsed[slot] = cache.frame
+  cache.slots[key] = slot
+  inc cache.uploads
+  cache.textures[slot]
+
+proc destroy*(cache: var TileCache) =
+  if cache.textures.len > 0:
+    glDeleteTextures(cache.textures.len.GLsizei, addr cache.textures[0])
+  cache.textures = @[]
+  cache.keys = @[]
+  cache.lastUsed = @[]
+  cache.slots.clear()
@@ -0,0 +1,25 @@
+## Startup timeline. Spans are recorded as the steps finish, possibly on
+## different threads, and printed together once the first frame is up so
+## it is visible what ran in parallel.
+
+import strutils
+import clock
+
+type Timeline* = object
+  title: string
+  origin: float
+  spans: seq[tuple[name: string, start, stop: float]]
+
+proc initTimeline*(title: string): Timeline =
+  Timeline(title: title, origin: nowSeconds())
+
+proc add*(timeline: var Timeline, name: string, start, stop: float) =
+  ## `start` and `stop` are nowSeconds() values
+  timeline.spans.add((name, start, stop))
+
+proc report*(timeline: Timeline) =
+  proc ms(t: float): string =
+    formatFloat((t - timeline.origin) * 1000.0, ffDecimal, 1).align(8)
+  echo timeline.title, " (ms):"
+  for span in timeline.spans:
+    echo "  ", span.name.alignLeft(12), ms(span.start), " ..", ms(span.stop)
@@ -1,13 +1,12 @@
-#version 130
 in vec3 aPos;
 in vec2 aTexCoord;
 out vec2 texcoord;
 
 uniform vec2 cameraPos;
-uniform float cameraScale;
-uniform vec2 windowSize;
+uniform SHARED_PRECISION float cameraScale;
+uniform SHARED_PRECISION vec2 windowSize;
 uniform vec2 screenshotSize;
-uniform vec2 cursorPos;
+uniform SHARED_PRECISION vec2 cursorPos;
 
 vec3 to_world(vec3 v) {
     vec2 ratio = vec2(
@@ -0,0 +1,1084 @@
+#define VK_USE_PLATFORM_WAYLAND_KHR
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vulkan/vulkan.h>
+#include <wayland-client.h>
+
+/* Optional Vulkan renderer for the Wayland backend (built with -d:vulkan).
+ * The screenshot is uploaded once into a device-local image, and every
+ * swapchain image gets a command buffer recorded up front. Per frame we
+ * only write the view into that image's uniform buffer and submit. */
+
+#define FRAMES_IN_FLIGHT 2
+#define MAX_SWAPCHAIN_IMAGES 8
+
+/* std140 layout of the View block in vulkan_vert.glsl/vulkan_frag.glsl */
+typedef struct {
+  float origin[2]; /* image pixel at the window's top-left corner */
+  float window_size[2];
+  float screenshot_size[2];
+  float cursor[2];
+  float scale; /* window pixels per image pixel */
+  float fl_shadow;
+  float fl_radius; /* in image pixels, like the flRadius uniform */
+  float pad;
+} ViewUniforms;
+
+typedef struct {
+  VkImage image; /* owned by the swapchain */
+  VkImageView view;
+  VkFramebuffer framebuffer;
+  VkCommandBuffer commands;
+  VkBuffer uniforms;
+  VkDeviceMemory uniforms_memory;
+  ViewUniforms *mapped;
+  VkDescriptorSet descriptors;
+  VkSemaphore render_done;
+  VkFence fence; /* frame fence that last submitted this image, borrowed */
+} SwapchainImage;
+
+typedef struct {
+  VkInstance instance;
+  VkSurfaceKHR surface;
+  VkPhysicalDevice physical_device;
+  VkPhysicalDeviceMemoryProperties memory_properties;
+  VkDevice device;
+  uint32_t queue_family;
+  VkQueue queue;
+  VkCommandPool command_pool;
+
+  /* the screenshot */
+  VkImage texture;
+  VkDeviceMemory texture_memory;
+  VkImageView texture_view;
+  VkSampler sampler;
+  int image_width;
+  int image_height;
+
+  VkDescriptorSetLayout set_layout;
+  VkDescriptorPool descriptor_pool;
+  VkPipelineLayout pipeline_layout;
+  VkRenderPass render_pass;
+  VkPipeline pipeline;
+
+  VkSwapchainKHR swapchain;
+  VkSurfaceFormatKHR format;
+  VkPresentModeKHR present_mode;
+  VkExtent2D extent;
+  uint32_t image_count;
+  SwapchainImage images[MAX_SWAPCHAIN_IMAGES];
+  int stale; /* suboptimal or out of date, recreate before the next frame */
+
+  VkSemaphore acquired[FRAMES_IN_FLIGHT];
+  VkFence frame_fences[FRAMES_IN_FLIGHT];
+  uint32_t frame;
+} VulkanRenderer;
+
+static int check(VkResult result, const char *what) {
+  if (result == VK_SUCCESS)
+    return 0;
+  fprintf(stderr, "Vulkan: %s failed (%d)\n", what, result);
+  return -1;
+}
+
+static int find_memory_type(VulkanRenderer *r, uint32_t type_bits,
+                            VkMemoryPropertyFlags flags) {
+  const VkPhysicalDeviceMemoryProperties *props = &r->memory_properties;
+  for (uint32_t i = 0; i < props->memoryTypeCount; i++) {
+    if ((type_bits & (1u << i)) &&
+        (props->memoryTypes[i].propertyFlags & flags) == flags)
+      return (int)i;
+  }
+  return -1;
+}
+
+static int allocate_memory(VulkanRenderer *r, VkMemoryRequirements reqs,
+                           VkMemoryPropertyFlags flags,
+                           VkDeviceMemory *memory) {
+  int type = find_memory_type(r, reqs.memoryTypeBits, flags);
+  if (type < 0) {
+    fprintf(stderr, "Vulkan: no memory type with flags 0x%x\n", flags);
+    return -1;
+  }
+  VkMemoryAllocateInfo info = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+      .allocationSize = reqs.size,
+      .memoryTypeIndex = (uint32_t)type,
+  };
+  return check(vkAllocateMemory(r->device, &info, NULL, memory),
+               "vkAllocateMemory");
+}
+
+static int create_buffer(VulkanRenderer *r, VkDeviceSize size,
+                         VkBufferUsageFlags usage, VkMemoryPropertyFlags flags,
+                         VkBuffer *buffer, VkDeviceMemory *memory) {
+  VkBufferCreateInfo info = {
+      .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .size = size,
+      .usage = usage,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+  };
+  if (check(vkCreateBuffer(r->device, &info, NULL, buffer), "vkCreateBuffer"))
+    return -1;
+
+  VkMemoryRequirements reqs;
+  vkGetBufferMemoryRequirements(r->device, *buffer, &reqs);
+  if (allocate_memory(r, reqs, flags, memory))
+    return -1;
+  return check(vkBindBufferMemory(r->device, *buffer, *memory, 0),
+               "vkBindBufferMemory");
+}
+
+/* ── Instance and device ── */
+
+static int create_instance(VulkanRenderer *r) {
+  const char *extensions[] = {
+      VK_KHR_SURFACE_EXTENSION_NAME,
+      VK_KHR_WAYLAND_SURFACE_EXTENSION_NAME,
+  };
+  VkApplicationInfo app = {
+      .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+      .pApplicationName = "boomer",
+      .apiVersion = VK_API_VERSION_1_0,
+  };
+  VkInstanceCreateInfo info = {
+      .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+      .pApplicationInfo = &app,
+      .enabledExtensionCount = 2,
+      .ppEnabledExtensionNames = extensions,
+  };
+  return check(vkCreateInstance(&info, NULL, &r->instance),
+               "vkCreateInstance");
+}
+
+/* Higher is better. CPU implementations such as lavapipe are accepted,
+ * only as a last resort. */
+static int device_rank(VkPhysicalDeviceType type) {
+  switch (type) {
+  case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+    return 4;
+  case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+    return 3;
+  case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+    return 2;
+  case VK_PHYSICAL_DEVICE_TYPE_CPU:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+/* Returns the first queue family of `device` that can draw and present
+ * to our surface, or -1 */
+static int find_queue_family(VulkanRenderer *r, VkPhysicalDevice device) {
+  uint32_t count = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &count, NULL);
+  VkQueueFamilyProperties *families = calloc(count, sizeof(*families));
+  if (!families)
+    return -1;
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &count, families);
+
+  int found = -1;
+  for (uint32_t i = 0; i < count && found < 0; i++) {
+    VkBool32 present = VK_FALSE;
+    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, r->surface, &present);
+    if ((families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) && present)
+      found = (int)i;
+  }
+  free(families);
+  return found;
+}
+
+static int pick_device(VulkanRenderer *r) {
+  uint32_t count = 0;
+  vkEnumeratePhysicalDevices(r->instance, &count, NULL);
+  VkPhysicalDevice *devices = calloc(count ? count : 1, sizeof(*devices));
+  if (!devices)
+    return -1;
+  vkEnumeratePhysicalDevices(r->instance, &count, devices);
+
+  int best_rank = -1;
+  for (uint32_t i = 0; i < count; i++) {
+    int family = find_queue_family(r, devices[i]);
+    if (family < 0)
+      continue;
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(devices[i], &props);
+    int rank = device_rank(props.deviceType);
+    if (rank > best_rank) {
+      best_rank = rank;
+      r->physical_device = devices[i];
+      r->queue_family = (uint32_t)family;
+    }
+  }
+  free(devices);
+
+  if (best_rank < 0) {
+    fprintf(stderr, "Vulkan: no device can present to the Wayland surface\n");
+    return -1;
+  }
+
+  VkPhysicalDeviceProperties props;
+  vkGetPhysicalDeviceProperties(r->physical_device, &props);
+  printf("Vulkan device: %s\n", props.deviceName);
+  vkGetPhysicalDeviceMemoryProperties(r->physical_device,
+                                      &r->memory_properties);
+  return 0;
+}
+
+static int create_device(VulkanRenderer *r) {
+  float priority = 1.0f;
+  VkDeviceQueueCreateInfo queue = {
+      .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+      .queueFamilyIndex = r->queue_family,
+      .queueCount = 1,
+      .pQueuePriorities = &priority,
+  };
+  const char *extensions[] = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+  VkDeviceCreateInfo info = {
+      .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+      .queueCreateInfoCount = 1,
+      .pQueueCreateInfos = &queue,
+      .enabledExtensionCount = 1,
+      .ppEnabledExtensionNames = extensions,
+  };
+  if (check(vkCreateDevice(r->physical_device, &info, NULL, &r->device),
+            "vkCreateDevice"))
+    return -1;
+  vkGetDeviceQueue(r->device, r->queue_family, 0, &r->queue);
+
+  VkCommandPoolCreateInfo pool = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+      .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+      .queueFamilyIndex = r->queue_family,
+  };
+  return check(vkCreateCommandPool(r->device, &pool, NULL, &r->command_pool),
+               "vkCreateCommandPool");
+}
+
+/* ── Screenshot texture ── */
+
+static void image_barrier(VkCommandBuffer cmd, VkImage image,
+                          VkImageLayout from, VkImageLayout to,
+                          VkAccessFlags src_access, VkAccessFlags dst_access,
+                          VkPipelineStageFlags src_stage,
+                          VkPipelineStageFlags dst_stage) {
+  VkImageMemoryBarrier barrier = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      .srcAccessMask = src_access,
+      .dstAccessMask = dst_access,
+      .oldLayout = from,
+      .newLayout = to,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = image,
+      .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+  };
+  vkCmdPipelineBarrier(cmd, src_stage, dst_stage, 0, 0, NULL, 0, NULL, 1,
+                       &barrier);
+}
+
+/* Copies the BGRA pixels into a staging buffer and from there into a
+ * device-local, optimally tiled image. Blocks until the copy is done. */
+static int upload_texture(VulkanRenderer *r, const void *pixels, int width,
+                          int height) {
+  VkPhysicalDeviceProperties props;
+  vkGetPhysicalDeviceProperties(r->physical_device, &props);
+  uint32_t max_size = props.limits.maxImageDimension2D;
+  if ((uint32_t)width > max_size || (uint32_t)height > max_size) {
+    fprintf(stderr, "Vulkan: %dx%d screenshot exceeds the %u pixel limit\n",
+            width, height, max_size);
+    return -1;
+  }
+
+  VkDeviceSize size = (VkDeviceSize)width * height * 4;
+  VkBuffer staging = VK_NULL_HANDLE;
+  VkDeviceMemory staging_memory = VK_NULL_HANDLE;
+  VkCommandBuffer cmd = VK_NULL_HANDLE;
+  int result = -1;
+
+  if (create_buffer(r, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                    &staging, &staging_memory))
+    goto out;
+
+  void *mapped;
+  if (check(vkMapMemory(r->device, staging_memory, 0, size, 0, &mapped),
+            "vkMapMemory"))
+    goto out;
+  memcpy(mapped, pixels, size);
+  vkUnmapMemory(r->device, staging_memory);
+
+  VkImageCreateInfo image = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+      .imageType = VK_IMAGE_TYPE_2D,
+      .format = VK_FORMAT_B8G8R8A8_UNORM, /* same byte order as the capture */
+      .extent = {(uint32_t)width, (uint32_t)height, 1},
+      .mipLevels = 1,
+      .arrayLayers = 1,
+      .samples = VK_SAMPLE_COUNT_1_BIT,
+      .tiling = VK_IMAGE_TILING_OPTIMAL,
+      .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+  };
+  if (check(vkCreateImage(r->device, &image, NULL, &r->texture),
+            "vkCreateImage"))
+    goto out;
+
+  VkMemoryRequirements reqs;
+  vkGetImageMemoryRequirements(r->device, r->texture, &reqs);
+  if (allocate_memory(r, reqs, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                      &r->texture_memory) ||
+      check(vkBindImageMemory(r->device, r->texture, r->texture_memory, 0),
+            "vkBindImageMemory"))
+    goto out;
+
+  VkCommandBufferAllocateInfo alloc = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+      .commandPool = r->command_pool,
+      .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+      .commandBufferCount = 1,
+  };
+  if (check(vkAllocateCommandBuffers(r->device, &alloc, &cmd),
+            "vkAllocateCommandBuffers"))
+    goto out;
+
+  VkCommandBufferBeginInfo begin = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+  };
+  vkBeginCommandBuffer(cmd, &begin);
+  image_barrier(cmd, r->texture, VK_IMAGE_LAYOUT_UNDEFINED,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0,
+                VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT);
+  VkBufferImageCopy region = {
+      .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+      .imageExtent = {(uint32_t)width, (uint32_t)height, 1},
+  };
+  vkCmdCopyBufferToImage(cmd, staging, r->texture,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+  image_barrier(cmd, r->texture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+  vkEndCommandBuffer(cmd);
+
+  VkSubmitInfo submit = {
+      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+      .commandBufferCount = 1,
+      .pCommandBuffers = &cmd,
+  };
+  if (check(vkQueueSubmit(r->queue, 1, &submit, VK_NULL_HANDLE),
+            "vkQueueSubmit") ||
+      check(vkQueueWaitIdle(r->queue), "vkQueueWaitIdle"))
+    goto out;
+
+  VkImageViewCreateInfo view = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+      .image = r->texture,
+      .viewType = VK_IMAGE_VIEW_TYPE_2D,
+      .format = VK_FORMAT_B8G8R8A8_UNORM,
+      .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+  };
+  if (check(vkCreateImageView(r->device, &view, NULL, &r->texture_view),
+            "vkCreateImageView"))
+    goto out;
+
+  VkSamplerCreateInfo sampler = {
+      .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+      .magFilter = VK_FILTER_NEAREST,
+      .minFilter = VK_FILTER_NEAREST,
+      .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+      .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+  };
+  if (check(vkCreateSampler(r->device, &sampler, NULL, &r->sampler),
+            "vkCreateSampler"))
+    goto out;
+
+  r->image_width = width;
+  r->image_height = height;
+  result = 0;
+
+out:
+  if (cmd)
+    vkFreeCommandBuffers(r->device, r->command_pool, 1, &cmd);
+  if (staging)
+    vkDestroyBuffer(r->device, staging, NULL);
+  if (staging_memory)
+    vkFreeMemory(r->device, staging_memory, NULL);
+  return result;
+}
+
+/* ── Pipeline ── */
+
+static VkShaderModule create_shader(VulkanRenderer *r, const uint32_t *code,
+                                    size_t words) {
+  VkShaderModuleCreateInfo info = {
+      .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+      .codeSize = words * sizeof(uint32_t),
+      .pCode = code,
+  };
+  VkShaderModule module = VK_NULL_HANDLE;
+  check(vkCreateShaderModule(r->device, &info, NULL, &module),
+        "vkCreateShaderModule");
+  return module;
+}
+
+static void pick_surface_format(VulkanRenderer *r) {
+  uint32_t count = 0;
+  vkGetPhysicalDeviceSurfaceFormatsKHR(r->physical_device, r->surface, &count,
+                                       NULL);
+  VkSurfaceFormatKHR *formats = calloc(count ? count : 1, sizeof(*formats));
+  if (!formats)
+    return;
+  vkGetPhysicalDeviceSurfaceFormatsKHR(r->physical_device, r->surface, &count,
+                                       formats);
+
+  /* UNORM, like the default framebuffer of the GL path; an sRGB target
+   * would brighten the screenshot */
+  r->format = formats[0];
+  for (uint32_t i = 0; i < count; i++) {
+    if (formats[i].format == VK_FORMAT_B8G8R8A8_UNORM ||
+        formats[i].format == VK_FORMAT_R8G8B8A8_UNORM) {
+      r->format = formats[i];
+      break;
+    }
+  }
+  free(formats);
+}
+
+static int create_pipeline(VulkanRenderer *r, const uint32_t *vert_code,
+                           size_t vert_words, const uint32_t *frag_code,
+                           size_t frag_words) {
+  VkDescriptorSetLayoutBinding bindings[] = {
+      {
+          .binding = 0,
+          .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+          .descriptorCount = 1,
+          .stageFlags =
+              VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+      },
+      {
+          .binding = 1,
+          .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+          .descriptorCount = 1,
+          .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+      },
+  };
+  VkDescriptorSetLayoutCreateInfo set_layout = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+      .bindingCount = 2,
+      .pBindings = bindings,
+  };
+  if (check(vkCreateDescriptorSetLayout(r->device, &set_layout, NULL,
+                                        &r->set_layout),
+            "vkCreateDescriptorSetLayout"))
+    return -1;
+
+  VkDescriptorPoolSize pool_sizes[] = {
+      {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, MAX_SWAPCHAIN_IMAGES},
+      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_SWAPCHAIN_IMAGES},
+  };
+  VkDescriptorPoolCreateInfo pool = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+      .maxSets = MAX_SWAPCHAIN_IMAGES,
+      .poolSizeCount = 2,
+      .pPoolSizes = pool_sizes,
+  };
+  if (check(vkCreateDescriptorPool(r->device, &pool, NULL,
+                                   &r->descriptor_pool),
+            "vkCreateDescriptorPool"))
+    return -1;
+
+  VkPipelineLayoutCreateInfo layout = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+      .setLayoutCount = 1,
+      .pSetLayouts = &r->set_layout,
+  };
+  if (check(vkCreatePipelineLayout(r->device, &layout, NULL,
+                                   &r->pipeline_layout),
+            "vkCreatePipelineLayout"))
+    return -1;
+
+  VkAttachmentDescription color = {
+      .format = r->format.format,
+      .samples = VK_SAMPLE_COUNT_1_BIT,
+      .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+      .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+      .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+      .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+      .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+  };
+  VkAttachmentReference color_ref = {
+      0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+  VkSubpassDescription subpass = {
+      .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+      .colorAttachmentCount = 1,
+      .pColorAttachments = &color_ref,
+  };
+  /* The layout transition has to wait for the acquire semaphore */
+  VkSubpassDependency dependency = {
+      .srcSubpass = VK_SUBPASS_EXTERNAL,
+      .dstSubpass = 0,
+      .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+      .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+      .srcAccessMask = 0,
+      .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+  };
+  VkRenderPassCreateInfo render_pass = {
+      .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+      .attachmentCount = 1,
+      .pAttachments = &color,
+      .subpassCount = 1,
+      .pSubpasses = &subpass,
+      .dependencyCount = 1,
+      .pDependencies = &dependency,
+  };
+  if (check(vkCreateRenderPass(r->device, &render_pass, NULL,
+                               &r->render_pass),
+            "vkCreateRenderPass"))
+    return -1;
+
+  VkShaderModule vert = create_shader(r, vert_code, vert_words);
+  VkShaderModule frag = create_shader(r, frag_code, frag_words);
+  if (!vert || !frag) {
+    if (vert)
+      vkDestroyShaderModule(r->device, vert, NULL);
+    if (frag)
+      vkDestroyShaderModule(r->device, frag, NULL);
+    return -1;
+  }
+
+  VkPipelineShaderStageCreateInfo stages[] = {
+      {
+          .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+          .stage = VK_SHADER_STAGE_VERTEX_BIT,
+          .module = vert,
+          .pName = "main",
+      },
+      {
+          .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+          .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+          .module = frag,
+          .pName = "main",
+      },
+  };
+  /* The quad comes from gl_VertexIndex, there are no vertex buffers */
+  VkPipelineVertexInputStateCreateInfo vertex_input = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+  };
+  VkPipelineInputAssemblyStateCreateInfo input_assembly = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+      .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+  };
+  VkPipelineViewportStateCreateInfo viewport = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+      .viewportCount = 1,
+      .scissorCount = 1,
+  };
+  VkPipelineRasterizationStateCreateInfo rasterization = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+      .polygonMode = VK_POLYGON_MODE_FILL,
+      .cullMode = VK_CULL_MODE_NONE,
+      .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+      .lineWidth = 1.0f,
+  };
+  VkPipelineMultisampleStateCreateInfo multisample = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+      .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+  };
+  VkPipelineColorBlendAttachmentState blend_attachment = {
+      .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                        VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+  };
+  VkPipelineColorBlendStateCreateInfo blend = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+      .attachmentCount = 1,
+      .pAttachments = &blend_attachment,
+  };
+  /* Dynamic so a resize only re-records command buffers */
+  VkDynamicState dynamic_states[] = {VK_DYNAMIC_STATE_VIEWPORT,
+                                     VK_DYNAMIC_STATE_SCISSOR};
+  VkPipelineDynamicStateCreateInfo dynamic = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+      .dynamicStateCount = 2,
+      .pDynamicStates = dynamic_states,
+  };
+  VkGraphicsPipelineCreateInfo info = {
+      .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+      .stageCount = 2,
+      .pStages = stages,
+      .pVertexInputState = &vertex_input,
+      .pInputAssemblyState = &input_assembly,
+      .pViewportState = &viewport,
+      .pRasterizationState = &rasterization,
+      .pMultisampleState = &multisample,
+      .pColorBlendState = &blend,
+      .pDynamicState = &dynamic,
+      .layout = r->pipeline_layout,
+      .renderPass = r->render_pass,
+      .subpass = 0,
+  };
+  VkResult result = vkCreateGraphicsPipelines(r->device, VK_NULL_HANDLE, 1,
+                                              &info, NULL, &r->pipeline);
+  vkDestroyShaderModule(r->device, vert, NULL);
+  vkDestroyShaderModule(r->device, frag, NULL);
+  return check(result, "vkCreateGraphicsPipelines");
+}
+
+/* ── Swapchain ── */
+
+static void destroy_swapchain_images(VulkanRenderer *r) {
+  for (uint32_t i = 0; i < r->image_count; i++) {
+    SwapchainImage *image = &r->images[i];
+    if (image->render_done)
+      vkDestroySemaphore(r->device, image->render_done, NULL);
+    if (image->commands)
+      vkFreeCommandBuffers(r->device, r->command_pool, 1, &image->commands);
+    if (image->uniforms)
+      vkDestroyBuffer(r->device, image->uniforms, NULL);
+    if (image->uniforms_memory)
+      vkFreeMemory(r->device, image->uniforms_memory, NULL);
+    if (image->framebuffer)
+      vkDestroyFramebuffer(r->device, image->framebuffer, NULL);
+    if (image->view)
+      vkDestroyImageView(r->device, image->view, NULL);
+  }
+  memset(r->images, 0, sizeof(r->images));
+  r->image_count = 0;
+  if (r->descriptor_pool)
+    vkResetDescriptorPool(r->device, r->descriptor_pool, 0);
+}
+
+static int record_commands(VulkanRenderer *r, SwapchainImage *image) {
+  VkCommandBuffer cmd = image->commands;
+  VkCommandBufferBeginInfo begin = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+  };
+  if (check(vkBeginCommandBuffer(cmd, &begin), "vkBeginCommandBuffer"))
+    return -1;
+
+  VkClearValue clear = {.color = {{0.1f, 0.1f, 0.1f, 1.0f}}};
+  VkRenderPassBeginInfo pass = {
+      .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+      .renderPass = r->render_pass,
+      .framebuffer = image->framebuffer,
+      .renderArea = {{0, 0}, r->extent},
+      .clearValueCount = 1,
+      .pClearValues = &clear,
+  };
+  vkCmdBeginRenderPass(cmd, &pass, VK_SUBPASS_CONTENTS_INLINE);
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, r->pipeline);
+  VkViewport viewport = {
+      0.0f, 0.0f, (float)r->extent.width, (float)r->extent.height,
+      0.0f, 1.0f};
+  VkRect2D scissor = {{0, 0}, r->extent};
+  vkCmdSetViewport(cmd, 0, 1, &viewport);
+  vkCmdSetScissor(cmd, 0, 1, &scissor);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          r->pipeline_layout, 0, 1, &image->descriptors, 0,
+                          NULL);
+  vkCmdDraw(cmd, 4, 1, 0, 0);
+  vkCmdEndRenderPass(cmd);
+  return check(vkEndCommandBuffer(cmd), "vkEndCommandBuffer");
+}
+
+static int setup_swapchain_image(VulkanRenderer *r, SwapchainImage *image) {
+  VkImageViewCreateInfo view = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+      .image = image->image,
+      .viewType = VK_IMAGE_VIEW_TYPE_2D,
+      .format = r->format.format,
+      .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+  };
+  if (check(vkCreateImageView(r->device, &view, NULL, &image->view),
+            "vkCreateImageView"))
+    return -1;
+
+  VkFramebufferCreateInfo framebuffer = {
+      .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+      .renderPass = r->render_pass,
+      .attachmentCount = 1,
+      .pAttachments = &image->view,
+      .width = r->extent.width,
+      .height = r->extent.height,
+      .layers = 1,
+  };
+  if (check(vkCreateFramebuffer(r->device, &framebuffer, NULL,
+                                &image->framebuffer),
+            "vkCreateFramebuffer"))
+    return -1;
+
+  /* Host-coherent and mapped for the renderer's lifetime, the only thing
+   * written per frame */
+  if (create_buffer(r, sizeof(ViewUniforms), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                    &image->uniforms, &image->uniforms_memory) ||
+      check(vkMapMemory(r->device, image->uniforms_memory, 0,
+                        sizeof(ViewUniforms), 0, (void **)&image->mapped),
+            "vkMapMemory"))
+    return -1;
+
+  VkDescriptorSetAllocateInfo alloc = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      .descriptorPool = r->descriptor_pool,
+      .descriptorSetCount = 1,
+      .pSetLayouts = &r->set_layout,
+  };
+  if (check(vkAllocateDescriptorSets(r->device, &alloc, &image->descriptors),
+            "vkAllocateDescriptorSets"))
+    return -1;
+
+  VkDescriptorBufferInfo buffer_info = {image->uniforms, 0,
+                                        sizeof(ViewUniforms)};
+  VkDescriptorImageInfo image_info = {
+      r->sampler, r->texture_view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+  VkWriteDescriptorSet writes[] = {
+      {
+          .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+          .dstSet = image->descriptors,
+          .dstBinding = 0,
+          .descriptorCount = 1,
+          .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+          .pBufferInfo = &buffer_info,
+      },
+      {
+          .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+          .dstSet = image->descriptors,
+          .dstBinding = 1,
+          .descriptorCount = 1,
+          .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+          .pImageInfo = &image_info,
+      },
+  };
+  vkUpdateDescriptorSets(r->device, 2, writes, 0, NULL);
+
+  VkSemaphoreCreateInfo semaphore = {
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+  };
+  if (check(vkCreateSemaphore(r->device, &semaphore, NULL,
+                              &image->render_done),
+            "vkCreateSemaphore"))
+    return -1;
+
+  VkCommandBufferAllocateInfo commands = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+      .commandPool = r->command_pool,
+      .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+      .commandBufferCount = 1,
+  };
+  if (check(vkAllocateCommandBuffers(r->device, &commands, &image->commands),
+            "vkAllocateCommandBuffers"))
+    return -1;
+  return record_commands(r, image);
+}
+
+/* (Re)creates the swapchain at width x height buffer pixels and records
+ * a command buffer per image */
+static int create_swapchain(VulkanRenderer *r, int width, int height) {
+  vkDeviceWaitIdle(r->device);
+  destroy_swapchain_images(r);
+
+  VkSurfaceCapabilitiesKHR caps;
+  if (check(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(r->physical_device,
+                                                      r->surface, &caps),
+            "vkGetPhysicalDeviceSurfaceCapabilitiesKHR"))
+    return -1;
+
+  /* Wayland leaves the extent to us */
+  VkExtent2D extent = caps.currentExtent;
+  if (extent.width == UINT32_MAX) {
+    extent.width = (uint32_t)width;
+    extent.height = (uint32_t)height;
+    if (extent.width < caps.minImageExtent.width)
+      extent.width = caps.minImageExtent.width;
+    if (extent.width > caps.maxImageExtent.width)
+      extent.width = caps.maxImageExtent.width;
+    if (extent.height < caps.minImageExtent.height)
+      extent.height = caps.minImageExtent.height;
+    if (extent.height > caps.maxImageExtent.height)
+      extent.height = caps.maxImageExtent.height;
+  }
+
+  uint32_t min_images = caps.minImageCount + 1;
+  if (caps.maxImageCount > 0 && min_images > caps.maxImageCount)
+    min_images = caps.maxImageCount;
+  if (min_images > MAX_SWAPCHAIN_IMAGES)
+    min_images = MAX_SWAPCHAIN_IMAGES;
+
+  VkCompositeAlphaFlagBitsKHR alpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+  if (!(caps.supportedCompositeAlpha & alpha))
+    alpha = VK_COMPOSITE_ALPHA_INHERIT_BIT_KHR;
+
+  VkSwapchainKHR old = r->swapchain;
+  VkSwapchainCreateInfoKHR info = {
+      .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+      .surface = r->surface,
+      .minImageCount = min_images,
+      .imageFormat = r->format.format,
+      .imageColorSpace = r->format.colorSpace,
+      .imageExtent = extent,
+      .imageArrayLayers = 1,
+      .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+      .imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
+      .preTransform = caps.currentTransform,
+      .compositeAlpha = alpha,
+      .presentMode = r->present_mode,
+      .clipped = VK_TRUE,
+      .oldSwapchain = old,
+  };
+  VkResult result =
+      vkCreateSwapchainKHR(r->device, &info, NULL, &r->swapchain);
+  if (old)
+    vkDestroySwapchainKHR(r->device, old, NULL);
+  if (check(result, "vkCreateSwapchainKHR")) {
+    r->swapchain = VK_NULL_HANDLE;
+    return -1;
+  }
+  r->extent = extent;
+  r->stale = 0;
+
+  uint32_t count = 0;
+  vkGetSwapchainImagesKHR(r->device, r->swapchain, &count, NULL);
+  if (count > MAX_SWAPCHAIN_IMAGES) {
+    fprintf(stderr, "Vulkan: swapchain has %u images, at most %d are "
+                    "supported\n",
+            count, MAX_SWAPCHAIN_IMAGES);
+    return -1;
+  }
+  VkImage images[MAX_SWAPCHAIN_IMAGES];
+  vkGetSwapchainImagesKHR(r->device, r->swapchain, &count, images);
+
+  r->image_count = count;
+  for (uint32_t i = 0; i < count; i++) {
+    r->images[i].image = images[i];
+    if (setup_swapchain_image(r, &r->images[i]))
+      return -1;
+  }
+  return 0;
+}
+
+static VkPresentModeKHR pick_present_mode(VulkanRenderer *r,
+                                          int low_latency) {
+  /* FIFO is always there and waits for the compositor like swap interval
+   * 1. MAILBOX never blocks and never tears, the caller paces itself. */
+  if (!low_latency)
+    return VK_PRESENT_MODE_FIFO_KHR;
+
+  uint32_t count = 0;
+  vkGetPhysicalDeviceSurfacePresentModesKHR(r->physical_device, r->surface,
+                                            &count, NULL);
+  VkPresentModeKHR *modes = calloc(count ? count : 1, sizeof(*modes));
+  if (!modes)
+    return VK_PRESENT_MODE_FIFO_KHR;
+  vkGetPhysicalDeviceSurfacePresentModesKHR(r->physical_device, r->surface,
+                                            &count, modes);
+
+  VkPresentModeKHR mode = VK_PRESENT_MODE_FIFO_KHR;
+  for (uint32_t i = 0; i < count; i++) {
+    if (modes[i] == VK_PRESENT_MODE_MAILBOX_KHR)
+      mode = VK_PRESENT_MODE_MAILBOX_KHR;
+  }
+  free(modes);
+  if (mode == VK_PRESENT_MODE_FIFO_KHR)
+    fprintf(stderr, "Vulkan: no mailbox present mode, using FIFO\n");
+  return mode;
+}
+
+static int create_sync(VulkanRenderer *r) {
+  VkSemaphoreCreateInfo semaphore = {
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+  };
+  VkFenceCreateInfo fence = {
+      .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+      .flags = VK_FENCE_CREATE_SIGNALED_BIT,
+  };
+  for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+    if (check(vkCreateSemaphore(r->device, &semaphore, NULL,
+                                &r->acquired[i]),
+              "vkCreateSemaphore") ||
+        check(vkCreateFence(r->device, &fence, NULL, &r->frame_fences[i]),
+              "vkCreateFence"))
+      return -1;
+  }
+  return 0;
+}
+
+/* ── Public API for Nim ── */
+
+void vulkan_renderer_destroy(VulkanRenderer *r);
+
+/* `pixels` is BGRA and only read during the call. The SPIR-V comes from
+ * vulkan_vert.glsl/vulkan_frag.glsl, compiled when boomer is built. */
+VulkanRenderer *vulkan_renderer_create(
+    struct wl_display *display, struct wl_surface *surface, int width,
+    int height, const void *pixels, int image_width, int image_height,
+    const uint32_t *vert_code, size_t vert_words, const uint32_t *frag_code,
+    size_t frag_words, int low_latency) {
+  VulkanRenderer *r = calloc(1, sizeof(VulkanRenderer));
+  if (!r)
+    return NULL;
+
+  if (create_instance(r))
+    goto fail;
+
+  VkWaylandSurfaceCreateInfoKHR surface_info = {
+      .sType = VK_STRUCTURE_TYPE_WAYLAND_SURFACE_CREATE_INFO_KHR,
+      .display = display,
+      .surface = surface,
+  };
+  if (check(vkCreateWaylandSurfaceKHR(r->instance, &surface_info, NULL,
+                                      &r->surface),
+            "vkCreateWaylandSurfaceKHR"))
+    goto fail;
+
+  if (pick_device(r) || create_device(r) ||
+      upload_texture(r, pixels, image_width, image_height))
+    goto fail;
+
+  pick_surface_format(r);
+  r->present_mode = pick_present_mode(r, low_latency);
+  if (create_pipeline(r, vert_code, vert_words, frag_code, frag_words) ||
+      create_sync(r) || create_swapchain(r, width, height))
+    goto fail;
+
+  return r;
+
+fail:
+  vulkan_renderer_destroy(r);
+  return NULL;
+}
+
+/* Draws one frame of a width x height buffer. Returns -1 when the device
+ * is gone. */
+int vulkan_renderer_draw(VulkanRenderer *r, int width, int height,
+                         double origin_x, double origin_y, double scale,
+                         double cursor_x, double cursor_y, double fl_shadow,
+                         double fl_radius) {
+  if (width <= 0 || height <= 0)
+    return 0;
+  if (r->stale || !r->swapchain || (uint32_t)width != r->extent.width ||
+      (uint32_t)height != r->extent.height) {
+    if (create_swapchain(r, width, height))
+      return -1;
+  }
+
+  VkFence fence = r->frame_fences[r->frame];
+  vkWaitForFences(r->device, 1, &fence, VK_TRUE, UINT64_MAX);
+
+  uint32_t index;
+  VkResult result =
+      vkAcquireNextImageKHR(r->device, r->swapchain, UINT64_MAX,
+                            r->acquired[r->frame], VK_NULL_HANDLE, &index);
+  if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+    r->stale = 1;
+    return 0;
+  }
+  if (result != VK_SUBOPTIMAL_KHR && check(result, "vkAcquireNextImageKHR"))
+    return -1;
+
+  /* The image's uniforms may still be read by an earlier frame */
+  SwapchainImage *image = &r->images[index];
+  if (image->fence && image->fence != fence)
+    vkWaitForFences(r->device, 1, &image->fence, VK_TRUE, UINT64_MAX);
+  image->fence = fence;
+
+  ViewUniforms view = {
+      .origin = {(float)origin_x, (float)origin_y},
+      .window_size = {(float)r->extent.width, (float)r->extent.height},
+      .screenshot_size = {(float)r->image_width, (float)r->image_height},
+      .cursor = {(float)cursor_x, (float)cursor_y},
+      .scale = (float)scale,
+      .fl_shadow = (float)fl_shadow,
+      .fl_radius = (float)fl_radius,
+  };
+  *image->mapped = view;
+
+  vkResetFences(r->device, 1, &fence);
+  VkPipelineStageFlags wait_stage =
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  VkSubmitInfo submit = {
+      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+      .waitSemaphoreCount = 1,
+      .pWaitSemaphores = &r->acquired[r->frame],
+      .pWaitDstStageMask = &wait_stage,
+      .commandBufferCount = 1,
+      .pCommandBuffers = &image->commands,
+      .signalSemaphoreCount = 1,
+      .pSignalSemaphores = &image->render_done,
+  };
+  if (check(vkQueueSubmit(r->queue, 1, &submit, fence), "vkQueueSubmit"))
+    return -1;
+
+  VkPresentInfoKHR present = {
+      .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+      .waitSemaphoreCount = 1,
+      .pWaitSemaphores = &image->render_done,
+      .swapchainCount = 1,
+      .pSwapchains = &r->swapchain,
+      .pImageIndices = &index,
+  };
+  result = vkQueuePresentKHR(r->queue, &present);
+  if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+    r->stale = 1;
+  else if (check(result, "vkQueuePresentKHR"))
+    return -1;
+
+  r->frame = (r->frame + 1) % FRAMES_IN_FLIGHT;
+  return 0;
+}
+
+void vulkan_renderer_destroy(VulkanRenderer *r) {
+  if (!r)
+    return;
+
+  if (r->device) {
+    vkDeviceWaitIdle(r->device);
+    destroy_swapchain_images(r);
+    if (r->swapchain)
+      vkDestroySwapchainKHR(r->device, r->swapchain, NULL);
+    for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+      if (r->acquired[i])
+        vkDestroySemaphore(r->device, r->acquired[i], NULL);
+      if (r->frame_fences[i])
+        vkDestroyFence(r->device, r->frame_fences[i], NULL);
+    }
+    if (r->pipeline)
+      vkDestroyPipeline(r->device, r->pipeline, NULL);
+    if (r->render_pass)
+      vkDestroyRenderPass(r->device, r->render_pass, NULL);
+    if (r->pipeline_layout)
+      vkDestroyPipelineLayout(r->device, r->pipeline_layout, NULL);
+    if (r->descriptor_pool)
+      vkDestroyDescriptorPool(r->device, r->descriptor_pool, NULL);
+    if (r->set_layout)
+      vkDestroyDescriptorSetLayout(r->device, r->set_layout, NULL);
+    if (r->sampler)
+      vkDestroySampler(r->device, r->sampler, NULL);
+    if (r->texture_view)
+      vkDestroyImageView(r->device, r->texture_view, NULL);
+    if (r->texture)
+      vkDestroyImage(r->device, r->texture, NULL);
+    if (r->texture_memory)
+      vkFreeMemory(r->device, r->texture_memory, NULL);
+    if (r->command_pool)
+      vkDestroyCommandPool(r->device, r->command_pool, NULL);
+    vkDestroyDevice(r->device, NULL);
+  }
+  if (r->surface)
+    vkDestroySurfaceKHR(r->instance, r->surface, NULL);
+  if (r->instance)
+    vkDestroyInstance(r->instance, NULL);
+  free(r);
+}
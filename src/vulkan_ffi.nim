@@ -0,0 +1,50 @@
+## Nim FFI bindings for the optional Vulkan renderer (vulkan_backend.c).
+## Only imported when built with -d:vulkan. The shaders are compiled to
+## SPIR-V with glslc at build time. The renderer is part of
+## libboomer_wayland.so and loaded with `loadVulkanRenderer`.
+
+import os, strutils
+import dynamic_library
+import wayland_ffi
+
+type VulkanRenderer* = distinct pointer
+
+proc compileSpirv(file, stage: string): seq[uint32] {.compileTime.} =
+  let path = currentSourcePath.parentDir / file
+  let (output, exitCode) = gorgeEx("glslc -fshader-stage=" & stage &
+                                   " -mfmt=num -o - " & quoteShell(path))
+  doAssert exitCode == 0, "glslc failed on " & file & ":\n" & output
+  for word in output.split({',', ' ', '\n', '\r', '\t'}):
+    if word.len > 0:
+      result.add uint32(parseHexInt(word))
+
+const
+  vertexSpirv = compileSpirv("vulkan_vert.glsl", "vert")
+  fragmentSpirv = compileSpirv("vulkan_frag.glsl", "frag")
+
+dynamicImport(loadVulkanRenderer, backendLibraries()):
+  proc vulkan_renderer_create(display, surface: pointer, width, height: cint,
+                              pixels: cstring, imageWidth, imageHeight: cint,
+                              vertCode: ptr uint32, vertWords: csize_t,
+                              fragCode: ptr uint32, fragWords: csize_t,
+                              lowLatency: cint): VulkanRenderer {.importc, cdecl.}
+  proc vulkan_renderer_draw*(r: VulkanRenderer, width, height: cint,
+                             originX, originY, scale: cdouble,
+                             cursorX, cursorY: cdouble,
+                             flShadow, flRadius: cdouble): cint {.importc, cdecl.}
+  proc vulkan_renderer_destroy*(r: VulkanRenderer) {.importc, cdecl.}
+
+proc newVulkanRenderer*(display, surface: pointer, width, height: cint,
+                        pixels: cstring, imageWidth, imageHeight: cint,
+                        lowLatency: bool): VulkanRenderer =
+  ## `pixels` is only read during the call, the image is copied to the GPU.
+  ## Nil when the renderer can't start, including when it can't be loaded.
+  if not loadVulkanRenderer():
+    return VulkanRenderer(nil)
+  var vert = vertexSpirv
+  var frag = fragmentSpirv
+  vulkan_renderer_create(display, surface, width, height,
+                         pixels, imageWidth, imageHeight,
+                         addr vert[0], csize_t(vert.len),
+                         addr frag[0], csize_t(frag.len),
+                         if lowLatency: 1.cint else: 0.cint)
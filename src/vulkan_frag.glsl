@@ -0,0 +1,27 @@
+#version 450
+
+// Vulkan counterpart of frag.glsl. The texture is B8G8R8A8, so no swizzle,
+// and gl_FragCoord already has its origin at the top-left like cursorPos.
+
+layout(std140, binding = 0) uniform View {
+    vec2 origin;
+    vec2 windowSize;
+    vec2 screenshotSize;
+    vec2 cursorPos;
+    float cameraScale;
+    float flShadow;
+    float flRadius;
+} view;
+
+layout(binding = 1) uniform sampler2D tex;
+
+layout(location = 0) in vec2 texcoord;
+layout(location = 0) out vec4 color;
+
+void main()
+{
+    // Opaque like frag.glsl, for swapchains that inherit the alpha
+    color = mix(
+        vec4(texture(tex, texcoord).rgb, 1.0), vec4(0.0, 0.0, 0.0, 1.0),
+        distance(view.cursorPos, gl_FragCoord.xy) < (view.flRadius * view.cameraScale) ? 0.0 : view.flShadow);
+}
@@ -0,0 +1,25 @@
+#version 450
+
+// Vulkan counterpart of vert.glsl. The quad is generated from
+// gl_VertexIndex and placed with the same mapping the other renderers use:
+// window pixel = (image pixel - origin) * scale.
+
+layout(std140, binding = 0) uniform View {
+    vec2 origin;
+    vec2 windowSize;
+    vec2 screenshotSize;
+    vec2 cursorPos;
+    float cameraScale;
+    float flShadow;
+    float flRadius;
+} view;
+
+layout(location = 0) out vec2 texcoord;
+
+void main()
+{
+    vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+    vec2 pixel = (corner * view.screenshotSize - view.origin) * view.cameraScale;
+    gl_Position = vec4(pixel / view.windowSize * 2.0 - 1.0, 0.0, 1.0);
+    texcoord = corner;
+}
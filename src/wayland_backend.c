@@ -1,16 +1,105 @@
+#define _GNU_SOURCE
 #include <EGL/egl.h>
+#include <dlfcn.h>
 #include <linux/input-event-codes.h>
+#include <math.h>
 #include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include <wayland-client.h>
 #include <wayland-egl.h>
 
+#include "ext-foreign-toplevel-list-v1-protocol.h"
+#include "ext-image-capture-source-v1-protocol.h"
+#include "ext-image-copy-capture-v1-protocol.h"
+#include "fractional-scale-v1-protocol.h"
+#include "software_renderer.h"
+#include "tearing-control-v1-protocol.h"
+#include "viewporter-protocol.h"
 #include "wlr-layer-shell-protocol.h"
+#include "wlr-screencopy-protocol.h"
 #include "xdg-shell-protocol.h"
 
 #define MAX_KEY_EVENTS 16
+#define MAX_MOTION_EVENTS 64
+
+/* Renderers, must match the Renderer enum in boomer_wayland.nim */
+#define WL_RENDERER_GL 0
+#define WL_RENDERER_VIEWPORT 1 /* compositor crops and scales, no EGL */
+#define WL_RENDERER_SOFTWARE 2 /* CPU rendering into wl_shm, no EGL */
+#define WL_RENDERER_GLES 3     /* like GL, but prefers a GLES context */
+#define WL_RENDERER_VULKAN 4   /* vulkan_backend.c presents, no EGL */
+
+#define SW_BUFFER_COUNT 2
+
+/* Initialization is driven by wl_display_sync callbacks, each one marks
+ * that the compositor has answered everything sent before it */
+enum {
+  INIT_GLOBALS, /* waiting for the registry to list the globals */
+  INIT_EVENTS,  /* waiting for seat, output and first configure events */
+  INIT_DONE,
+};
+
+/* A software renderer target. Each one remembers the view it holds, so
+ * only what changed since is redrawn when it comes around again. */
+typedef struct {
+  struct wl_buffer *buffer;
+  uint32_t *data;
+  int width;
+  int height;
+  int busy; /* attached until wl_buffer.release */
+  int valid;
+  SwView view;
+} SwBuffer;
+
+/* A window from ext_foreign_toplevel_list_v1, for --window */
+typedef struct {
+  struct ext_foreign_toplevel_handle_v1 *handle;
+  char *title;
+  char *app_id;
+} Toplevel;
+
+/* Copies of one window through ext-image-copy-capture. The compositor
+ * draws the window on its own for it, so covered or off-screen windows
+ * come out whole, and nothing else on the output is copied. */
+typedef struct {
+  struct ext_image_capture_source_v1 *source;
+  struct ext_image_copy_capture_session_v1 *session;
+  struct ext_image_copy_capture_frame_v1 *frame; /* in flight */
+  int width; /* constraints, valid once `constrained` */
+  int height;
+  uint32_t format;      /* 0 when the session offers nothing we read */
+  uint32_t next_format; /* collected until the session's done */
+  int constrained;
+  struct wl_buffer *buffer;
+  void *data;
+  int buffer_width;
+  int buffer_height;
+  int ready;   /* a copy landed since wl_backend_capture_ready looked */
+  int stopped; /* the window is gone */
+} WindowCapture;
+
+/* One wlr-screencopy copy of a rectangle of the output at a time, what
+ * the lens shows */
+typedef struct {
+  struct zwlr_screencopy_frame_v1 *frame; /* in flight */
+  uint32_t format; /* offered for this frame, 0 when none we read */
+  int width;
+  int height;
+  int y_invert;
+  struct wl_buffer *buffer;
+  void *data;
+  int buffer_width;
+  int buffer_height;
+  int ready; /* a copy landed since wl_backend_region_ready looked */
+} RegionCapture;
+
+/* Axis units that make up one wheel notch when the compositor only sends
+ * continuous values (libinput reports 15 degrees per detent). */
+#define AXIS_UNITS_PER_NOTCH 15.0
 
 /* ── Wayland state exposed to Nim ── */
 
@@ -34,19 +123,64 @@ typedef struct {
   struct zwlr_layer_shell_v1 *layer_shell;
   struct zwlr_layer_surface_v1 *layer_surface;
 
+  /* tearing-control (--low-latency) */
+  struct wp_tearing_control_manager_v1 *tearing_manager;
+  struct wp_tearing_control_v1 *tearing_control;
+
+  /* HiDPI: fractional scale through a viewport, integer buffer scale as a
+   * fallback */
+  struct wp_viewporter *viewporter;
+  struct wp_viewport *viewport;
+  struct wp_fractional_scale_manager_v1 *fractional_scale_manager;
+  struct wp_fractional_scale_v1 *fractional_scale;
+  uint32_t scale120; /* preferred fractional scale, 120 = 1.0 */
+  int output_scale;  /* integer wl_output scale */
+
+  /* compositor-side zoom: the screenshot lives in a wl_shm buffer on a
+   * subsurface, the parent only carries a 1x1 background */
+  int renderer;
+  struct wl_shm *shm;
+  struct wl_subcompositor *subcompositor;
+  struct wl_surface *image_surface;
+  struct wl_subsurface *image_subsurface;
+  struct wp_viewport *image_viewport;
+  struct wl_buffer *image_buffer;
+  struct wl_buffer *background_buffer;
+  int background_attached;
+  int image_width;
+  int image_height;
+  int image_mapped;
+  struct wl_callback *frame_callback;
+
+  /* software renderer */
+  SwRenderer *sw_renderer;
+  SwImage sw_image; /* borrowed from Nim */
+  SwBuffer sw_buffers[SW_BUFFER_COUNT];
+  SwView sw_view; /* last committed view and its size */
+  int sw_width;
+  int sw_height;
+
   /* EGL */
   struct wl_egl_window *egl_window;
   EGLDisplay egl_display;
   EGLContext egl_context;
   EGLSurface egl_surface;
   EGLConfig egl_config;
+  int gl_api; /* 0 desktop GL, otherwise the GLES major version */
+  int egl_all_procs; /* eglGetProcAddress finds core functions too */
+  void *gl_library;  /* where they come from otherwise */
 
   /* state */
-  int width;
+  int width; /* logical surface size */
   int height;
+  int buffer_width; /* physical pixels we render */
+  int buffer_height;
   int configured;
   int closed;
   int windowed;
+  int low_latency; /* swap interval 0, async presentation requested */
+  int hidden;      /* unmapped by wl_backend_hide */
+  int init_phase;  /* INIT_* */
 
   /* input state – updated by callbacks, read by Nim */
   float pointer_x;
@@ -54,9 +188,16 @@ typedef struct {
   int button_pressed; /* left button currently held */
   int button_just_pressed;
   int button_just_released;
-  int scroll_delta; /* +1 up, -1 down per frame */
+  double scroll_delta; /* in wheel notches, positive up, per frame */
   int ctrl_held;
 
+  /* axis events are grouped by wl_pointer.frame (seat v5+) */
+  uint32_t seat_version;
+  uint32_t axis_source;
+  double axis_value;   /* continuous vertical axis units */
+  int axis_value120;   /* high-resolution wheel, 120 per notch */
+  int axis_has_value120;
+
   /* key event queue for this frame */
   struct {
     int key;
@@ -65,8 +206,43 @@ typedef struct {
   int key_event_count;
   int key_read_index; /* cursor for Nim to iterate */
 
+  /* timestamped pointer motion for this frame, feeds the pointer history */
+  struct {
+    uint32_t time; /* ms, compositor clock */
+    float x;
+    float y;
+  } motion_events[MAX_MOTION_EVENTS];
+  int motion_event_count;
+
   /* output info */
   int output_rate; /* refresh rate in mHz */
+  int output_x;    /* position in the compositor's global space */
+  int output_y;
+
+  /* single-window capture (--window) */
+  struct ext_foreign_toplevel_list_v1 *toplevel_list;
+  struct ext_foreign_toplevel_image_capture_source_manager_v1
+      *toplevel_sources;
+  struct ext_image_copy_capture_manager_v1 *copy_capture;
+  Toplevel *toplevels;
+  int toplevel_count;
+  int toplevel_capacity;
+  WindowCapture capture;
+
+  /* lens (--lens): the pointer is followed through an image copy cursor
+   * session on the output, what is under it comes from wlr-screencopy */
+  struct zwlr_screencopy_manager_v1 *screencopy;
+  uint32_t screencopy_version;
+  struct ext_output_image_capture_source_manager_v1 *output_sources;
+  struct ext_image_capture_source_v1 *cursor_source;
+  struct ext_image_copy_capture_cursor_session_v1 *cursor_session;
+  int cursor_x; /* output buffer pixels */
+  int cursor_y;
+  int cursor_inside;
+  int output_width; /* current mode, physical pixels */
+  int output_height;
+  int output_transform; /* enum wl_output_transform */
+  RegionCapture region;
 } WaylandState;
 
 /* ── Forward declarations for listeners ── */
@@ -81,6 +257,178 @@ static const struct wl_registry_listener registry_listener = {
     .global_remove = registry_global_remove,
 };
 
+/* ── HiDPI ── */
+
+static double surface_scale(WaylandState *state) {
+  if (state->viewport && state->scale120 > 0)
+    return state->scale120 / 120.0;
+  return state->output_scale > 0 ? state->output_scale : 1;
+}
+
+/* Recomputes the buffer size from the logical size and current scale.
+ * Buffer scale and viewport destination are double-buffered and land
+ * with the next eglSwapBuffers, together with the resized EGL window. */
+static void update_buffer_size(WaylandState *state) {
+  if (!state->surface || state->width <= 0 || state->height <= 0)
+    return;
+
+  if (state->viewport && state->scale120 > 0) {
+    /* Rounded half away from zero, as fractional-scale-v1 asks */
+    state->buffer_width = (state->width * state->scale120 + 60) / 120;
+    state->buffer_height = (state->height * state->scale120 + 60) / 120;
+    wp_viewport_set_destination(state->viewport, state->width, state->height);
+    wl_surface_set_buffer_scale(state->surface, 1);
+  } else if (state->viewport) {
+    /* Compositor zoom without fractional-scale: the 1x1 background
+     * can't carry a buffer scale, the viewport stretches it instead */
+    int scale = state->output_scale > 0 ? state->output_scale : 1;
+    state->buffer_width = state->width * scale;
+    state->buffer_height = state->height * scale;
+    wp_viewport_set_destination(state->viewport, state->width, state->height);
+  } else {
+    int scale = state->output_scale > 0 ? state->output_scale : 1;
+    state->buffer_width = state->width * scale;
+    state->buffer_height = state->height * scale;
+    wl_surface_set_buffer_scale(state->surface, scale);
+  }
+
+  if (state->egl_window) {
+    wl_egl_window_resize(state->egl_window, state->buffer_width,
+                         state->buffer_height, 0, 0);
+  }
+}
+
+/* fractional scale */
+static void fractional_scale_preferred(void *data,
+                                       struct wp_fractional_scale_v1 *fs,
+                                       uint32_t scale) {
+  WaylandState *state = (WaylandState *)data;
+  state->scale120 = scale;
+  update_buffer_size(state);
+}
+static const struct wp_fractional_scale_v1_listener fractional_scale_listener =
+    {
+        .preferred_scale = fractional_scale_preferred,
+};
+
+/* frame callback, paces the shm renderers like swap interval 1 */
+static void frame_done(void *data, struct wl_callback *callback,
+                       uint32_t time) {
+  WaylandState *state = (WaylandState *)data;
+  wl_callback_destroy(callback);
+  state->frame_callback = NULL;
+}
+static const struct wl_callback_listener frame_listener = {
+    .done = frame_done,
+};
+
+/* Creates a buffer of a 32-bit `format` backed by a memfd. The mapping is
+ * returned in `data` and belongs to the caller. */
+static struct wl_buffer *create_shm_buffer(WaylandState *state, int width,
+                                           int height, uint32_t format,
+                                           void **data) {
+  int stride = width * 4;
+  size_t size = (size_t)stride * height;
+
+  int fd = memfd_create("boomer-shm", MFD_CLOEXEC);
+  if (fd < 0) {
+    perror("memfd_create");
+    return NULL;
+  }
+  if (ftruncate(fd, size) < 0) {
+    perror("ftruncate");
+    close(fd);
+    return NULL;
+  }
+  *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (*data == MAP_FAILED) {
+    perror("mmap");
+    close(fd);
+    return NULL;
+  }
+
+  struct wl_shm_pool *pool = wl_shm_create_pool(state->shm, fd, size);
+  struct wl_buffer *buffer = wl_shm_pool_create_buffer(
+      pool, 0, width, height, stride, format);
+  wl_shm_pool_destroy(pool);
+  close(fd);
+  return buffer;
+}
+
+/* Creates a buffer holding a copy of `pixels` (BGRA, tightly packed).
+ * The mapping is dropped right away, the compositor keeps its own. */
+static struct wl_buffer *upload_shm_buffer(WaylandState *state,
+                                           const void *pixels, int width,
+                                           int height) {
+  void *data;
+  struct wl_buffer *buffer = create_shm_buffer(state, width, height,
+                                               WL_SHM_FORMAT_XRGB8888, &data);
+  if (!buffer)
+    return NULL;
+  memcpy(data, pixels, (size_t)width * height * 4);
+  munmap(data, (size_t)width * height * 4);
+  return buffer;
+}
+
+static void sw_buffer_release(void *data, struct wl_buffer *buffer) {
+  SwBuffer *sw_buffer = data;
+  sw_buffer->busy = 0;
+}
+static const struct wl_buffer_listener sw_buffer_listener = {
+    .release = sw_buffer_release,
+};
+
+static void sw_buffer_destroy(SwBuffer *sw_buffer) {
+  if (sw_buffer->buffer)
+    wl_buffer_destroy(sw_buffer->buffer);
+  if (sw_buffer->data)
+    munmap(sw_buffer->data, (size_t)sw_buffer->width * sw_buffer->height * 4);
+  memset(sw_buffer, 0, sizeof(*sw_buffer));
+}
+
+/* Waits at most `timeout` ms for compositor events and dispatches them */
+static void wait_events(WaylandState *state, int timeout) {
+  if (wl_display_flush(state->display) == -1)
+    return;
+  while (wl_display_prepare_read(state->display) != 0)
+    wl_display_dispatch_pending(state->display);
+  struct pollfd pfd = {.fd = wl_display_get_fd(state->display),
+                       .events = POLLIN};
+  if (poll(&pfd, 1, timeout) > 0) {
+    wl_display_read_events(state->display);
+  } else {
+    wl_display_cancel_read(state->display);
+  }
+  wl_display_dispatch_pending(state->display);
+}
+
+/* wl_display_sync during initialization */
+static void init_sync_done(void *data, struct wl_callback *callback,
+                           uint32_t serial) {
+  WaylandState *state = (WaylandState *)data;
+  wl_callback_destroy(callback);
+  state->init_phase++;
+}
+static const struct wl_callback_listener init_sync_listener = {
+    .done = init_sync_done,
+};
+
+/* Asks for the next init_sync_done and sends it along with everything
+ * queued before it, without waiting for the answer */
+static void init_sync(WaylandState *state) {
+  struct wl_callback *callback = wl_display_sync(state->display);
+  wl_callback_add_listener(callback, &init_sync_listener, state);
+  wl_display_flush(state->display);
+}
+
+static int dispatch_until(WaylandState *state, int phase) {
+  while (state->init_phase < phase) {
+    if (wl_display_dispatch(state->display) < 0)
+      return -1;
+  }
+  return 0;
+}
+
 /* xdg_wm_base */
 static void wm_base_ping(void *data, struct xdg_wm_base *wm_base,
                          uint32_t serial) {
@@ -109,9 +457,7 @@ static void toplevel_configure(void *data, struct xdg_toplevel *toplevel,
   if (width > 0 && height > 0) {
     state->width = width;
     state->height = height;
-    if (state->egl_window) {
-      wl_egl_window_resize(state->egl_window, width, height, 0, 0);
-    }
+    update_buffer_size(state);
   }
 }
 static void toplevel_close(void *data, struct xdg_toplevel *toplevel) {
@@ -138,16 +484,27 @@ static void pointer_enter(void *data, struct wl_pointer *p, uint32_t serial,
                           struct wl_surface *surface, wl_fixed_t sx,
                           wl_fixed_t sy) {
   WaylandState *state = (WaylandState *)data;
-  state->pointer_x = wl_fixed_to_double(sx);
-  state->pointer_y = wl_fixed_to_double(sy);
+  /* Everything handed to Nim is in buffer pixels */
+  state->pointer_x = wl_fixed_to_double(sx) * surface_scale(state);
+  state->pointer_y = wl_fixed_to_double(sy) * surface_scale(state);
 }
 static void pointer_leave(void *data, struct wl_pointer *p, uint32_t serial,
                           struct wl_surface *surface) {}
 static void pointer_motion(void *data, struct wl_pointer *p, uint32_t time,
                            wl_fixed_t sx, wl_fixed_t sy) {
   WaylandState *state = (WaylandState *)data;
-  state->pointer_x = wl_fixed_to_double(sx);
-  state->pointer_y = wl_fixed_to_double(sy);
+  state->pointer_x = wl_fixed_to_double(sx) * surface_scale(state);
+  state->pointer_y = wl_fixed_to_double(sy) * surface_scale(state);
+  if (state->motion_event_count == MAX_MOTION_EVENTS) {
+    /* Keep the newest samples, they matter most for the fit */
+    memmove(&state->motion_events[0], &state->motion_events[1],
+            sizeof(state->motion_events[0]) * (MAX_MOTION_EVENTS - 1));
+    state->motion_event_count--;
+  }
+  state->motion_events[state->motion_event_count].time = time;
+  state->motion_events[state->motion_event_count].x = state->pointer_x;
+  state->motion_events[state->motion_event_count].y = state->pointer_y;
+  state->motion_event_count++;
 }
 static void pointer_button(void *data, struct wl_pointer *p, uint32_t serial,
                            uint32_t time, uint32_t button, uint32_t btn_state) {
@@ -165,20 +522,56 @@ static void pointer_button(void *data, struct wl_pointer *p, uint32_t serial,
 static void pointer_axis(void *data, struct wl_pointer *p, uint32_t time,
                          uint32_t axis, wl_fixed_t value) {
   WaylandState *state = (WaylandState *)data;
-  if (axis == WL_POINTER_AXIS_VERTICAL_SCROLL) {
-    if (wl_fixed_to_double(value) < 0)
-      state->scroll_delta += 1; /* scroll up */
-    else
-      state->scroll_delta -= 1; /* scroll down */
+  if (axis != WL_POINTER_AXIS_VERTICAL_SCROLL)
+    return;
+  if (state->seat_version < WL_POINTER_FRAME_SINCE_VERSION) {
+    /* No frame event will follow, apply right away */
+    state->scroll_delta -= wl_fixed_to_double(value) / AXIS_UNITS_PER_NOTCH;
+    return;
+  }
+  state->axis_value += wl_fixed_to_double(value);
+}
+static void pointer_frame(void *data, struct wl_pointer *p) {
+  WaylandState *state = (WaylandState *)data;
+  /* Prefer the wheel's own resolution; fingers and continuous devices
+   * only carry axis values. */
+  if (state->axis_has_value120 &&
+      state->axis_source != WL_POINTER_AXIS_SOURCE_FINGER &&
+      state->axis_source != WL_POINTER_AXIS_SOURCE_CONTINUOUS) {
+    state->scroll_delta -= state->axis_value120 / 120.0;
+  } else {
+    state->scroll_delta -= state->axis_value / AXIS_UNITS_PER_NOTCH;
   }
+  state->axis_source = WL_POINTER_AXIS_SOURCE_WHEEL;
+  state->axis_value = 0.0;
+  state->axis_value120 = 0;
+  state->axis_has_value120 = 0;
 }
-static void pointer_frame(void *data, struct wl_pointer *p) {}
 static void pointer_axis_source(void *data, struct wl_pointer *p,
-                                uint32_t source) {}
+                                uint32_t source) {
+  WaylandState *state = (WaylandState *)data;
+  state->axis_source = source;
+}
 static void pointer_axis_stop(void *data, struct wl_pointer *p, uint32_t time,
                               uint32_t axis) {}
 static void pointer_axis_discrete(void *data, struct wl_pointer *p,
-                                  uint32_t axis, int32_t discrete) {}
+                                  uint32_t axis, int32_t discrete) {
+  /* Superseded by axis_value120 from v8 on */
+  WaylandState *state = (WaylandState *)data;
+  if (axis == WL_POINTER_AXIS_VERTICAL_SCROLL &&
+      state->seat_version < WL_POINTER_AXIS_VALUE120_SINCE_VERSION) {
+    state->axis_value120 += discrete * 120;
+    state->axis_has_value120 = 1;
+  }
+}
+static void pointer_axis_value120(void *data, struct wl_pointer *p,
+                                  uint32_t axis, int32_t value120) {
+  WaylandState *state = (WaylandState *)data;
+  if (axis == WL_POINTER_AXIS_VERTICAL_SCROLL) {
+    state->axis_value120 += value120;
+    state->axis_has_value120 = 1;
+  }
+}
 
 static const struct wl_pointer_listener pointer_listener = {
     .enter = pointer_enter,
@@ -190,6 +583,7 @@ static const struct wl_pointer_listener pointer_listener = {
     .axis_source = pointer_axis_source,
     .axis_stop = pointer_axis_stop,
     .axis_discrete = pointer_axis_discrete,
+    .axis_value120 = pointer_axis_value120,
 };
 
 /* keyboard */
@@ -251,12 +645,19 @@ static const struct wl_seat_listener seat_listener = {
 static void output_geometry(void *data, struct wl_output *output, int32_t x,
                             int32_t y, int32_t pw, int32_t ph, int32_t subpixel,
                             const char *make, const char *model,
-                            int32_t transform) {}
+                            int32_t transform) {
+  WaylandState *state = (WaylandState *)data;
+  state->output_x = x;
+  state->output_y = y;
+  state->output_transform = transform;
+}
 static void output_mode(void *data, struct wl_output *output, uint32_t flags,
                         int32_t width, int32_t height, int32_t refresh) {
   WaylandState *state = (WaylandState *)data;
   if (flags & WL_OUTPUT_MODE_CURRENT) {
     state->output_rate = refresh; /* in mHz */
+    state->output_width = width;
+    state->output_height = height;
     if (state->width == 0) {
       state->width = width;
       state->height = height;
@@ -265,6 +666,9 @@ static void output_mode(void *data, struct wl_output *output, uint32_t flags,
 }
 static void output_done(void *data, struct wl_output *output) {}
 static void output_scale(void *data, struct wl_output *output, int32_t factor) {
+  WaylandState *state = (WaylandState *)data;
+  state->output_scale = factor;
+  update_buffer_size(state);
 }
 static void output_name(void *data, struct wl_output *output,
                         const char *name) {}
@@ -279,7 +683,318 @@ static const struct wl_output_listener output_listener = {
     .description = output_description,
 };
 
+/* foreign toplevel list – the windows --window picks from */
+static int toplevel_index(WaylandState *state,
+                          struct ext_foreign_toplevel_handle_v1 *handle) {
+  for (int i = 0; i < state->toplevel_count; i++) {
+    if (state->toplevels[i].handle == handle)
+      return i;
+  }
+  return -1;
+}
+static void toplevel_handle_closed(void *data,
+                                   struct ext_foreign_toplevel_handle_v1 *h) {
+  WaylandState *state = (WaylandState *)data;
+  int i = toplevel_index(state, h);
+  if (i < 0)
+    return;
+  free(state->toplevels[i].title);
+  free(state->toplevels[i].app_id);
+  ext_foreign_toplevel_handle_v1_destroy(h);
+  state->toplevels[i] = state->toplevels[--state->toplevel_count];
+}
+static void toplevel_handle_done(void *data,
+                                 struct ext_foreign_toplevel_handle_v1 *h) {}
+static void toplevel_handle_title(void *data,
+                                  struct ext_foreign_toplevel_handle_v1 *h,
+                                  const char *title) {
+  WaylandState *state = (WaylandState *)data;
+  int i = toplevel_index(state, h);
+  if (i < 0)
+    return;
+  free(state->toplevels[i].title);
+  state->toplevels[i].title = strdup(title);
+}
+static void toplevel_handle_app_id(void *data,
+                                   struct ext_foreign_toplevel_handle_v1 *h,
+                                   const char *app_id) {
+  WaylandState *state = (WaylandState *)data;
+  int i = toplevel_index(state, h);
+  if (i < 0)
+    return;
+  free(state->toplevels[i].app_id);
+  state->toplevels[i].app_id = strdup(app_id);
+}
+static void toplevel_handle_identifier(void *data,
+                                       struct ext_foreign_toplevel_handle_v1 *h,
+                                       const char *identifier) {}
+static const struct ext_foreign_toplevel_handle_v1_listener
+    toplevel_handle_listener = {
+        .closed = toplevel_handle_closed,
+        .done = toplevel_handle_done,
+        .title = toplevel_handle_title,
+        .app_id = toplevel_handle_app_id,
+        .identifier = toplevel_handle_identifier,
+};
+
+static void toplevel_list_toplevel(void *data,
+                                   struct ext_foreign_toplevel_list_v1 *list,
+                                   struct ext_foreign_toplevel_handle_v1 *h) {
+  WaylandState *state = (WaylandState *)data;
+  if (state->toplevel_count == state->toplevel_capacity) {
+    int capacity = state->toplevel_capacity ? state->toplevel_capacity * 2 : 16;
+    Toplevel *grown =
+        realloc(state->toplevels, (size_t)capacity * sizeof(Toplevel));
+    if (!grown) {
+      ext_foreign_toplevel_handle_v1_destroy(h);
+      return;
+    }
+    state->toplevels = grown;
+    state->toplevel_capacity = capacity;
+  }
+  state->toplevels[state->toplevel_count++] = (Toplevel){h, NULL, NULL};
+  ext_foreign_toplevel_handle_v1_add_listener(h, &toplevel_handle_listener,
+                                              state);
+}
+static void toplevel_list_finished(void *data,
+                                   struct ext_foreign_toplevel_list_v1 *list) {
+}
+static const struct ext_foreign_toplevel_list_v1_listener
+    toplevel_list_listener = {
+        .toplevel = toplevel_list_toplevel,
+        .finished = toplevel_list_finished,
+};
+
+/* image copy capture – one session for the --window toplevel */
+static void capture_buffer_size(void *data,
+                                struct ext_image_copy_capture_session_v1 *s,
+                                uint32_t width, uint32_t height) {
+  WindowCapture *capture = data;
+  capture->width = width;
+  capture->height = height;
+}
+static void capture_shm_format(void *data,
+                               struct ext_image_copy_capture_session_v1 *s,
+                               uint32_t format) {
+  /* Both are BGRA in memory, what the renderers take */
+  WindowCapture *capture = data;
+  if (format == WL_SHM_FORMAT_ARGB8888 || format == WL_SHM_FORMAT_XRGB8888)
+    capture->next_format = format;
+}
+static void capture_dmabuf_device(void *data,
+                                  struct ext_image_copy_capture_session_v1 *s,
+                                  struct wl_array *device) {}
+static void capture_dmabuf_format(void *data,
+                                  struct ext_image_copy_capture_session_v1 *s,
+                                  uint32_t format, struct wl_array *modifiers) {
+}
+static void capture_done(void *data,
+                         struct ext_image_copy_capture_session_v1 *s) {
+  /* The constraints come again in full whenever they change */
+  WindowCapture *capture = data;
+  capture->format = capture->next_format;
+  capture->next_format = 0;
+  capture->constrained = 1;
+}
+static void capture_stopped(void *data,
+                            struct ext_image_copy_capture_session_v1 *s) {
+  WindowCapture *capture = data;
+  capture->stopped = 1;
+}
+static const struct ext_image_copy_capture_session_v1_listener
+    capture_session_listener = {
+        .buffer_size = capture_buffer_size,
+        .shm_format = capture_shm_format,
+        .dmabuf_device = capture_dmabuf_device,
+        .dmabuf_format = capture_dmabuf_format,
+        .done = capture_done,
+        .stopped = capture_stopped,
+};
+
+static void frame_transform(void *data,
+                            struct ext_image_copy_capture_frame_v1 *frame,
+                            uint32_t transform) {}
+static void frame_damage(void *data,
+                         struct ext_image_copy_capture_frame_v1 *frame,
+                         int32_t x, int32_t y, int32_t width, int32_t height) {
+}
+static void frame_presentation_time(
+    void *data, struct ext_image_copy_capture_frame_v1 *frame,
+    uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec) {}
+static void frame_ready(void *data,
+                        struct ext_image_copy_capture_frame_v1 *frame) {
+  WindowCapture *capture = data;
+  ext_image_copy_capture_frame_v1_destroy(frame);
+  capture->frame = NULL;
+  capture->ready = 1;
+}
+static void frame_failed(void *data,
+                         struct ext_image_copy_capture_frame_v1 *frame,
+                         uint32_t reason) {
+  /* Other reasons come with new constraints, the next request uses them */
+  WindowCapture *capture = data;
+  ext_image_copy_capture_frame_v1_destroy(frame);
+  capture->frame = NULL;
+  if (reason == EXT_IMAGE_COPY_CAPTURE_FRAME_V1_FAILURE_REASON_STOPPED)
+    capture->stopped = 1;
+}
+static const struct ext_image_copy_capture_frame_v1_listener
+    capture_frame_listener = {
+        .transform = frame_transform,
+        .damage = frame_damage,
+        .presentation_time = frame_presentation_time,
+        .ready = frame_ready,
+        .failed = frame_failed,
+};
+
+static void capture_destroy(WindowCapture *capture) {
+  if (capture->frame)
+    ext_image_copy_capture_frame_v1_destroy(capture->frame);
+  if (capture->session)
+    ext_image_copy_capture_session_v1_destroy(capture->session);
+  if (capture->source)
+    ext_image_capture_source_v1_destroy(capture->source);
+  if (capture->buffer)
+    wl_buffer_destroy(capture->buffer);
+  if (capture->data)
+    munmap(capture->data,
+           (size_t)capture->buffer_width * capture->buffer_height * 4);
+  memset(capture, 0, sizeof(*capture));
+}
+
+/* cursor session – where the pointer is on the output, for the lens */
+static void cursor_enter(void *data,
+                         struct ext_image_copy_capture_cursor_session_v1 *s) {
+  WaylandState *state = (WaylandState *)data;
+  state->cursor_inside = 1;
+}
+static void cursor_leave(void *data,
+                         struct ext_image_copy_capture_cursor_session_v1 *s) {
+  WaylandState *state = (WaylandState *)data;
+  state->cursor_inside = 0;
+}
+static void cursor_position(void *data,
+                            struct ext_image_copy_capture_cursor_session_v1 *s,
+                            int32_t x, int32_t y) {
+  WaylandState *state = (WaylandState *)data;
+  state->cursor_x = x;
+  state->cursor_y = y;
+}
+static void cursor_hotspot(void *data,
+                           struct ext_image_copy_capture_cursor_session_v1 *s,
+                           int32_t x, int32_t y) {}
+static const struct ext_image_copy_capture_cursor_session_v1_listener
+    cursor_session_listener = {
+        .enter = cursor_enter,
+        .leave = cursor_leave,
+        .position = cursor_position,
+        .hotspot = cursor_hotspot,
+};
+
+/* screencopy – the region under the lens */
+static void region_copy(WaylandState *state,
+                        struct zwlr_screencopy_frame_v1 *frame) {
+  RegionCapture *region = &state->region;
+  if (!region->format) {
+    fprintf(stderr, "Screencopy offers no ARGB8888 or XRGB8888 buffers\n");
+    zwlr_screencopy_frame_v1_destroy(frame);
+    region->frame = NULL;
+    return;
+  }
+  if (region->buffer_width != region->width ||
+      region->buffer_height != region->height) {
+    if (region->buffer)
+      wl_buffer_destroy(region->buffer);
+    if (region->data)
+      munmap(region->data,
+             (size_t)region->buffer_width * region->buffer_height * 4);
+    region->data = NULL;
+    region->buffer_width = 0;
+    region->buffer_height = 0;
+    region->buffer = create_shm_buffer(state, region->width, region->height,
+                                       region->format, &region->data);
+    if (!region->buffer) {
+      zwlr_screencopy_frame_v1_destroy(frame);
+      region->frame = NULL;
+      return;
+    }
+    region->buffer_width = region->width;
+    region->buffer_height = region->height;
+  }
+  zwlr_screencopy_frame_v1_copy(frame, region->buffer);
+}
+static void region_buffer(void *data, struct zwlr_screencopy_frame_v1 *frame,
+                          uint32_t format, uint32_t width, uint32_t height,
+                          uint32_t stride) {
+  /* Both are BGRA in memory; padded rows are not worth supporting */
+  WaylandState *state = (WaylandState *)data;
+  if ((format == WL_SHM_FORMAT_ARGB8888 ||
+       format == WL_SHM_FORMAT_XRGB8888) &&
+      stride == width * 4) {
+    state->region.format = format;
+    state->region.width = width;
+    state->region.height = height;
+  }
+  /* Before version 3 nothing else is offered */
+  if (state->screencopy_version < 3)
+    region_copy(state, frame);
+}
+static void region_flags(void *data, struct zwlr_screencopy_frame_v1 *frame,
+                         uint32_t flags) {
+  WaylandState *state = (WaylandState *)data;
+  state->region.y_invert = flags & ZWLR_SCREENCOPY_FRAME_V1_FLAGS_Y_INVERT;
+}
+static void region_ready(void *data, struct zwlr_screencopy_frame_v1 *frame,
+                         uint32_t tv_sec_hi, uint32_t tv_sec_lo,
+                         uint32_t tv_nsec) {
+  WaylandState *state = (WaylandState *)data;
+  RegionCapture *region = &state->region;
+  if (region->y_invert) {
+    /* Lens sized, flipping costs next to nothing */
+    size_t stride = (size_t)region->buffer_width * 4;
+    uint8_t row[stride];
+    uint8_t *top = region->data;
+    uint8_t *bottom = top + stride * (region->buffer_height - 1);
+    for (; top < bottom; top += stride, bottom -= stride) {
+      memcpy(row, top, stride);
+      memcpy(top, bottom, stride);
+      memcpy(bottom, row, stride);
+    }
+  }
+  zwlr_screencopy_frame_v1_destroy(frame);
+  region->frame = NULL;
+  region->ready = 1;
+}
+static void region_failed(void *data, struct zwlr_screencopy_frame_v1 *frame) {
+  WaylandState *state = (WaylandState *)data;
+  zwlr_screencopy_frame_v1_destroy(frame);
+  state->region.frame = NULL;
+}
+static void region_damage(void *data, struct zwlr_screencopy_frame_v1 *frame,
+                          uint32_t x, uint32_t y, uint32_t width,
+                          uint32_t height) {}
+static void region_linux_dmabuf(void *data,
+                                struct zwlr_screencopy_frame_v1 *frame,
+                                uint32_t format, uint32_t width,
+                                uint32_t height) {}
+static void region_buffer_done(void *data,
+                               struct zwlr_screencopy_frame_v1 *frame) {
+  region_copy((WaylandState *)data, frame);
+}
+static const struct zwlr_screencopy_frame_v1_listener region_frame_listener = {
+    .buffer = region_buffer,
+    .flags = region_flags,
+    .ready = region_ready,
+    .failed = region_failed,
+    .damage = region_damage,
+    .linux_dmabuf = region_linux_dmabuf,
+    .buffer_done = region_buffer_done,
+};
+
 /* registry */
+static const struct wl_interface *const toplevel_sources_interface =
+    &ext_foreign_toplevel_image_capture_source_manager_v1_interface;
+
 static void registry_global(void *data, struct wl_registry *reg, uint32_t name,
                             const char *interface, uint32_t version) {
   WaylandState *state = (WaylandState *)data;
@@ -292,8 +1007,51 @@ static void registry_global(void *data, struct wl_registry *reg, uint32_t name,
   } else if (strcmp(interface, zwlr_layer_shell_v1_interface.name) == 0) {
     state->layer_shell =
         wl_registry_bind(reg, name, &zwlr_layer_shell_v1_interface, 1);
+  } else if (strcmp(interface, wp_tearing_control_manager_v1_interface.name) ==
+             0) {
+    state->tearing_manager = wl_registry_bind(
+        reg, name, &wp_tearing_control_manager_v1_interface, 1);
+  } else if (strcmp(interface, wl_shm_interface.name) == 0) {
+    state->shm = wl_registry_bind(reg, name, &wl_shm_interface, 1);
+  } else if (strcmp(interface, wl_subcompositor_interface.name) == 0) {
+    state->subcompositor =
+        wl_registry_bind(reg, name, &wl_subcompositor_interface, 1);
+  } else if (strcmp(interface, wp_viewporter_interface.name) == 0) {
+    state->viewporter =
+        wl_registry_bind(reg, name, &wp_viewporter_interface, 1);
+  } else if (strcmp(interface,
+                    wp_fractional_scale_manager_v1_interface.name) == 0) {
+    state->fractional_scale_manager = wl_registry_bind(
+        reg, name, &wp_fractional_scale_manager_v1_interface, 1);
+  } else if (strcmp(interface, ext_foreign_toplevel_list_v1_interface.name) ==
+             0) {
+    state->toplevel_list =
+        wl_registry_bind(reg, name, &ext_foreign_toplevel_list_v1_interface, 1);
+    ext_foreign_toplevel_list_v1_add_listener(state->toplevel_list,
+                                              &toplevel_list_listener, state);
+  } else if (strcmp(interface, toplevel_sources_interface->name) == 0) {
+    state->toplevel_sources =
+        wl_registry_bind(reg, name, toplevel_sources_interface, 1);
+  } else if (strcmp(interface,
+                    ext_image_copy_capture_manager_v1_interface.name) == 0) {
+    state->copy_capture = wl_registry_bind(
+        reg, name, &ext_image_copy_capture_manager_v1_interface, 1);
+  } else if (strcmp(interface,
+                    ext_output_image_capture_source_manager_v1_interface
+                        .name) == 0) {
+    state->output_sources = wl_registry_bind(
+        reg, name, &ext_output_image_capture_source_manager_v1_interface, 1);
+  } else if (strcmp(interface, zwlr_screencopy_manager_v1_interface.name) ==
+             0) {
+    state->screencopy_version = version < 3 ? version : 3;
+    state->screencopy =
+        wl_registry_bind(reg, name, &zwlr_screencopy_manager_v1_interface,
+                         state->screencopy_version);
   } else if (strcmp(interface, wl_seat_interface.name) == 0) {
-    state->seat = wl_registry_bind(reg, name, &wl_seat_interface, 5);
+    /* v8 for axis_value120; v9 would add axis_relative_direction */
+    state->seat_version = version < 8 ? version : 8;
+    state->seat =
+        wl_registry_bind(reg, name, &wl_seat_interface, state->seat_version);
     wl_seat_add_listener(state->seat, &seat_listener, state);
   } else if (strcmp(interface, wl_output_interface.name) == 0) {
     if (!state->output) {
@@ -315,9 +1073,7 @@ static void layer_surface_configure(void *data,
   state->height = height;
   state->configured = 1;
   zwlr_layer_surface_v1_ack_configure(surface, serial);
-  if (state->egl_window) {
-    wl_egl_window_resize(state->egl_window, width, height, 0, 0);
-  }
+  update_buffer_size(state);
 }
 static void layer_surface_closed(void *data,
                                  struct zwlr_layer_surface_v1 *surface) {
@@ -329,9 +1085,142 @@ static const struct zwlr_layer_surface_v1_listener layer_surface_listener = {
     .closed = layer_surface_closed,
 };
 
+/* Picks a config and creates a context for `api`. Desktop GL asks for a
+ * 3.3 core context and falls back to compat; GLES asks for `version`. */
+static int create_context(WaylandState *state, EGLenum api,
+                          EGLint renderable, int version) {
+  if (!eglBindAPI(api))
+    return -1;
+
+  EGLint config_attribs[] = {EGL_SURFACE_TYPE,
+                             EGL_WINDOW_BIT,
+                             EGL_RENDERABLE_TYPE,
+                             renderable,
+                             EGL_RED_SIZE,
+                             8,
+                             EGL_GREEN_SIZE,
+                             8,
+                             EGL_BLUE_SIZE,
+                             8,
+                             EGL_ALPHA_SIZE,
+                             8,
+                             EGL_NONE};
+
+  EGLint num_configs = 0;
+  if (!eglChooseConfig(state->egl_display, config_attribs, &state->egl_config,
+                       1, &num_configs) ||
+      num_configs == 0)
+    return -1;
+
+  if (api == EGL_OPENGL_API) {
+    EGLint context_attribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                3,
+                                EGL_CONTEXT_MINOR_VERSION,
+                                3,
+                                EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                EGL_NONE};
+    state->egl_context = eglCreateContext(
+        state->egl_display, state->egl_config, EGL_NO_CONTEXT, context_attribs);
+    if (state->egl_context == EGL_NO_CONTEXT) {
+      /* Fall back to compat profile */
+      EGLint fallback_attribs[] = {EGL_NONE};
+      state->egl_context =
+          eglCreateContext(state->egl_display, state->egl_config,
+                           EGL_NO_CONTEXT, fallback_attribs);
+    }
+  } else {
+    EGLint context_attribs[] = {EGL_CONTEXT_MAJOR_VERSION, version, EGL_NONE};
+    state->egl_context = eglCreateContext(
+        state->egl_display, state->egl_config, EGL_NO_CONTEXT, context_attribs);
+  }
+  return state->egl_context == EGL_NO_CONTEXT ? -1 : 0;
+}
+
+static int create_egl_surface(WaylandState *state);
+
+static int init_egl(WaylandState *state) {
+  state->egl_display = eglGetDisplay((EGLNativeDisplayType)state->display);
+  if (state->egl_display == EGL_NO_DISPLAY) {
+    fprintf(stderr, "Failed to get EGL display\n");
+    return -1;
+  }
+
+  EGLint major, minor;
+  if (!eglInitialize(state->egl_display, &major, &minor)) {
+    fprintf(stderr, "Failed to initialize EGL\n");
+    return -1;
+  }
+  const char *extensions = eglQueryString(state->egl_display, EGL_EXTENSIONS);
+  state->egl_all_procs =
+      major > 1 || minor >= 5 ||
+      (extensions && strstr(extensions, "EGL_KHR_get_all_proc_addresses"));
+
+  /* Desktop GL first unless GLES was asked for, it is what most drivers
+   * optimise; then GLES 3 and GLES 2 for devices where desktop GL is
+   * emulated or missing */
+  int created = -1;
+  if (state->renderer != WL_RENDERER_GLES) {
+    created = create_context(state, EGL_OPENGL_API, EGL_OPENGL_BIT, 3);
+    if (created == 0)
+      state->gl_api = 0;
+  }
+  if (created < 0) {
+    created = create_context(state, EGL_OPENGL_ES_API, EGL_OPENGL_ES3_BIT, 3);
+    if (created == 0)
+      state->gl_api = 3;
+  }
+  if (created < 0) {
+    created = create_context(state, EGL_OPENGL_ES_API, EGL_OPENGL_ES2_BIT, 2);
+    if (created == 0)
+      state->gl_api = 2;
+  }
+  if (created < 0) {
+    fprintf(stderr, "Failed to create EGL context\n");
+    return -1;
+  }
+
+  return create_egl_surface(state);
+}
+
+/* Window surface for the current context, also recreated when a hidden
+ * daemon surface is shown again. During initialization the size may not
+ * be known yet; the configure that brings it resizes the window. */
+static int create_egl_surface(WaylandState *state) {
+  state->egl_window = wl_egl_window_create(
+      state->surface, state->buffer_width > 0 ? state->buffer_width : 1,
+      state->buffer_height > 0 ? state->buffer_height : 1);
+  if (!state->egl_window) {
+    fprintf(stderr, "Failed to create EGL window\n");
+    return -1;
+  }
+
+  state->egl_surface =
+      eglCreateWindowSurface(state->egl_display, state->egl_config,
+                             (EGLNativeWindowType)state->egl_window, NULL);
+  if (state->egl_surface == EGL_NO_SURFACE) {
+    fprintf(stderr, "Failed to create EGL surface\n");
+    return -1;
+  }
+
+  eglMakeCurrent(state->egl_display, state->egl_surface, state->egl_surface,
+                 state->egl_context);
+
+  /* Enable vsync – frame pacing via compositor. In low-latency mode
+   * eglSwapBuffers must not block on the frame callback; the caller
+   * paces itself instead. */
+  eglSwapInterval(state->egl_display, state->low_latency ? 0 : 1);
+
+  return 0;
+}
+
 /* ── Public API for Nim ── */
 
-WaylandState *wl_backend_init(int windowed) {
+/* A `lens_size` above 0 makes the overlay a click-through square of that
+ * many logical pixels, placed with wl_backend_lens_move, instead of a
+ * fullscreen surface. It needs layer-shell. */
+WaylandState *wl_backend_init(int windowed, int low_latency, int renderer,
+                              int lens_size) {
   WaylandState *state = calloc(1, sizeof(WaylandState));
   if (!state)
     return NULL;
@@ -343,10 +1232,17 @@ WaylandState *wl_backend_init(int windowed) {
     return NULL;
   }
 
+  /* The one wait that can't be avoided: nothing can be created before
+   * the globals are bound */
   state->registry = wl_display_get_registry(state->display);
   wl_registry_add_listener(state->registry, &registry_listener, state);
-  wl_display_roundtrip(state->display); /* get globals */
-  wl_display_roundtrip(state->display); /* get seat capabilities, output info */
+  init_sync(state);
+  if (dispatch_until(state, INIT_EVENTS) < 0) {
+    fprintf(stderr, "Lost the Wayland connection during setup\n");
+    wl_display_disconnect(state->display);
+    free(state);
+    return NULL;
+  }
 
   if (!state->compositor || !state->wm_base) {
     fprintf(
@@ -357,12 +1253,79 @@ WaylandState *wl_backend_init(int windowed) {
     return NULL;
   }
 
+  if (lens_size > 0 && !state->layer_shell) {
+    fprintf(stderr, "The lens needs zwlr_layer_shell_v1\n");
+    wl_display_disconnect(state->display);
+    free(state);
+    return NULL;
+  }
+
   state->windowed = windowed;
+  state->low_latency = low_latency;
+  state->renderer = renderer;
+  if (renderer == WL_RENDERER_VIEWPORT &&
+      (!state->shm || !state->subcompositor || !state->viewporter)) {
+    fprintf(stderr, "Compositor zoom needs wl_shm, wl_subcompositor and "
+                    "wp_viewporter, falling back to OpenGL\n");
+    state->renderer = WL_RENDERER_GL;
+  }
+  if (renderer == WL_RENDERER_SOFTWARE && !state->shm) {
+    fprintf(stderr, "Software rendering needs wl_shm, falling back to "
+                    "OpenGL\n");
+    state->renderer = WL_RENDERER_GL;
+  }
 
   /* Create surface */
   state->surface = wl_compositor_create_surface(state->compositor);
 
-  if (!windowed && state->layer_shell) {
+  /* Fractional scales need the viewport to map the larger buffer back
+   * onto the logical size; without either we use integer buffer scale */
+  if (state->viewporter && (state->fractional_scale_manager ||
+                            state->renderer == WL_RENDERER_VIEWPORT)) {
+    state->viewport =
+        wp_viewporter_get_viewport(state->viewporter, state->surface);
+  }
+  if (state->viewport && state->fractional_scale_manager) {
+    state->fractional_scale =
+        wp_fractional_scale_manager_v1_get_fractional_scale(
+            state->fractional_scale_manager, state->surface);
+    wp_fractional_scale_v1_add_listener(state->fractional_scale,
+                                        &fractional_scale_listener, state);
+  }
+
+  if (low_latency) {
+    /* The hint is double-buffered and lands with the initial commit below */
+    if (state->tearing_manager) {
+      state->tearing_control =
+          wp_tearing_control_manager_v1_get_tearing_control(
+              state->tearing_manager, state->surface);
+      wp_tearing_control_v1_set_presentation_hint(
+          state->tearing_control,
+          WP_TEARING_CONTROL_V1_PRESENTATION_HINT_ASYNC);
+    } else {
+      fprintf(stderr, "Compositor has no wp_tearing_control_v1, frames will "
+                      "still be presented with vsync\n");
+    }
+  }
+
+  if (lens_size > 0) {
+    /* Margins from the top left corner place it, input goes through to
+     * whatever is below and the keyboard stays where it was */
+    state->layer_surface = zwlr_layer_shell_v1_get_layer_surface(
+        state->layer_shell, state->surface, state->output,
+        ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY, "boomer");
+    zwlr_layer_surface_v1_set_anchor(state->layer_surface,
+                                     ZWLR_LAYER_SURFACE_V1_ANCHOR_TOP |
+                                         ZWLR_LAYER_SURFACE_V1_ANCHOR_LEFT);
+    zwlr_layer_surface_v1_set_size(state->layer_surface, lens_size,
+                                   lens_size);
+    zwlr_layer_surface_v1_set_exclusive_zone(state->layer_surface, -1);
+    zwlr_layer_surface_v1_add_listener(state->layer_surface,
+                                       &layer_surface_listener, state);
+    struct wl_region *empty = wl_compositor_create_region(state->compositor);
+    wl_surface_set_input_region(state->surface, empty);
+    wl_region_destroy(empty);
+  } else if (!windowed && state->layer_shell) {
     /* Layer-shell overlay: no window management, instant fullscreen */
     state->layer_surface = zwlr_layer_shell_v1_get_layer_surface(
         state->layer_shell, state->surface, state->output,
@@ -394,112 +1357,347 @@ WaylandState *wl_backend_init(int windowed) {
   }
 
   /* Commit with no buffer attached — triggers configure event.
-   * The surface only becomes visible on the first eglSwapBuffers. */
+   * The surface only becomes visible on the first eglSwapBuffers. The
+   * seat and output events for the binds above come back in the same
+   * batch; wl_backend_finish_init collects them while EGL, and the
+   * shaders on the Nim side, are set up in the meantime. */
   wl_surface_commit(state->surface);
-  wl_display_roundtrip(state->display); /* get configure */
+  init_sync(state);
+
+  if (state->renderer == WL_RENDERER_GL ||
+      state->renderer == WL_RENDERER_GLES) {
+    if (init_egl(state) < 0)
+      return NULL;
+  } else if (state->renderer == WL_RENDERER_VIEWPORT) {
+    state->image_surface = wl_compositor_create_surface(state->compositor);
+    state->image_subsurface = wl_subcompositor_get_subsurface(
+        state->subcompositor, state->image_surface, state->surface);
+    state->image_viewport =
+        wp_viewporter_get_viewport(state->viewporter, state->image_surface);
+
+    /* Pointer events go to the parent so coordinates stay relative to
+     * the whole window */
+    struct wl_region *empty = wl_compositor_create_region(state->compositor);
+    wl_surface_set_input_region(state->image_surface, empty);
+    wl_region_destroy(empty);
+
+    uint32_t background = 0xff1a1a1a; /* glClearColor(0.1, 0.1, 0.1) */
+    state->background_buffer = upload_shm_buffer(state, &background, 1, 1);
+  } else if (state->renderer == WL_RENDERER_SOFTWARE) {
+    state->sw_renderer = sw_renderer_create(0);
+    if (!state->sw_renderer) {
+      fprintf(stderr, "Failed to create software renderer\n");
+      return NULL;
+    }
+  }
+
+  /* Init key event queue */
+  state->key_event_count = 0;
+  state->key_read_index = 0;
+
+  return state;
+}
+
+/* Waits for the answers to what wl_backend_init sent. Output rate and
+ * buffer size are only valid after this; the first configure may still
+ * be on its way, see wl_backend_wait_configured. */
+int wl_backend_finish_init(WaylandState *state) {
+  if (state->init_phase == INIT_DONE)
+    return 0;
+  if (dispatch_until(state, INIT_DONE) < 0)
+    return -1;
 
   /* Use screen size as default if configure didn't provide dimensions */
   if (state->width == 0)
     state->width = 1920;
   if (state->height == 0)
     state->height = 1080;
+  update_buffer_size(state);
 
-  /* EGL setup */
-  state->egl_display = eglGetDisplay((EGLNativeDisplayType)state->display);
-  if (state->egl_display == EGL_NO_DISPLAY) {
-    fprintf(stderr, "Failed to get EGL display\n");
-    return NULL;
+  printf("Screen rate: %d\n",
+         state->output_rate > 0 ? state->output_rate / 1000 : 60);
+  return 0;
+}
+
+/* Blocks until the surface has been configured, dispatching whatever
+ * else arrives meanwhile */
+int wl_backend_wait_configured(WaylandState *state) {
+  while (!state->configured && !state->closed) {
+    if (wl_display_dispatch(state->display) < 0)
+      return -1;
   }
+  return 0;
+}
 
-  EGLint major, minor;
-  if (!eglInitialize(state->egl_display, &major, &minor)) {
-    fprintf(stderr, "Failed to initialize EGL\n");
-    return NULL;
+/* Used when the Vulkan renderer can't start. Nothing may be presenting
+ * to the surface at this point. */
+int wl_backend_fallback_gl(WaylandState *state) {
+  state->renderer = WL_RENDERER_GL;
+  return init_egl(state);
+}
+
+void wl_state_reset_frame(WaylandState *state);
+
+/* Unmaps the surface for --daemon. The connection, the GL context and
+ * everything in it stay alive for the next wl_backend_show. */
+void wl_backend_hide(WaylandState *state) {
+  if (state->hidden)
+    return;
+
+  /* The EGL surface goes, so a swap can't block on a frame callback the
+   * compositor won't send for an unmapped surface */
+  if (state->egl_surface != EGL_NO_SURFACE) {
+    eglMakeCurrent(state->egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                   state->egl_context);
+    eglDestroySurface(state->egl_display, state->egl_surface);
+    state->egl_surface = EGL_NO_SURFACE;
   }
+  if (state->egl_window) {
+    wl_egl_window_destroy(state->egl_window);
+    state->egl_window = NULL;
+  }
+  if (state->frame_callback) {
+    wl_callback_destroy(state->frame_callback);
+    state->frame_callback = NULL;
+  }
+  state->background_attached = 0;
+  state->sw_width = 0; /* the first software frame is damaged in full */
 
-  if (!eglBindAPI(EGL_OPENGL_API)) {
-    fprintf(stderr, "Failed to bind OpenGL API\n");
-    return NULL;
+  wl_surface_attach(state->surface, NULL, 0, 0);
+  wl_surface_commit(state->surface);
+  wl_display_flush(state->display);
+  state->configured = 0;
+  state->hidden = 1;
+}
+
+/* Asks for the surface to be mapped again. Presenting has to wait for
+ * wl_backend_wait_configured, like after wl_backend_init. */
+int wl_backend_show(WaylandState *state) {
+  if (!state->hidden)
+    return 0;
+  state->hidden = 0;
+  wl_state_reset_frame(state);
+
+  /* A commit without a buffer gets a fresh configure. Not waited for
+   * here, the EGL surface doesn't need it and a resize follows it. */
+  wl_surface_commit(state->surface);
+  wl_display_flush(state->display);
+
+  if (state->renderer == WL_RENDERER_GL ||
+      state->renderer == WL_RENDERER_GLES)
+    return create_egl_surface(state);
+  return 0;
+}
+
+/* Waits for compositor events or for one of `fds` to become readable.
+ * Compositor events are dispatched; returns a mask of the ready fds. */
+int wl_backend_wait_fds(WaylandState *state, const int *fds, int count) {
+  struct pollfd pfds[32];
+  if (count > 31)
+    count = 31;
+
+  if (wl_display_flush(state->display) == -1)
+    return -1;
+  while (wl_display_prepare_read(state->display) != 0)
+    wl_display_dispatch_pending(state->display);
+
+  pfds[0] = (struct pollfd){.fd = wl_display_get_fd(state->display),
+                            .events = POLLIN};
+  for (int i = 0; i < count; i++)
+    pfds[i + 1] = (struct pollfd){.fd = fds[i], .events = POLLIN};
+
+  if (poll(pfds, count + 1, -1) > 0 && (pfds[0].revents & POLLIN)) {
+    wl_display_read_events(state->display);
+  } else {
+    wl_display_cancel_read(state->display);
   }
+  wl_display_dispatch_pending(state->display);
 
-  EGLint config_attribs[] = {EGL_SURFACE_TYPE,
-                             EGL_WINDOW_BIT,
-                             EGL_RENDERABLE_TYPE,
-                             EGL_OPENGL_BIT,
-                             EGL_RED_SIZE,
-                             8,
-                             EGL_GREEN_SIZE,
-                             8,
-                             EGL_BLUE_SIZE,
-                             8,
-                             EGL_ALPHA_SIZE,
-                             8,
-                             EGL_DEPTH_SIZE,
-                             24,
-                             EGL_NONE};
+  int ready = 0;
+  for (int i = 0; i < count; i++) {
+    if (pfds[i + 1].revents & (POLLIN | POLLHUP))
+      ready |= 1 << i;
+  }
+  return ready;
+}
 
-  EGLint num_configs;
-  eglChooseConfig(state->egl_display, config_attribs, &state->egl_config, 1,
-                  &num_configs);
-  if (num_configs == 0) {
-    fprintf(stderr, "Failed to choose EGL config\n");
-    return NULL;
+void wl_backend_swap_buffers(WaylandState *state) {
+  eglSwapBuffers(state->egl_display, state->egl_surface);
+}
+
+/* Hands the screenshot to the compositor once; after this only the
+ * viewport changes from frame to frame. */
+int wl_backend_set_image(WaylandState *state, const void *pixels, int width,
+                         int height) {
+  if (state->renderer == WL_RENDERER_SOFTWARE) {
+    /* Not copied, the caller keeps the pixels alive */
+    state->sw_image = (SwImage){pixels, width, height};
+    state->sw_width = 0; /* forces a full redraw */
+    for (int i = 0; i < SW_BUFFER_COUNT; i++)
+      state->sw_buffers[i].valid = 0;
+    return 0;
   }
+  if (state->renderer != WL_RENDERER_VIEWPORT)
+    return -1;
+  if (state->image_buffer)
+    wl_buffer_destroy(state->image_buffer);
+  state->image_buffer = upload_shm_buffer(state, pixels, width, height);
+  if (!state->image_buffer)
+    return -1;
+  state->image_width = width;
+  state->image_height = height;
+  state->image_mapped = 0;
+  return 0;
+}
 
-  EGLint context_attribs[] = {EGL_CONTEXT_MAJOR_VERSION,
-                              3,
-                              EGL_CONTEXT_MINOR_VERSION,
-                              3,
-                              EGL_CONTEXT_OPENGL_PROFILE_MASK,
-                              EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
-                              EGL_NONE};
-
-  state->egl_context = eglCreateContext(state->egl_display, state->egl_config,
-                                        EGL_NO_CONTEXT, context_attribs);
-  if (state->egl_context == EGL_NO_CONTEXT) {
-    /* Fall back to compat profile */
-    EGLint fallback_attribs[] = {EGL_NONE};
-    state->egl_context = eglCreateContext(state->egl_display, state->egl_config,
-                                          EGL_NO_CONTEXT, fallback_attribs);
-    if (state->egl_context == EGL_NO_CONTEXT) {
-      fprintf(stderr, "Failed to create EGL context\n");
-      return NULL;
-    }
+/* Presents the image with its pixel (x, y) at the top-left corner of the
+ * window, magnified by `scale` buffer pixels per image pixel. */
+void wl_backend_present_view(WaylandState *state, double x, double y,
+                             double scale) {
+  /* Same pacing as eglSwapBuffers with swap interval 1 */
+  while (state->frame_callback && !state->closed) {
+    if (wl_display_dispatch(state->display) == -1)
+      break;
   }
 
-  state->egl_window =
-      wl_egl_window_create(state->surface, state->width, state->height);
-  if (!state->egl_window) {
-    fprintf(stderr, "Failed to create EGL window\n");
-    return NULL;
+  if (!state->background_attached && state->background_buffer) {
+    wl_surface_attach(state->surface, state->background_buffer, 0, 0);
+    wl_surface_damage_buffer(state->surface, 0, 0, 1, 1);
+    state->background_attached = 1;
   }
 
-  state->egl_surface =
-      eglCreateWindowSurface(state->egl_display, state->egl_config,
-                             (EGLNativeWindowType)state->egl_window, NULL);
-  if (state->egl_surface == EGL_NO_SURFACE) {
-    fprintf(stderr, "Failed to create EGL surface\n");
-    return NULL;
+  /* Part of the image that is on screen, snapped to whole logical pixels
+   * since that is all set_destination and set_position take */
+  double ss = surface_scale(state);
+  double to_logical = scale / ss;
+  int lx0 = lround((fmax(x, 0.0) - x) * to_logical);
+  int ly0 = lround((fmax(y, 0.0) - y) * to_logical);
+  int lx1 = lround(
+      (fmin(x + state->buffer_width / scale, state->image_width) - x) *
+      to_logical);
+  int ly1 = lround(
+      (fmin(y + state->buffer_height / scale, state->image_height) - y) *
+      to_logical);
+
+  /* Source follows the snapped edges so the image is not stretched, and
+   * must stay inside the buffer */
+  wl_fixed_t sx0 = wl_fixed_from_double(fmax(x + lx0 / to_logical, 0.0));
+  wl_fixed_t sy0 = wl_fixed_from_double(fmax(y + ly0 / to_logical, 0.0));
+  wl_fixed_t sx1 = wl_fixed_from_double(x + lx1 / to_logical);
+  wl_fixed_t sy1 = wl_fixed_from_double(y + ly1 / to_logical);
+  if (sx1 > wl_fixed_from_int(state->image_width))
+    sx1 = wl_fixed_from_int(state->image_width);
+  if (sy1 > wl_fixed_from_int(state->image_height))
+    sy1 = wl_fixed_from_int(state->image_height);
+
+  if (lx1 <= lx0 || ly1 <= ly0 || sx1 <= sx0 || sy1 <= sy0) {
+    /* Panned completely off the image */
+    if (state->image_mapped) {
+      wl_surface_attach(state->image_surface, NULL, 0, 0);
+      wl_surface_commit(state->image_surface);
+      state->image_mapped = 0;
+    }
+  } else if (state->image_buffer) {
+    if (!state->image_mapped) {
+      wl_surface_attach(state->image_surface, state->image_buffer, 0, 0);
+      wl_surface_damage_buffer(state->image_surface, 0, 0, state->image_width,
+                               state->image_height);
+      state->image_mapped = 1;
+    }
+    wp_viewport_set_source(state->image_viewport, sx0, sy0, sx1 - sx0,
+                           sy1 - sy0);
+    wp_viewport_set_destination(state->image_viewport, lx1 - lx0, ly1 - ly0);
+    wl_subsurface_set_position(state->image_subsurface, lx0, ly0);
+    wl_surface_commit(state->image_surface);
   }
 
-  eglMakeCurrent(state->egl_display, state->egl_surface, state->egl_surface,
-                 state->egl_context);
+  /* The subsurface is synchronized, all of the above lands atomically
+   * with the parent commit */
+  if (!state->low_latency) {
+    state->frame_callback = wl_surface_frame(state->surface);
+    wl_callback_add_listener(state->frame_callback, &frame_listener, state);
+  }
+  wl_surface_commit(state->surface);
+  wl_display_flush(state->display);
+}
 
-  /* Enable vsync – frame pacing via compositor */
-  eglSwapInterval(state->egl_display, 1);
+/* Renders the view on the CPU. Parameters are the uniforms of
+ * vert.glsl/frag.glsl, with the camera already turned into the image
+ * pixel at the window's top-left corner like wl_backend_present_view. */
+void wl_backend_present_software(WaylandState *state, double x, double y,
+                                 double scale, double cursor_x,
+                                 double cursor_y, double fl_shadow,
+                                 double fl_radius) {
+  SwView view = {x, y, scale, cursor_x, cursor_y, fl_shadow, fl_radius};
+  int width = state->buffer_width;
+  int height = state->buffer_height;
+  SwRect full = {0, 0, width, height};
+
+  while (state->frame_callback && !state->closed) {
+    if (wl_display_dispatch(state->display) == -1)
+      return;
+  }
 
-  /* Init key event queue */
-  state->key_event_count = 0;
-  state->key_read_index = 0;
+  /* Surface damage is relative to the last commit */
+  SwRect damage = full;
+  if (state->sw_width == width && state->sw_height == height &&
+      !sw_view_damage(&state->sw_view, &view, width, height, &damage)) {
+    /* Nothing to show; sleep on the socket for a refresh instead of
+     * spinning the main loop */
+    if (!state->low_latency)
+      wait_events(state, state->output_rate > 0
+                             ? 1000000 / state->output_rate
+                             : 1000 / 60);
+    return;
+  }
 
-  printf("Screen rate: %d\n",
-         state->output_rate > 0 ? state->output_rate / 1000 : 60);
+  SwBuffer *target = NULL;
+  while (!target) {
+    for (int i = 0; i < SW_BUFFER_COUNT && !target; i++) {
+      if (!state->sw_buffers[i].busy)
+        target = &state->sw_buffers[i];
+    }
+    if (!target && wl_display_dispatch(state->display) == -1)
+      return;
+  }
 
-  return state;
-}
+  if (target->width != width || target->height != height) {
+    sw_buffer_destroy(target);
+    void *data;
+    target->buffer = create_shm_buffer(state, width, height,
+                                       WL_SHM_FORMAT_XRGB8888, &data);
+    if (!target->buffer)
+      return;
+    target->data = data;
+    target->width = width;
+    target->height = height;
+    wl_buffer_add_listener(target->buffer, &sw_buffer_listener, target);
+  }
 
-void wl_backend_swap_buffers(WaylandState *state) {
-  eglSwapBuffers(state->egl_display, state->egl_surface);
+  /* The buffer is a frame or two behind, redraw what changed since */
+  SwRect redraw = full;
+  if (!target->valid ||
+      sw_view_damage(&target->view, &view, width, height, &redraw)) {
+    sw_render(state->sw_renderer, &state->sw_image, &view, target->data,
+              width, width, height, redraw);
+  }
+  target->view = view;
+  target->valid = 1;
+  target->busy = 1;
+
+  wl_surface_attach(state->surface, target->buffer, 0, 0);
+  wl_surface_damage_buffer(state->surface, damage.x, damage.y, damage.width,
+                           damage.height);
+  if (!state->low_latency) {
+    state->frame_callback = wl_surface_frame(state->surface);
+    wl_callback_add_listener(state->frame_callback, &frame_listener, state);
+  }
+  wl_surface_commit(state->surface);
+  wl_display_flush(state->display);
+
+  state->sw_view = view;
+  state->sw_width = width;
+  state->sw_height = height;
 }
 
 int wl_backend_poll_events(WaylandState *state) {
@@ -526,9 +1724,10 @@ int wl_backend_poll_events(WaylandState *state) {
 void wl_state_reset_frame(WaylandState *state) {
   state->button_just_pressed = 0;
   state->button_just_released = 0;
-  state->scroll_delta = 0;
+  state->scroll_delta = 0.0;
   state->key_event_count = 0;
   state->key_read_index = 0;
+  state->motion_event_count = 0;
 }
 
 /* Legacy compat – keep for any code that still calls these */
@@ -568,7 +1767,71 @@ void wl_backend_destroy(WaylandState *state) {
     eglDestroyContext(state->egl_display, state->egl_context);
   if (state->egl_display != EGL_NO_DISPLAY)
     eglTerminate(state->egl_display);
-
+  if (state->gl_library)
+    dlclose(state->gl_library);
+
+  capture_destroy(&state->capture);
+  if (state->region.frame)
+    zwlr_screencopy_frame_v1_destroy(state->region.frame);
+  if (state->region.buffer)
+    wl_buffer_destroy(state->region.buffer);
+  if (state->region.data)
+    munmap(state->region.data,
+           (size_t)state->region.buffer_width * state->region.buffer_height *
+               4);
+  if (state->screencopy)
+    zwlr_screencopy_manager_v1_destroy(state->screencopy);
+  if (state->cursor_session)
+    ext_image_copy_capture_cursor_session_v1_destroy(state->cursor_session);
+  if (state->cursor_source)
+    ext_image_capture_source_v1_destroy(state->cursor_source);
+  if (state->output_sources)
+    ext_output_image_capture_source_manager_v1_destroy(state->output_sources);
+  if (state->copy_capture)
+    ext_image_copy_capture_manager_v1_destroy(state->copy_capture);
+  if (state->toplevel_sources)
+    ext_foreign_toplevel_image_capture_source_manager_v1_destroy(
+        state->toplevel_sources);
+  for (int i = 0; i < state->toplevel_count; i++) {
+    ext_foreign_toplevel_handle_v1_destroy(state->toplevels[i].handle);
+    free(state->toplevels[i].title);
+    free(state->toplevels[i].app_id);
+  }
+  free(state->toplevels);
+  if (state->toplevel_list)
+    ext_foreign_toplevel_list_v1_destroy(state->toplevel_list);
+
+  for (int i = 0; i < SW_BUFFER_COUNT; i++)
+    sw_buffer_destroy(&state->sw_buffers[i]);
+  sw_renderer_destroy(state->sw_renderer);
+  if (state->frame_callback)
+    wl_callback_destroy(state->frame_callback);
+  if (state->image_viewport)
+    wp_viewport_destroy(state->image_viewport);
+  if (state->image_subsurface)
+    wl_subsurface_destroy(state->image_subsurface);
+  if (state->image_surface)
+    wl_surface_destroy(state->image_surface);
+  if (state->image_buffer)
+    wl_buffer_destroy(state->image_buffer);
+  if (state->background_buffer)
+    wl_buffer_destroy(state->background_buffer);
+  if (state->subcompositor)
+    wl_subcompositor_destroy(state->subcompositor);
+  if (state->shm)
+    wl_shm_destroy(state->shm);
+  if (state->fractional_scale)
+    wp_fractional_scale_v1_destroy(state->fractional_scale);
+  if (state->fractional_scale_manager)
+    wp_fractional_scale_manager_v1_destroy(state->fractional_scale_manager);
+  if (state->viewport)
+    wp_viewport_destroy(state->viewport);
+  if (state->viewporter)
+    wp_viewporter_destroy(state->viewporter);
+  if (state->tearing_control)
+    wp_tearing_control_v1_destroy(state->tearing_control);
+  if (state->tearing_manager)
+    wp_tearing_control_manager_v1_destroy(state->tearing_manager);
   if (state->layer_surface)
     zwlr_layer_surface_v1_destroy(state->layer_surface);
   if (state->layer_shell)
@@ -599,9 +1862,211 @@ void wl_backend_destroy(WaylandState *state) {
   free(state);
 }
 
+/* Windows listed by ext_foreign_toplevel_list_v1, complete once
+ * wl_backend_finish_init returned. Indices change as windows close. */
+int wl_backend_toplevel_count(WaylandState *state) {
+  return state->toplevel_count;
+}
+const char *wl_backend_toplevel_title(WaylandState *state, int index) {
+  const char *title = state->toplevels[index].title;
+  return title ? title : "";
+}
+const char *wl_backend_toplevel_app_id(WaylandState *state, int index) {
+  const char *app_id = state->toplevels[index].app_id;
+  return app_id ? app_id : "";
+}
+
+/* Starts a capture session for window `index`, replacing any earlier one.
+ * Copies are asked for with wl_backend_capture_request. */
+int wl_backend_capture_start(WaylandState *state, int index) {
+  if (!state->toplevel_sources || !state->copy_capture)
+    return -1;
+  if (index < 0 || index >= state->toplevel_count)
+    return -1;
+  WindowCapture *capture = &state->capture;
+  capture_destroy(capture);
+  capture->source =
+      ext_foreign_toplevel_image_capture_source_manager_v1_create_source(
+          state->toplevel_sources, state->toplevels[index].handle);
+  capture->session = ext_image_copy_capture_manager_v1_create_session(
+      state->copy_capture, capture->source, 0);
+  ext_image_copy_capture_session_v1_add_listener(
+      capture->session, &capture_session_listener, capture);
+  return 0;
+}
+
+/* Asks for the next copy. Does nothing while one is in flight or the
+ * constraints are still on their way, so it can be called every frame.
+ * The compositor answers once the window has changed, an idle window
+ * costs nothing. */
+int wl_backend_capture_request(WaylandState *state) {
+  WindowCapture *capture = &state->capture;
+  if (!capture->session || capture->stopped)
+    return -1;
+  if (capture->frame || !capture->constrained)
+    return 0;
+  if (!capture->format) {
+    fprintf(stderr, "The window capture offers no ARGB8888 or XRGB8888 "
+                    "shm buffers\n");
+    return -1;
+  }
+
+  int fresh = 0;
+  if (capture->buffer_width != capture->width ||
+      capture->buffer_height != capture->height) {
+    if (capture->buffer)
+      wl_buffer_destroy(capture->buffer);
+    if (capture->data)
+      munmap(capture->data,
+             (size_t)capture->buffer_width * capture->buffer_height * 4);
+    capture->data = NULL;
+    capture->buffer = create_shm_buffer(state, capture->width,
+                                        capture->height, capture->format,
+                                        &capture->data);
+    if (!capture->buffer)
+      return -1;
+    capture->buffer_width = capture->width;
+    capture->buffer_height = capture->height;
+    fresh = 1;
+  }
+
+  capture->frame =
+      ext_image_copy_capture_session_v1_create_frame(capture->session);
+  ext_image_copy_capture_frame_v1_add_listener(
+      capture->frame, &capture_frame_listener, capture);
+  ext_image_copy_capture_frame_v1_attach_buffer(capture->frame,
+                                                capture->buffer);
+  /* We never write to the buffer, so after the first copy the compositor
+   * only has to redo what changed in the window */
+  if (fresh)
+    ext_image_copy_capture_frame_v1_damage_buffer(
+        capture->frame, 0, 0, capture->width, capture->height);
+  ext_image_copy_capture_frame_v1_capture(capture->frame);
+  return 0;
+}
+
+/* 1 when a copy landed since the last call, -1 once the window is gone.
+ * Events are dispatched by wl_backend_poll_events. */
+int wl_backend_capture_ready(WaylandState *state) {
+  if (state->capture.ready) {
+    state->capture.ready = 0;
+    return 1;
+  }
+  return state->capture.stopped ? -1 : 0;
+}
+
+/* Requests a copy and blocks until it lands */
+int wl_backend_capture_wait(WaylandState *state) {
+  while (!state->capture.ready) {
+    if (wl_backend_capture_request(state) < 0)
+      return -1;
+    if (wl_display_dispatch(state->display) < 0)
+      return -1;
+  }
+  state->capture.ready = 0;
+  return 0;
+}
+
+/* The last copy, BGRA and tightly packed. Valid until the next request
+ * after the window was resized. */
+const void *wl_backend_capture_pixels(WaylandState *state) {
+  return state->capture.data;
+}
+int wl_backend_capture_width(WaylandState *state) {
+  return state->capture.buffer_width;
+}
+int wl_backend_capture_height(WaylandState *state) {
+  return state->capture.buffer_height;
+}
+
+/* Starts following the pointer for the lens. Needs wlr-screencopy for the
+ * copies, and an image copy cursor session on the output for the pointer
+ * position, which the lens itself never receives. */
+int wl_backend_lens_start(WaylandState *state) {
+  if (!state->screencopy || !state->output_sources || !state->copy_capture ||
+      !state->pointer || !state->output)
+    return -1;
+  state->cursor_source =
+      ext_output_image_capture_source_manager_v1_create_source(
+          state->output_sources, state->output);
+  state->cursor_session =
+      ext_image_copy_capture_manager_v1_create_pointer_cursor_session(
+          state->copy_capture, state->cursor_source, state->pointer);
+  ext_image_copy_capture_cursor_session_v1_add_listener(
+      state->cursor_session, &cursor_session_listener, state);
+  return 0;
+}
+
+/* Puts the lens' top left corner at (x, y), logical pixels from the
+ * output's. Takes effect with the next frame. */
+void wl_backend_lens_move(WaylandState *state, int x, int y) {
+  zwlr_layer_surface_v1_set_margin(state->layer_surface, y, 0, 0, x);
+}
+
+/* Asks for a copy of a rectangle of the output, in logical pixels. 1 when
+ * it went out, 0 while the last one is still in flight. */
+int wl_backend_region_request(WaylandState *state, int x, int y, int width,
+                              int height) {
+  RegionCapture *region = &state->region;
+  if (region->frame)
+    return 0;
+  region->format = 0;
+  region->y_invert = 0;
+  region->frame = zwlr_screencopy_manager_v1_capture_output_region(
+      state->screencopy, 0, state->output, x, y, width, height);
+  zwlr_screencopy_frame_v1_add_listener(region->frame,
+                                        &region_frame_listener, state);
+  return 1;
+}
+
+/* 1 when a copy landed since the last call */
+int wl_backend_region_ready(WaylandState *state) {
+  int ready = state->region.ready;
+  state->region.ready = 0;
+  return ready;
+}
+
+/* The last copy, BGRA and tightly packed, in output buffer pixels */
+const void *wl_backend_region_pixels(WaylandState *state) {
+  return state->region.data;
+}
+int wl_backend_region_width(WaylandState *state) {
+  return state->region.buffer_width;
+}
+int wl_backend_region_height(WaylandState *state) {
+  return state->region.buffer_height;
+}
+
+/* GL entry points for the renderer on the Nim side, which looks them up
+ * here rather than in libGL: a GLES-only driver has no libGL. NULL for
+ * what the current context lacks. */
+void *wl_backend_gl_proc(WaylandState *state, const char *name) {
+  if (state->egl_all_procs)
+    return (void *)eglGetProcAddress(name);
+  /* Older EGL only returns extension functions */
+  if (!state->gl_library) {
+    if (state->gl_api == 0) {
+      state->gl_library = dlopen("libOpenGL.so.0", RTLD_LAZY | RTLD_LOCAL);
+      if (!state->gl_library)
+        state->gl_library = dlopen("libGL.so.1", RTLD_LAZY | RTLD_LOCAL);
+    } else {
+      state->gl_library = dlopen("libGLESv2.so.2", RTLD_LAZY | RTLD_LOCAL);
+    }
+  }
+  void *proc = state->gl_library ? dlsym(state->gl_library, name) : NULL;
+  return proc ? proc : (void *)eglGetProcAddress(name);
+}
+
 /* Getters for Nim */
 int wl_state_width(WaylandState *s) { return s->width; }
 int wl_state_height(WaylandState *s) { return s->height; }
+int wl_state_buffer_width(WaylandState *s) { return s->buffer_width; }
+int wl_state_buffer_height(WaylandState *s) { return s->buffer_height; }
+double wl_state_scale(WaylandState *s) { return surface_scale(s); }
+int wl_state_renderer(WaylandState *s) { return s->renderer; }
+int wl_state_gl_api(WaylandState *s) { return s->gl_api; }
+struct wl_display *wl_state_display(WaylandState *s) { return s->display; }
+struct wl_surface *wl_state_surface(WaylandState *s) { return s->surface; }
 int wl_state_configured(WaylandState *s) { return s->configured; }
 int wl_state_closed(WaylandState *s) { return s->closed; }
 float wl_state_pointer_x(WaylandState *s) { return s->pointer_x; }
@@ -613,11 +2078,24 @@ int wl_state_button_just_pressed(WaylandState *s) {
 int wl_state_button_just_released(WaylandState *s) {
   return s->button_just_released;
 }
-int wl_state_scroll_delta(WaylandState *s) { return s->scroll_delta; }
+double wl_state_scroll_delta(WaylandState *s) { return s->scroll_delta; }
 int wl_state_ctrl_held(WaylandState *s) { return s->ctrl_held; }
 int wl_state_output_rate(WaylandState *s) {
   return s->output_rate > 0 ? s->output_rate / 1000 : 60;
 }
+int wl_state_output_x(WaylandState *s) { return s->output_x; }
+/* The output as its buffers hold it, which for a rotated one is the mode
+ * turned on its side. Odd transforms are the 90 and 270 degree ones. */
+int wl_state_output_width(WaylandState *s) {
+  return s->output_transform & 1 ? s->output_height : s->output_width;
+}
+int wl_state_output_height(WaylandState *s) {
+  return s->output_transform & 1 ? s->output_width : s->output_height;
+}
+int wl_state_cursor_x(WaylandState *s) { return s->cursor_x; }
+int wl_state_cursor_y(WaylandState *s) { return s->cursor_y; }
+int wl_state_cursor_inside(WaylandState *s) { return s->cursor_inside; }
+int wl_state_output_y(WaylandState *s) { return s->output_y; }
 
 /* Key event queue iteration for Nim */
 int wl_state_key_event_count(WaylandState *s) { return s->key_event_count; }
@@ -631,3 +2109,23 @@ int wl_state_key_event_state(WaylandState *s, int index) {
     return s->key_events[index].state;
   return 0;
 }
+
+/* Pointer motion queue iteration for Nim */
+int wl_state_motion_event_count(WaylandState *s) {
+  return s->motion_event_count;
+}
+uint32_t wl_state_motion_event_time(WaylandState *s, int index) {
+  if (index >= 0 && index < s->motion_event_count)
+    return s->motion_events[index].time;
+  return 0;
+}
+float wl_state_motion_event_x(WaylandState *s, int index) {
+  if (index >= 0 && index < s->motion_event_count)
+    return s->motion_events[index].x;
+  return s->pointer_x;
+}
+float wl_state_motion_event_y(WaylandState *s, int index) {
+  if (index >= 0 && index < s->motion_event_count)
+    return s->motion_events[index].y;
+  return s->pointer_y;
+}
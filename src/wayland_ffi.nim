@@ -1,37 +1,95 @@
-## Nim FFI bindings for the Wayland C backend (wayland_backend.c)
+## Nim FFI bindings for the Wayland C backend (wayland_backend.c). The C
+## side is built into libboomer_wayland.so by wayland_library.nim and only
+## loaded, together with libwayland-client and libEGL, by
+## `loadWaylandBackend`.
 
-{.compile: "wayland_backend.c".}
-{.compile: "xdg-shell-protocol.c".}
-{.compile: "wlr-layer-shell-protocol.c".}
-{.passL: "-lwayland-client -lwayland-egl -lEGL".}
+import os
+import dynamic_library
 
 type WaylandState* = distinct pointer
 
-proc wl_backend_init*(windowed: cint): WaylandState {.importc, cdecl.}
-proc wl_backend_swap_buffers*(state: WaylandState) {.importc, cdecl.}
-proc wl_backend_show_surface*(state: WaylandState) {.importc, cdecl.}
-proc wl_backend_poll_events*(state: WaylandState): cint {.importc, cdecl.}
-proc wl_backend_dispatch*(state: WaylandState): cint {.importc, cdecl.}
-proc wl_state_reset_frame*(state: WaylandState) {.importc, cdecl.}
-proc wl_backend_prepare_read*(state: WaylandState): cint {.importc, cdecl.}
-proc wl_backend_read_events*(state: WaylandState): cint {.importc, cdecl.}
-proc wl_backend_cancel_read*(state: WaylandState) {.importc, cdecl.}
-proc wl_backend_get_fd*(state: WaylandState): cint {.importc, cdecl.}
-proc wl_backend_roundtrip*(state: WaylandState): cint {.importc, cdecl.}
-proc wl_backend_destroy*(state: WaylandState) {.importc, cdecl.}
+proc backendLibraries*(): seq[string] =
+  ## Next to the binary, where a package installs it, then the usual
+  ## dlopen search path
+  const name = "libboomer_wayland.so"
+  @[getAppDir() / name, getAppDir() / ".." / "lib" / "boomer" / name, name]
 
-proc wl_state_width*(s: WaylandState): cint {.importc, cdecl.}
-proc wl_state_height*(s: WaylandState): cint {.importc, cdecl.}
-proc wl_state_configured*(s: WaylandState): cint {.importc, cdecl.}
-proc wl_state_closed*(s: WaylandState): cint {.importc, cdecl.}
-proc wl_state_pointer_x*(s: WaylandState): cfloat {.importc, cdecl.}
-proc wl_state_pointer_y*(s: WaylandState): cfloat {.importc, cdecl.}
-proc wl_state_button_pressed*(s: WaylandState): cint {.importc, cdecl.}
-proc wl_state_button_just_pressed*(s: WaylandState): cint {.importc, cdecl.}
-proc wl_state_button_just_released*(s: WaylandState): cint {.importc, cdecl.}
-proc wl_state_scroll_delta*(s: WaylandState): cint {.importc, cdecl.}
-proc wl_state_ctrl_held*(s: WaylandState): cint {.importc, cdecl.}
-proc wl_state_output_rate*(s: WaylandState): cint {.importc, cdecl.}
-proc wl_state_key_event_count*(s: WaylandState): cint {.importc, cdecl.}
-proc wl_state_key_event_key*(s: WaylandState, index: cint): cint {.importc, cdecl.}
-proc wl_state_key_event_state*(s: WaylandState, index: cint): cint {.importc, cdecl.}
+dynamicImport(loadWaylandBackend, backendLibraries()):
+  proc wl_backend_init*(windowed: cint, lowLatency: cint, renderer: cint,
+                        lensSize: cint): WaylandState {.importc, cdecl.}
+  proc wl_backend_fallback_gl*(state: WaylandState): cint {.importc, cdecl.}
+  proc wl_backend_hide*(state: WaylandState) {.importc, cdecl.}
+  proc wl_backend_show*(state: WaylandState): cint {.importc, cdecl.}
+  proc wl_backend_wait_fds*(state: WaylandState, fds: ptr cint, count: cint): cint {.importc, cdecl.}
+  proc wl_backend_swap_buffers*(state: WaylandState) {.importc, cdecl.}
+  proc wl_backend_set_image*(state: WaylandState, pixels: cstring, width, height: cint): cint {.importc, cdecl.}
+  proc wl_backend_present_view*(state: WaylandState, x, y, scale: cdouble) {.importc, cdecl.}
+  proc wl_backend_present_software*(state: WaylandState, x, y, scale: cdouble,
+                                    cursorX, cursorY: cdouble,
+                                    flShadow, flRadius: cdouble) {.importc, cdecl.}
+  proc wl_backend_poll_events*(state: WaylandState): cint {.importc, cdecl.}
+  proc wl_backend_dispatch*(state: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_reset_frame*(state: WaylandState) {.importc, cdecl.}
+  proc wl_backend_prepare_read*(state: WaylandState): cint {.importc, cdecl.}
+  proc wl_backend_read_events*(state: WaylandState): cint {.importc, cdecl.}
+  proc wl_backend_cancel_read*(state: WaylandState) {.importc, cdecl.}
+  proc wl_backend_get_fd*(state: WaylandState): cint {.importc, cdecl.}
+  proc wl_backend_roundtrip*(state: WaylandState): cint {.importc, cdecl.}
+  proc wl_backend_finish_init*(state: WaylandState): cint {.importc, cdecl.}
+  proc wl_backend_wait_configured*(state: WaylandState): cint {.importc, cdecl.}
+  proc wl_backend_destroy*(state: WaylandState) {.importc, cdecl.}
+
+  proc wl_backend_toplevel_count*(state: WaylandState): cint {.importc, cdecl.}
+  proc wl_backend_toplevel_title*(state: WaylandState, index: cint): cstring {.importc, cdecl.}
+  proc wl_backend_toplevel_app_id*(state: WaylandState, index: cint): cstring {.importc, cdecl.}
+  proc wl_backend_capture_start*(state: WaylandState, index: cint): cint {.importc, cdecl.}
+  proc wl_backend_capture_request*(state: WaylandState): cint {.importc, cdecl.}
+  proc wl_backend_capture_ready*(state: WaylandState): cint {.importc, cdecl.}
+  proc wl_backend_capture_wait*(state: WaylandState): cint {.importc, cdecl.}
+  proc wl_backend_capture_pixels*(state: WaylandState): cstring {.importc, cdecl.}
+  proc wl_backend_capture_width*(state: WaylandState): cint {.importc, cdecl.}
+  proc wl_backend_capture_height*(state: WaylandState): cint {.importc, cdecl.}
+
+  proc wl_backend_lens_start*(state: WaylandState): cint {.importc, cdecl.}
+  proc wl_backend_lens_move*(state: WaylandState, x, y: cint) {.importc, cdecl.}
+  proc wl_backend_region_request*(state: WaylandState, x, y, width, height: cint): cint {.importc, cdecl.}
+  proc wl_backend_region_ready*(state: WaylandState): cint {.importc, cdecl.}
+  proc wl_backend_region_pixels*(state: WaylandState): cstring {.importc, cdecl.}
+  proc wl_backend_region_width*(state: WaylandState): cint {.importc, cdecl.}
+  proc wl_backend_region_height*(state: WaylandState): cint {.importc, cdecl.}
+
+  proc wl_state_width*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_height*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_buffer_width*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_buffer_height*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_scale*(s: WaylandState): cdouble {.importc, cdecl.}
+  proc wl_state_renderer*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_gl_api*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_backend_gl_proc*(s: WaylandState, name: cstring): pointer
+    {.importc, cdecl.}
+  proc wl_state_display*(s: WaylandState): pointer {.importc, cdecl.}
+  proc wl_state_surface*(s: WaylandState): pointer {.importc, cdecl.}
+  proc wl_state_configured*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_closed*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_pointer_x*(s: WaylandState): cfloat {.importc, cdecl.}
+  proc wl_state_pointer_y*(s: WaylandState): cfloat {.importc, cdecl.}
+  proc wl_state_button_pressed*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_button_just_pressed*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_button_just_released*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_scroll_delta*(s: WaylandState): cdouble {.importc, cdecl.}
+  proc wl_state_ctrl_held*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_output_rate*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_output_x*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_output_y*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_output_width*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_output_height*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_cursor_x*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_cursor_y*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_cursor_inside*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_key_event_count*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_key_event_key*(s: WaylandState, index: cint): cint {.importc, cdecl.}
+  proc wl_state_key_event_state*(s: WaylandState, index: cint): cint {.importc, cdecl.}
+  proc wl_state_motion_event_count*(s: WaylandState): cint {.importc, cdecl.}
+  proc wl_state_motion_event_time*(s: WaylandState, index: cint): uint32 {.importc, cdecl.}
+  proc wl_state_motion_event_x*(s: WaylandState, index: cint): cfloat {.importc, cdecl.}
+  proc wl_state_motion_event_y*(s: WaylandState, index: cint): cfloat {.importc, cdecl.}
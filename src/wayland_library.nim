@@ -0,0 +1,24 @@
+## Builds the C side of the Wayland backend into libboomer_wayland.so,
+## which wayland_ffi.nim loads at runtime. Linking libwayland-client and
+## libEGL here instead of into boomer keeps them out of X11 sessions.
+##
+##   nim c --app:lib --noMain -d:release -o:libboomer_wayland.so src/wayland_library.nim
+##
+## Build it with the same -d:vulkan as boomer.
+
+{.compile: "wayland_backend.c".}
+{.compile: "xdg-shell-protocol.c".}
+{.compile: "wlr-layer-shell-protocol.c".}
+{.compile: "wlr-screencopy-protocol.c".}
+{.compile: "tearing-control-v1-protocol.c".}
+{.compile: "viewporter-protocol.c".}
+{.compile: "fractional-scale-v1-protocol.c".}
+{.compile: "ext-foreign-toplevel-list-v1-protocol.c".}
+{.compile: "ext-image-capture-source-v1-protocol.c".}
+{.compile: "ext-image-copy-capture-v1-protocol.c".}
+{.compile: "software_renderer.c".}
+{.passL: "-lwayland-client -lwayland-egl -lEGL -ldl -lpthread".}
+
+when defined(vulkan):
+  {.compile: "vulkan_backend.c".}
+  {.passL: "-lvulkan".}
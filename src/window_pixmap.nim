@@ -0,0 +1,220 @@
+## Zero-copy live tracking of one window for the X11 backend (-d:select
+## with -d:live). XComposite redirects the window so the server keeps its
+## contents in a pixmap, and GLX_EXT_texture_from_pixmap makes that pixmap
+## the GL texture, so no pixels come to the client. The pixmap is replaced
+## by the server when the window is resized, which is the only time it has
+## to be named and wrapped again.
+
+import x11/xlib, x11/x, x11/xutil
+import gl_library
+import glx_library
+import strutils
+import dynamic_library
+
+const
+  CompositeRedirectAutomatic = 0.cint
+
+  GLX_DRAWABLE_TYPE = 0x8010.cint
+  GLX_PIXMAP_BIT = 0x2.cint
+  GLX_BIND_TO_TEXTURE_RGB_EXT = 0x20D0.cint
+  GLX_BIND_TO_TEXTURE_RGBA_EXT = 0x20D1.cint
+  GLX_BIND_TO_TEXTURE_TARGETS_EXT = 0x20D3.cint
+  GLX_Y_INVERTED_EXT = 0x20D4.cint
+  GLX_TEXTURE_FORMAT_EXT = 0x20D5.cint
+  GLX_TEXTURE_TARGET_EXT = 0x20D6.cint
+  GLX_TEXTURE_FORMAT_RGB_EXT = 0x20D9.cint
+  GLX_TEXTURE_FORMAT_RGBA_EXT = 0x20DA.cint
+  GLX_TEXTURE_2D_BIT_EXT = 0x2.cint
+  GLX_TEXTURE_2D_EXT = 0x20DC.cint
+  GLX_FRONT_LEFT_EXT = 0x20DE.cint
+
+type
+  GLXFBConfig = pointer
+  GLXPixmap = culong
+
+  GLXChooseFBConfig = proc (display: PDisplay, screen: cint,
+                            attributes: ptr cint, count: ptr cint):
+                           ptr UncheckedArray[GLXFBConfig] {.cdecl.}
+  GLXGetVisualFromFBConfig = proc (display: PDisplay,
+                                   config: GLXFBConfig): PXVisualInfo
+                                  {.cdecl.}
+  GLXCreatePixmap = proc (display: PDisplay, config: GLXFBConfig,
+                          pixmap: Pixmap, attributes: ptr cint): GLXPixmap
+                         {.cdecl.}
+  GLXDestroyPixmap = proc (display: PDisplay, pixmap: GLXPixmap) {.cdecl.}
+  GLXBindTexImageEXT = proc (display: PDisplay, drawable: GLXPixmap,
+                             buffer: cint, attributes: ptr cint) {.cdecl.}
+  GLXReleaseTexImageEXT = proc (display: PDisplay, drawable: GLXPixmap,
+                                buffer: cint) {.cdecl.}
+
+  WindowPixmap* = object
+    display: PDisplay
+    window: Window
+    width*, height*: int
+    config: GLXFBConfig
+    format: cint
+    pixmap: Pixmap
+    glxPixmap: GLXPixmap
+    createPixmap: GLXCreatePixmap
+    destroyPixmap: GLXDestroyPixmap
+    bindTexImage: GLXBindTexImageEXT
+    releaseTexImage: GLXReleaseTexImageEXT
+
+# Loaded on first use, without libXcomposite live tracking copies pixels
+dynamicImport(loadXlibPixmaps, ["libX11.so.6", "libX11.so"]):
+  proc xFree(data: pointer): cint {.cdecl, importc: "XFree".}
+  proc xFreePixmap(display: PDisplay, pixmap: Pixmap): cint
+    {.cdecl, importc: "XFreePixmap".}
+  proc xSelectInput(display: PDisplay, window: Window, mask: clong): cint
+    {.cdecl, importc: "XSelectInput".}
+  proc xGetWindowAttributes(display: PDisplay, window: Window,
+                            attributes: ptr XWindowAttributes): cint
+    {.cdecl, importc: "XGetWindowAttributes".}
+
+dynamicImport(loadXcomposite, ["libXcomposite.so.1", "libXcomposite.so"]):
+  proc xCompositeQueryExtension(display: PDisplay,
+                                eventBase, errorBase: ptr cint): cint
+    {.cdecl, importc: "XCompositeQueryExtension".}
+  proc xCompositeRedirectWindow(display: PDisplay, window: Window,
+                                update: cint)
+    {.cdecl, importc: "XCompositeRedirectWindow".}
+  proc xCompositeUnredirectWindow(display: PDisplay, window: Window,
+                                  update: cint)
+    {.cdecl, importc: "XCompositeUnredirectWindow".}
+  proc xCompositeNameWindowPixmap(display: PDisplay,
+                                  window: Window): Pixmap
+    {.cdecl, importc: "XCompositeNameWindowPixmap".}
+
+proc chooseConfig(display: PDisplay, screen: cint, depth: cint,
+                  format: cint): GLXFBConfig =
+  ## A pixmap config with the window's depth whose rows come out top
+  ## down, like the ones glTexImage2D gets from a screenshot
+  let chooseFBConfig = cast[GLXChooseFBConfig](
+    getGLXProcAddress("glXChooseFBConfig"))
+  let visualFromConfig = cast[GLXGetVisualFromFBConfig](
+    getGLXProcAddress("glXGetVisualFromFBConfig"))
+  if chooseFBConfig == nil or visualFromConfig == nil:
+    return nil
+
+  let bindTo = if format == GLX_TEXTURE_FORMAT_RGBA_EXT:
+                 GLX_BIND_TO_TEXTURE_RGBA_EXT
+               else:
+                 GLX_BIND_TO_TEXTURE_RGB_EXT
+  var attributes = [
+    GLX_DRAWABLE_TYPE, GLX_PIXMAP_BIT,
+    bindTo, 1,
+    GLX_BIND_TO_TEXTURE_TARGETS_EXT, GLX_TEXTURE_2D_BIT_EXT,
+    GLX_Y_INVERTED_EXT, 1,
+    GLX_DOUBLEBUFFER, 0,
+    None.cint
+  ]
+  var count: cint
+  let configs = chooseFBConfig(display, screen, addr attributes[0],
+                               addr count)
+  if configs == nil:
+    return nil
+  defer: discard xFree(configs)
+
+  for i in 0 ..< count.int:
+    let visual = visualFromConfig(display, configs[i])
+    if visual == nil:
+      continue
+    let matches = visual.depth == depth
+    discard xFree(visual)
+    if matches:
+      return configs[i]
+
+proc name(wp: var WindowPixmap) =
+  wp.pixmap = xCompositeNameWindowPixmap(wp.display, wp.window)
+  var attributes = [
+    GLX_TEXTURE_TARGET_EXT, GLX_TEXTURE_2D_EXT,
+    GLX_TEXTURE_FORMAT_EXT, wp.format,
+    None.cint
+  ]
+  wp.glxPixmap = wp.createPixmap(wp.display, wp.config, wp.pixmap,
+                                 addr attributes[0])
+
+proc unname(wp: var WindowPixmap) =
+  wp.destroyPixmap(wp.display, wp.glxPixmap)
+  discard xFreePixmap(wp.display, wp.pixmap)
+  wp.glxPixmap = 0
+  wp.pixmap = 0
+
+proc initWindowPixmap*(display: PDisplay, screen: cint, root: Window,
+                       window: Window, wp: var WindowPixmap): bool =
+  ## False when the server or the driver can't do it, the caller then keeps
+  ## copying screenshots. The window has to be mapped, and the root window
+  ## can't be redirected at all.
+  if window == root:
+    return false
+  let extensions = ($glXQueryExtensionsString(display, screen)).splitWhitespace
+  if "GLX_EXT_texture_from_pixmap" notin extensions:
+    stderr.writeLine "GLX_EXT_texture_from_pixmap is not supported, copying the window instead"
+    return false
+  if not loadXlibPixmaps() or not loadXcomposite():
+    return false
+  var eventBase, errorBase: cint
+  if xCompositeQueryExtension(display, addr eventBase, addr errorBase) == 0:
+    stderr.writeLine "XComposite is not supported, copying the window instead"
+    return false
+
+  var attributes: XWindowAttributes
+  if xGetWindowAttributes(display, window, addr attributes) == 0:
+    return false
+
+  wp.display = display
+  wp.window = window
+  wp.width = attributes.width.int
+  wp.height = attributes.height.int
+  wp.format = if attributes.depth == 32: GLX_TEXTURE_FORMAT_RGBA_EXT
+              else: GLX_TEXTURE_FORMAT_RGB_EXT
+  wp.config = chooseConfig(display, screen, attributes.depth, wp.format)
+  wp.createPixmap = cast[GLXCreatePixmap](getGLXProcAddress("glXCreatePixmap"))
+  wp.destroyPixmap = cast[GLXDestroyPixmap](getGLXProcAddress("glXDestroyPixmap"))
+  wp.bindTexImage = cast[GLXBindTexImageEXT](getGLXProcAddress("glXBindTexImageEXT"))
+  wp.releaseTexImage = cast[GLXReleaseTexImageEXT](getGLXProcAddress("glXReleaseTexImageEXT"))
+  if wp.config == nil or wp.createPixmap == nil or
+     wp.destroyPixmap == nil or wp.bindTexImage == nil or
+     wp.releaseTexImage == nil:
+    stderr.writeLine "No GLX config binds a pixmap of depth ", attributes.depth, ", copying the window instead"
+    return false
+
+  # The resizes to name the new pixmap on
+  discard xSelectInput(display, window,
+                       attributes.your_event_mask or StructureNotifyMask)
+  xCompositeRedirectWindow(display, window, CompositeRedirectAutomatic)
+  wp.name()
+  true
+
+proc bindTexture*(wp: WindowPixmap) =
+  ## Makes the pixmap the contents of the bound GL_TEXTURE_2D. The bytes
+  ## come in RGB order rather than the BGRA of a screenshot, the swizzle
+  ## swaps them back for frag.glsl.
+  wp.bindTexImage(wp.display, wp.glxPixmap, GL_FRONT_LEFT_EXT, nil)
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_BLUE.GLint)
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED.GLint)
+
+proc update*(wp: WindowPixmap) =
+  ## What the window drew since the last frame is only guaranteed to show
+  ## after the texture is bound again. On DRI drivers that is no copy.
+  wp.releaseTexImage(wp.display, wp.glxPixmap, GL_FRONT_LEFT_EXT)
+  wp.bindTexImage(wp.display, wp.glxPixmap, GL_FRONT_LEFT_EXT, nil)
+
+proc resize*(wp: var WindowPixmap, width, height: int) =
+  ## On ConfigureNotify for the window. The old pixmap keeps the old size,
+  ## so a new one is named and bound in its place.
+  if width == wp.width and height == wp.height:
+    return
+  wp.width = width
+  wp.height = height
+  wp.releaseTexImage(wp.display, wp.glxPixmap, GL_FRONT_LEFT_EXT)
+  wp.unname()
+  wp.name()
+  wp.bindTexture()
+
+proc destroy*(wp: var WindowPixmap) =
+  if wp.glxPixmap == 0:
+    return
+  wp.releaseTexImage(wp.display, wp.glxPixmap, GL_FRONT_LEFT_EXT)
+  wp.unname()
+  xCompositeUnredirectWindow(wp.display, wp.window, CompositeRedirectAutomatic)
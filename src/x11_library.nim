@@ -0,0 +1,94 @@
+## The part of Xlib and MIT-SHM the X11 backend calls, loaded at runtime by
+## `loadX11` (see dynamic_library.nim). The x11 package binds
+## these through the dynlib pragma, which opens the libraries at startup
+## whichever backend runs, so the modules that use them import it with
+## these names excluded.
+##
+## GLX is in glx_library.nim. Requests that wait for a reply go through
+## XCB instead, see xcb_library.nim.
+
+import x11/xlib, x11/x, x11/xutil
+import dynamic_library
+import xcb_library
+import glx_library
+
+when defined(mitshm):
+  import x11/xshm
+
+type XErrorHandlerProc* = proc (display: PDisplay,
+                                event: PXErrorEvent): cint {.cdecl.}
+
+dynamicImport(loadXlib, ["libX11.so.6", "libX11.so"]):
+  proc XInitThreads*(): cint {.importc, cdecl.}
+  proc XOpenDisplay*(name: cstring): PDisplay {.importc, cdecl.}
+  proc XCloseDisplay*(display: PDisplay): cint {.importc, cdecl.}
+  proc XSetErrorHandler*(handler: XErrorHandlerProc): XErrorHandlerProc
+    {.importc, cdecl.}
+  proc XGetErrorText*(display: PDisplay, code: cint, buffer: cstring,
+                      length: cint): cint {.importc, cdecl.}
+  proc XDefaultScreen*(display: PDisplay): cint {.importc, cdecl.}
+  proc XSync*(display: PDisplay, discardEvents: cint): cint {.importc, cdecl.}
+  proc XPending*(display: PDisplay): cint {.importc, cdecl.}
+  proc XNextEvent*(display: PDisplay, event: ptr XEvent): cint
+    {.importc, cdecl.}
+  proc XLookupKeysym*(event: PXKeyEvent, index: cint): KeySym
+    {.importc, cdecl.}
+
+  proc XCreateFontCursor*(display: PDisplay, shape: cuint): Cursor
+    {.importc, cdecl.}
+  proc XFreeCursor*(display: PDisplay, cursor: Cursor): cint
+    {.importc, cdecl.}
+  proc XGrabPointer*(display: PDisplay, window: Window, ownerEvents: cint,
+                     eventMask: cuint, pointerMode, keyboardMode: cint,
+                     confineTo: Window, cursor: Cursor, time: Time): cint
+    {.importc, cdecl.}
+  proc XUngrabPointer*(display: PDisplay, time: Time): cint
+    {.importc, cdecl.}
+  proc XGrabKeyboard*(display: PDisplay, window: Window, ownerEvents: cint,
+                      pointerMode, keyboardMode: cint, time: Time): cint
+    {.importc, cdecl.}
+  proc XUngrabKeyboard*(display: PDisplay, time: Time): cint
+    {.importc, cdecl.}
+  proc XSetInputFocus*(display: PDisplay, focus: Window, revertTo: cint,
+                       time: Time): cint {.importc, cdecl.}
+
+  proc XCreateColormap*(display: PDisplay, window: Window, visual: PVisual,
+                        alloc: cint): Colormap {.importc, cdecl.}
+  proc XCreateWindow*(display: PDisplay, parent: Window, x, y: cint,
+                      width, height, borderWidth: cuint, depth: cint,
+                      class: cuint, visual: PVisual, valueMask: culong,
+                      attributes: ptr XSetWindowAttributes): Window
+    {.importc, cdecl.}
+  proc XMapWindow*(display: PDisplay, window: Window): cint
+    {.importc, cdecl.}
+  proc XStoreName*(display: PDisplay, window: Window, name: cstring): cint
+    {.importc, cdecl.}
+  proc XSetClassHint*(display: PDisplay, window: Window,
+                      hint: ptr XClassHint): cint {.importc, cdecl.}
+  proc XSetWMProtocols*(display: PDisplay, window: Window,
+                        protocols: ptr Atom, count: cint): cint
+    {.importc, cdecl.}
+
+  proc XCreateImage*(display: PDisplay, visual: PVisual, depth: cuint,
+                     format, offset: cint, data: cstring,
+                     width, height: cuint,
+                     bitmapPad, bytesPerLine: cint): PXImage
+    {.importc, cdecl.}
+
+when defined(mitshm):
+  dynamicImport(loadXext, ["libXext.so.6", "libXext.so"]):
+    proc XShmCreateImage*(display: PDisplay, visual: PVisual, depth: cuint,
+                          format: cint, data: cstring,
+                          shminfo: PXShmSegmentInfo,
+                          width, height: cuint): PXImage {.importc, cdecl.}
+    proc XShmAttach*(display: PDisplay, shminfo: PXShmSegmentInfo): cint
+      {.importc, cdecl.}
+    proc XShmDetach*(display: PDisplay, shminfo: PXShmSegmentInfo): cint
+      {.importc, cdecl.}
+
+proc loadX11*(): bool =
+  ## Everything the X11 backend can't run without. libXi is optional and
+  ## loaded by smooth_scroll.nim.
+  result = loadXlib() and loadXcbLibraries() and loadGLX()
+  when defined(mitshm):
+    result = result and loadXext()
@@ -0,0 +1,190 @@
+## The XCB requests the X11 backend pipelines, loaded at runtime like
+## x11_library.nim. Xlib still owns the connection (GLX needs it); XCB is
+## used on the same connection through XGetXCBConnection, because its
+## requests return a cookie right away and the reply is collected later,
+## so several of them share one round trip.
+##
+## Replies are malloc'ed by libxcb and released with `xcbFree`.
+
+import x11/xlib
+import dynamic_library
+
+type
+  XcbConnection* = distinct pointer
+  XcbCookie* = object
+    sequence*: cuint
+
+  XcbQueryPointerReply* = object
+    responseType: uint8
+    sameScreen*: uint8
+    sequence: uint16
+    length: uint32
+    root*, child*: uint32
+    rootX*, rootY*, winX*, winY*: int16
+    mask*: uint16
+    pad: array[2, uint8]
+
+  XcbGetGeometryReply* = object
+    responseType: uint8
+    depth*: uint8
+    sequence: uint16
+    length: uint32
+    root*: uint32
+    x*, y*: int16
+    width*, height*, borderWidth*: uint16
+    pad: array[2, uint8]
+
+  XcbGetInputFocusReply* = object
+    responseType: uint8
+    revertTo*: uint8
+    sequence: uint16
+    length: uint32
+    focus*: uint32
+
+  XcbInternAtomReply* = object
+    responseType: uint8
+    pad: uint8
+    sequence: uint16
+    length: uint32
+    atom*: uint32
+
+  XcbGetImageReply* = object
+    responseType: uint8
+    depth*: uint8
+    sequence: uint16
+    length: uint32
+    visual*: uint32
+    pad: array[20, uint8]
+
+  XcbShmGetImageReply* = object
+    responseType: uint8
+    depth*: uint8
+    sequence: uint16
+    length: uint32
+    visual*: uint32
+    size*: uint32
+
+  XcbRandrGetScreenInfoReply* = object
+    responseType: uint8
+    rotations*: uint8
+    sequence: uint16
+    length: uint32
+    root*: uint32
+    timestamp*, configTimestamp*: uint32
+    nSizes*, sizeID*, rotation*, rate*, nInfo*: uint16
+    pad: array[2, uint8]
+
+  XcbRandrGetScreenResourcesCurrentReply* = object
+    responseType: uint8
+    pad0: uint8
+    sequence: uint16
+    length: uint32
+    timestamp*, configTimestamp*: uint32
+    nCrtcs*, nOutputs*, nModes*, namesLen*: uint16
+    pad1: array[8, uint8]
+
+  XcbRandrModeInfo* = object
+    id*: uint32
+    width*, height*: uint16
+    dotClock*: uint32
+    hsyncStart*, hsyncEnd*, htotal*, hskew*: uint16
+    vsyncStart*, vsyncEnd*, vtotal*: uint16
+    nameLen*: uint16
+    modeFlags*: uint32
+
+  XcbRandrGetCrtcInfoReply* = object
+    responseType: uint8
+    status*: uint8
+    sequence: uint16
+    length: uint32
+    timestamp*: uint32
+    x*, y*: int16
+    width*, height*: uint16
+    mode*: uint32
+    rotation*, rotations*, nOutputs*, nPossibleOutputs*: uint16
+
+const
+  XCB_IMAGE_FORMAT_Z_PIXMAP* = 2'u8
+  XCB_RANDR_MODE_FLAG_INTERLACE* = 16'u32
+  XCB_RANDR_MODE_FLAG_DOUBLE_SCAN* = 32'u32
+
+proc xcbFree*(p: pointer) {.importc: "free", header: "<stdlib.h>".}
+
+dynamicImport(loadXlibXcb, ["libX11-xcb.so.1", "libX11-xcb.so"]):
+  proc XGetXCBConnection*(display: PDisplay): XcbConnection {.importc, cdecl.}
+
+dynamicImport(loadXcb, ["libxcb.so.1", "libxcb.so"]):
+  proc xcb_flush*(c: XcbConnection): cint {.importc, cdecl.}
+  proc xcb_discard_reply*(c: XcbConnection, sequence: cuint)
+    {.importc, cdecl.}
+  proc xcb_query_pointer*(c: XcbConnection, window: uint32): XcbCookie
+    {.importc, cdecl.}
+  proc xcb_query_pointer_reply*(c: XcbConnection, cookie: XcbCookie,
+                                error: pointer): ptr XcbQueryPointerReply
+    {.importc, cdecl.}
+  proc xcb_get_geometry*(c: XcbConnection, drawable: uint32): XcbCookie
+    {.importc, cdecl.}
+  proc xcb_get_geometry_reply*(c: XcbConnection, cookie: XcbCookie,
+                               error: pointer): ptr XcbGetGeometryReply
+    {.importc, cdecl.}
+  proc xcb_get_input_focus*(c: XcbConnection): XcbCookie {.importc, cdecl.}
+  proc xcb_get_input_focus_reply*(c: XcbConnection, cookie: XcbCookie,
+                                  error: pointer): ptr XcbGetInputFocusReply
+    {.importc, cdecl.}
+  proc xcb_intern_atom*(c: XcbConnection, onlyIfExists: uint8,
+                        nameLen: uint16, name: cstring): XcbCookie
+    {.importc, cdecl.}
+  proc xcb_intern_atom_reply*(c: XcbConnection, cookie: XcbCookie,
+                              error: pointer): ptr XcbInternAtomReply
+    {.importc, cdecl.}
+  proc xcb_get_image*(c: XcbConnection, format: uint8, drawable: uint32,
+                      x, y: int16, width, height: uint16,
+                      planeMask: uint32): XcbCookie {.importc, cdecl.}
+  proc xcb_get_image_reply*(c: XcbConnection, cookie: XcbCookie,
+                            error: pointer): ptr XcbGetImageReply
+    {.importc, cdecl.}
+  proc xcb_get_image_data*(reply: ptr XcbGetImageReply): cstring
+    {.importc, cdecl.}
+
+dynamicImport(loadXcbShm, ["libxcb-shm.so.0", "libxcb-shm.so"]):
+  proc xcb_shm_get_image*(c: XcbConnection, drawable: uint32,
+                          x, y: int16, width, height: uint16,
+                          planeMask: uint32, format: uint8,
+                          shmseg: uint32, offset: uint32): XcbCookie
+    {.importc, cdecl.}
+  proc xcb_shm_get_image_reply*(c: XcbConnection, cookie: XcbCookie,
+                                error: pointer): ptr XcbShmGetImageReply
+    {.importc, cdecl.}
+
+dynamicImport(loadXcbRandr, ["libxcb-randr.so.0", "libxcb-randr.so"]):
+  proc xcb_randr_get_screen_info*(c: XcbConnection,
+                                  window: uint32): XcbCookie
+    {.importc, cdecl.}
+  proc xcb_randr_get_screen_info_reply*(c: XcbConnection,
+                                        cookie: XcbCookie, error: pointer):
+                                        ptr XcbRandrGetScreenInfoReply
+    {.importc, cdecl.}
+  proc xcb_randr_get_screen_resources_current*(c: XcbConnection,
+                                               window: uint32): XcbCookie
+    {.importc, cdecl.}
+  proc xcb_randr_get_screen_resources_current_reply*(
+    c: XcbConnection, cookie: XcbCookie, error: pointer):
+    ptr XcbRandrGetScreenResourcesCurrentReply {.importc, cdecl.}
+  proc xcb_randr_get_screen_resources_current_crtcs*(
+    reply: ptr XcbRandrGetScreenResourcesCurrentReply): ptr uint32
+    {.importc, cdecl.}
+  proc xcb_randr_get_screen_resources_current_modes*(
+    reply: ptr XcbRandrGetScreenResourcesCurrentReply): ptr XcbRandrModeInfo
+    {.importc, cdecl.}
+  proc xcb_randr_get_crtc_info*(c: XcbConnection, crtc: uint32,
+                                configTimestamp: uint32): XcbCookie
+    {.importc, cdecl.}
+  proc xcb_randr_get_crtc_info_reply*(c: XcbConnection, cookie: XcbCookie,
+                                      error: pointer):
+                                      ptr XcbRandrGetCrtcInfoReply
+    {.importc, cdecl.}
+
+proc loadXcbLibraries*(): bool =
+  result = loadXlibXcb() and loadXcb() and loadXcbRandr()
+  when defined(mitshm):
+    result = result and loadXcbShm()